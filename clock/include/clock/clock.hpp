@@ -0,0 +1,182 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ratio>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+//  cheap timestamps for hot paths
+//
+//      auto const t0 = clock::tsc_clock_t::now();          //  a couple of ns, no vdso call
+//      ...
+//      auto const elapsed = clock::tsc_clock_t::now() - t0;
+//
+//      clock::coarse_clock_t::tick();                      //  once per event loop pass, e.g. ring_t::wait_for_events
+//      c.last_activity_ = clock::coarse_clock_t::now();    //  a thread local load
+//
+//  tsc_clock_t reads the invariant TSC (the generic timer on aarch64) and turns ticks into nanoseconds with a 32.32
+//  fixed point multiply, calibrated once against steady_clock on first use, which takes about 10ms on x86.  it shares
+//  steady_clock's epoch, so its readings compare with steady_clock ones, but a calibration error of a few ppm means
+//  the two drift apart by that much over time.  without an invariant TSC it falls back to steady_clock
+//
+//  coarse_clock_t is whatever the calling thread last ticked, for timestamps that only need to be as fresh as the
+//  current pass of the loop
+
+namespace zsl::clock
+{
+
+namespace detail
+{
+
+inline int64_t steady_ns()
+{
+    return std::chrono::duration_cast < std::chrono::nanoseconds >(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline int64_t system_ns()
+{
+    return std::chrono::duration_cast < std::chrono::nanoseconds >(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+inline uint64_t ticks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t v;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(v));
+    return v;
+#else
+    return 0;
+#endif
+}
+
+struct calibration_t
+{
+    inline constexpr static uint32_t const shift{32};
+
+    bool tsc_{false};           //  false, ticks mean nothing here and now() is steady_clock's
+    uint64_t ticks_{};          //  ticks at ns_
+    int64_t ns_{};              //  steady_clock nanoseconds at ticks_
+    uint64_t mult_{};           //  nanoseconds per tick << shift
+    int64_t system_offset_{};   //  system_clock minus steady_clock, in nanoseconds
+
+    int64_t to_ns(uint64_t const t) const
+    {
+        //  signed, another core's TSC may read a hair behind the one calibrated on
+        auto const delta = static_cast < __int128 >(static_cast < int64_t >(t - ticks_));
+        return ns_ + static_cast < int64_t >((delta * mult_) >> shift);
+    }
+};
+
+//  the tightest of a few back to back reads, the tick count taken halfway through the steady_clock one
+inline void sample(uint64_t & t, int64_t & ns)
+{
+    uint64_t best{UINT64_MAX};
+    for (uint32_t i = 0; i < 8; ++i)
+    {
+        auto const before = ticks();
+        auto const now = steady_ns();
+        auto const after = ticks();
+        if (after - before < best)
+        {
+            best = after - before;
+            t = before + (after - before) / 2;
+            ns = now;
+        }
+    }
+}
+
+inline calibration_t calibrate()
+{
+    calibration_t c{};
+    c.system_offset_ = system_ns() - steady_ns();
+#if defined(__x86_64__) || defined(__i386__)
+    //  CPUID.80000007H:EDX[8], the TSC ticks at a constant rate through frequency and power state changes
+    uint32_t a{}, b{}, cx{}, d{};
+    if (!__get_cpuid(0x80000007, &a, &b, &cx, &d) || !(d & (1U << 8)))
+        return c;
+    uint64_t t0{};
+    int64_t ns0{};
+    sample(t0, ns0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    sample(c.ticks_, c.ns_);
+    if (c.ticks_ <= t0 || c.ns_ <= ns0)
+        return c;
+    c.mult_ = static_cast < uint64_t >((static_cast < unsigned __int128 >(c.ns_ - ns0) << calibration_t::shift) / (c.ticks_ - t0));
+    c.tsc_ = true;
+#elif defined(__aarch64__)
+    //  the generic timer says how fast it ticks, nothing to measure
+    uint64_t frequency;
+    asm volatile("mrs %0, cntfrq_el0" : "=r"(frequency));
+    if (frequency == 0)
+        return c;
+    sample(c.ticks_, c.ns_);
+    c.mult_ = static_cast < uint64_t >((static_cast < unsigned __int128 >(std::nano::den) << calibration_t::shift) / frequency);
+    c.tsc_ = true;
+#endif
+    return c;
+}
+
+inline calibration_t const & calibration()
+{
+    static calibration_t const c{calibrate()};
+    return c;
+}
+
+}
+
+struct tsc_clock_t
+{
+    using rep = int64_t;
+    using period = std::nano;
+    using duration = std::chrono::nanoseconds;
+    using time_point = std::chrono::time_point < tsc_clock_t >;
+    inline constexpr static bool const is_steady{true};
+
+    static time_point now() noexcept
+    {
+        auto const & c = detail::calibration();
+        if (c.tsc_) [[likely]]
+            return time_point{duration{c.to_ns(detail::ticks())}};
+        return time_point{duration{detail::steady_ns()}};
+    }
+
+    //  for logging, good to the drift described above
+    static std::chrono::sys_time < duration > to_sys(time_point const t) noexcept
+    {
+        return std::chrono::sys_time < duration >{t.time_since_epoch() + duration{detail::calibration().system_offset_}};
+    }
+};
+
+struct coarse_clock_t
+{
+    using rep = tsc_clock_t::rep;
+    using period = tsc_clock_t::period;
+    using duration = tsc_clock_t::duration;
+    using time_point = tsc_clock_t::time_point;
+    inline constexpr static bool const is_steady{true};
+
+    //  the calling thread's cached time, ticked first if it never was
+    static time_point now() noexcept
+    {
+        if (now_.time_since_epoch().count() == 0) [[unlikely]]
+            return tick();
+        return now_;
+    }
+
+    static time_point tick() noexcept
+    {
+        return now_ = tsc_clock_t::now();
+    }
+
+private:
+    inline static thread_local time_point now_{};
+};
+
+}
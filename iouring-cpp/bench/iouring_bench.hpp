@@ -0,0 +1,69 @@
+#pragma once
+
+#include <iouring.hpp>
+#include <iouring_utils_histogram.hpp>
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace zsl::iouring::bench
+{
+
+using histogram_t = utils::histogram::histogram_t < 7 >;
+using bench_clock_t = std::chrono::steady_clock;
+
+//  what a benchmark reports, latencies are in nanoseconds
+struct result_t
+{
+    std::string name_{};
+    uint64_t iterations_{};
+    std::chrono::nanoseconds elapsed_{};
+    histogram_t latency_{};
+    std::vector < std::pair < std::string, double > > counters_{};
+
+    void counter(std::string name, double const v)
+    {
+        counters_.emplace_back(std::move(name), v);
+    }
+
+    double items_per_second() const
+    {
+        return elapsed_.count() == 0 ? 0.0 : static_cast < double >(iterations_) * 1e9 / static_cast < double >(elapsed_.count());
+    }
+};
+
+struct options_t
+{
+    std::chrono::milliseconds duration_{std::chrono::seconds(2)};
+    uint32_t iterations_{100'000};
+};
+
+using benchmark_fn_t = std::function < void (options_t const &, result_t &) >;
+
+struct benchmark_t
+{
+    std::string name_;
+    benchmark_fn_t fn_;
+};
+
+inline std::vector < benchmark_t > & registry()
+{
+    static std::vector < benchmark_t > benchmarks;
+    return benchmarks;
+}
+
+inline bool register_benchmark(std::string name, benchmark_fn_t fn)
+{
+    registry().push_back({std::move(name), std::move(fn)});
+    return true;
+}
+
+inline auto elapsed_ns(bench_clock_t::time_point const since)
+{
+    return static_cast < uint64_t >(std::chrono::duration_cast < std::chrono::nanoseconds >(bench_clock_t::now() - since).count());
+}
+
+}
@@ -0,0 +1,115 @@
+#include "iouring_bench.hpp"
+
+#include <charconv>
+#include <fstream>
+#include <iostream>
+#include <string_view>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+//  iouring-bench [--filter <substring>] [--out <file.json>] [--duration-ms <n>] [--iterations <n>]
+//
+//  results go to the JSON file (stdout when not given), a human readable summary to stderr
+
+namespace
+{
+
+using namespace zsl::iouring::bench;
+
+std::string to_json(result_t const & r)
+{
+    auto const & h = r.latency_;
+    std::string counters;
+    for (auto const & [name, v] : r.counters_)
+        counters += std::format(", \"{}\": {}", name, v);
+    return std::format(
+        "    {{\"name\": \"{}\", \"iterations\": {}, \"real_time_ns\": {}, \"items_per_second\": {:.1f}, "
+        "\"latency_ns\": {{\"count\": {}, \"min\": {}, \"mean\": {:.1f}, \"p50\": {}, \"p90\": {}, \"p99\": {}, \"p99.9\": {}, \"max\": {}}}{}}}",
+        r.name_, r.iterations_, r.elapsed_.count(), r.items_per_second(),
+        h.count(), h.min(), h.mean(), h.value_at_percentile(50.0), h.value_at_percentile(90.0), h.value_at_percentile(99.0), h.value_at_percentile(99.9), h.max(), counters);
+}
+
+std::string to_json(std::vector < result_t > const & results)
+{
+    std::array < char, 256 > host{};
+    ::gethostname(host.data(), host.size() - 1);
+    std::string out = std::format(
+        "{{\n  \"context\": {{\"date\": \"{:%FT%TZ}\", \"host_name\": \"{}\", \"num_cpus\": {}, \"library_version\": \"{}\"}},\n  \"benchmarks\": [\n",
+        std::chrono::floor < std::chrono::seconds >(std::chrono::system_clock::now()), host.data(), std::thread::hardware_concurrency(), ZSL_IOURING_VERSION);
+    for (size_t i = 0; i < results.size(); ++i)
+        out += to_json(results[i]) + (i + 1 < results.size() ? ",\n" : "\n");
+    out += "  ]\n}\n";
+    return out;
+}
+
+template < typename T >
+T to_number(std::string_view const s)
+{
+    T v{};
+    if (auto const [_, ec] = std::from_chars(s.data(), s.data() + s.size(), v); ec != std::errc{})
+        throw std::invalid_argument(std::format("not a number: {}", s));
+    return v;
+}
+
+//  10k connections on loopback are 20k descriptors
+void raise_fd_limit()
+{
+    rlimit rl{};
+    if (::getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max)
+    {
+        rl.rlim_cur = rl.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &rl);
+    }
+}
+
+}
+
+int main(int argc, char ** argv)
+{
+    std::string_view filter;
+    std::string_view out;
+    options_t options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string_view const arg{argv[i]};
+        std::string_view const value{argv[i + 1]};
+        if (arg == "--filter")
+            filter = value;
+        else
+        if (arg == "--out")
+            out = value;
+        else
+        if (arg == "--duration-ms")
+            options.duration_ = std::chrono::milliseconds(to_number < uint32_t >(value));
+        else
+        if (arg == "--iterations")
+            options.iterations_ = to_number < uint32_t >(value);
+        else
+        {
+            std::cerr << std::format("unknown option {}", arg) << std::endl;
+            return 1;
+        }
+    }
+
+    raise_fd_limit();
+
+    std::vector < result_t > results;
+    for (auto const & [name, fn] : registry())
+    {
+        if (!filter.empty() && name.find(filter) == std::string::npos)
+            continue;
+        auto & r = results.emplace_back();
+        r.name_ = name;
+        fn(options, r);
+        auto const & h = r.latency_;
+        std::cerr << std::format("{:<24} {:>12} iterations {:>14.1f} items/s    p50 {:>9} ns    p99 {:>9} ns    p99.9 {:>9} ns", name, r.iterations_, r.items_per_second(), h.value_at_percentile(50.0), h.value_at_percentile(99.0), h.value_at_percentile(99.9)) << std::endl;
+    }
+
+    auto const json = to_json(results);
+    if (out.empty())
+        std::cout << json;
+    else
+        std::ofstream{std::string{out}} << json;
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include "iouring_bench.hpp"
+
+namespace
+{
+
+using namespace zsl::iouring;
+using namespace zsl::iouring::bench;
+using namespace zsl::iouring::coroutine;
+using namespace zsl::iouring::scheduler;
+
+struct counting_event_t : ring_t::event_t
+{
+    uint64_t completed_{};
+
+    static void on_complete(io_uring_cqe *, ring_t::event_t & e)
+    {
+        ++static_cast < counting_event_t & >(e).completed_;
+    }
+};
+
+//  submit a NOP, wait for it, dispatch it: the floor for every operation on the ring
+void nop_round_trip(options_t const & o, result_t & r)
+{
+    ring_t ring;
+    counting_event_t e{{&counting_event_t::on_complete}};
+    auto const start = bench_clock_t::now();
+    for (uint32_t i = 0; i < o.iterations_; ++i)
+    {
+        auto const t0 = bench_clock_t::now();
+        ring.nop(e);
+        ring.submit();
+        while (e.completed_ == i)
+            ring.wait_for_events(1);
+        r.latency_.record(elapsed_ns(t0));
+    }
+    r.elapsed_ = bench_clock_t::now() - start;
+    r.iterations_ = o.iterations_;
+}
+
+awaitable_t < void > arm_and_fire(scheduler_t & scheduler, duration_t const interval, uint32_t const n, histogram_t & lateness, bool & stopped)
+{
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        auto const t0 = bench_clock_t::now();
+        co_await scheduler.create_timer(interval);
+        auto const took = elapsed_ns(t0);
+        auto const nominal = static_cast < uint64_t >(std::chrono::duration_cast < std::chrono::nanoseconds >(interval).count());
+        lateness.record(took > nominal ? took - nominal : 0);
+    }
+    stopped = true;
+}
+
+//  latency is the time past the requested interval at which the coroutine is running again
+void timer(duration_t const interval, options_t const & o, result_t & r)
+{
+    ring_t ring;
+    scheduler_t scheduler{ring};
+    bool stopped{false};
+    auto const n = interval == duration_t::zero() ? o.iterations_ / 10 : static_cast < uint32_t >(std::max < int64_t >(1, o.duration_ / std::max(interval, duration_t{1})));
+    auto const start = bench_clock_t::now();
+    arm_and_fire(scheduler, interval, n, r.latency_, stopped);
+    ring.run(stopped);
+    r.elapsed_ = bench_clock_t::now() - start;
+    r.iterations_ = n;
+    r.counter("interval_ns", static_cast < double >(std::chrono::duration_cast < std::chrono::nanoseconds >(interval).count()));
+}
+
+[[maybe_unused]] auto const registered = std::array {
+    register_benchmark("ring/nop/round_trip", &nop_round_trip),
+    register_benchmark("timer/arm_fire/0us", [] (options_t const & o, result_t & r) { timer(duration_t{0}, o, r); }),
+    register_benchmark("timer/arm_fire/100us", [] (options_t const & o, result_t & r) { timer(duration_t{100}, o, r); }),
+};
+
+}
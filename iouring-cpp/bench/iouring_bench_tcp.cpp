@@ -0,0 +1,195 @@
+#include "iouring_bench.hpp"
+
+#include <span>
+#include <vector>
+
+#include <sys/socket.h>
+
+namespace
+{
+
+using namespace zsl::iouring;
+using namespace zsl::iouring::bench;
+using namespace zsl::iouring::coroutine;
+using namespace zsl::iouring::net;
+
+//  everything runs on one ring on loopback, clients and server alike
+struct tcp_bench_t
+{
+    ring_t ring_{};
+    tcp_socket_t server_;
+    bool stopped_{false};
+    uint32_t accepted_{};
+    uint32_t connected_{};
+    uint32_t active_{};
+    uint64_t messages_{};
+    histogram_t latency_{};
+    bench_clock_t::time_point start_{bench_clock_t::time_point::max()};
+    bench_clock_t::time_point deadline_{bench_clock_t::time_point::max()};
+
+    explicit tcp_bench_t(ipport_t const port) : server_{tcp_server(ring_, IPADDRV4_LOOPBACK, port, SOMAXCONN)}
+    {
+    }
+
+    ~tcp_bench_t()
+    {
+        //  cancels the outstanding accept and lets the server side sessions see their peers going away
+        server_.close();
+        for (auto i = 0; i < 10; ++i)
+            ring_.wait_for_events(1, std::chrono::milliseconds(10));
+    }
+
+    void run_until(auto && done)
+    {
+        while (!done())
+            ring_.wait_for_events(1, std::chrono::milliseconds(100));
+    }
+};
+
+awaitable_t < void > echo_session(tcp_socket_t cs)
+{
+    std::array < uint8_t, 4096 > buf;
+    while (true)
+    {
+        auto rr = co_await cs.recv(buf);
+        if (!rr.has_value())
+            break;
+        auto sr = co_await cs.send(std::span(buf.data(), rr.value()));
+        if (!sr.has_value())
+            break;
+    }
+}
+
+awaitable_t < void > echo_acceptor(tcp_bench_t & b)
+{
+    while (true)
+    {
+        auto ar = co_await b.server_.acceptor().accept();
+        if (!ar.has_value())
+            break;
+        ++b.accepted_;
+        echo_session(std::move(ar.value()));
+    }
+}
+
+awaitable_t < void > echo_client(tcp_bench_t & b, ipport_t const port, size_t const message_size)
+{
+    tcp_socket_t ss{b.ring_};
+    if (co_await ss.connect(IPADDRV4_LOOPBACK, port) == socket_t::connect_status_t::SUCCEEDED)
+    {
+        ++b.connected_;
+        std::vector < uint8_t > message(message_size, 'x');
+        std::vector < uint8_t > buf(message_size);
+        bool ok{true};
+        while (ok && bench_clock_t::now() < b.deadline_)
+        {
+            auto const t0 = bench_clock_t::now();
+            auto sr = co_await ss.send(message);
+            if (!sr.has_value())
+                break;
+            size_t received{0};
+            while (ok && received < message_size)
+            {
+                auto rr = co_await ss.recv(std::span(buf).subspan(received));
+                ok = rr.has_value();
+                received += ok ? rr.value() : 0;
+            }
+            //  connections ramp up first, only round trips started inside the measurement window count
+            if (ok && t0 >= b.start_)
+            {
+                b.messages_++;
+                b.latency_.record(elapsed_ns(t0));
+            }
+        }
+    }
+    ss.close();
+    if (--b.active_ == 0)
+        b.stopped_ = true;
+}
+
+//  ping-pong round trips of one small message per connection, all connections in parallel
+void echo(uint32_t const connections, ipport_t const port, options_t const & o, result_t & r)
+{
+    constexpr uint32_t const ramp_wave{256};
+    constexpr size_t const message_size{64};
+
+    tcp_bench_t b{port};
+    echo_acceptor(b);
+
+    //  connect in waves so the listen backlog never overflows into SYN retransmits
+    b.active_ = connections;
+    for (uint32_t started = 0; started < connections; )
+    {
+        auto const wave = std::min(ramp_wave, connections - started);
+        for (uint32_t i = 0; i < wave; ++i)
+            echo_client(b, port, message_size);
+        started += wave;
+        b.run_until([&] { return b.connected_ + (connections - b.active_) >= started && b.accepted_ >= b.connected_; });
+    }
+
+    b.start_ = bench_clock_t::now();
+    b.deadline_ = b.start_ + o.duration_;
+    b.run_until([&] { return b.stopped_; });
+
+    r.elapsed_ = std::min(bench_clock_t::now(), b.deadline_) - b.start_;
+    r.iterations_ = b.messages_;
+    r.latency_ = b.latency_;
+    r.counter("connections", b.connected_);
+    r.counter("message_size", message_size);
+}
+
+awaitable_t < void > connector(tcp_bench_t & b, ipport_t const port, uint32_t & remaining)
+{
+    while (remaining > 0)
+    {
+        --remaining;
+        tcp_socket_t ss{b.ring_};
+        auto const t0 = bench_clock_t::now();
+        if (co_await ss.connect(IPADDRV4_LOOPBACK, port) == socket_t::connect_status_t::SUCCEEDED)
+        {
+            ++b.connected_;
+            b.latency_.record(elapsed_ns(t0));
+        }
+    }
+}
+
+awaitable_t < void > dropping_acceptor(tcp_bench_t & b, uint32_t const total)
+{
+    while (b.accepted_ < total)
+    {
+        auto ar = co_await b.server_.acceptor().accept();
+        if (!ar.has_value())
+            break;
+        ++b.accepted_;
+    }
+    b.stopped_ = true;
+}
+
+//  connections accepted per second with a fixed number of connects in flight, latency is connect() completion
+void accept_rate(options_t const & o, result_t & r)
+{
+    constexpr uint32_t const concurrency{64};
+
+    tcp_bench_t b{ipport_t{56850}};
+    auto const total = std::max(concurrency, o.iterations_ / 10);
+    uint32_t remaining{total};
+    auto const start = bench_clock_t::now();
+    dropping_acceptor(b, total);
+    for (uint32_t i = 0; i < concurrency; ++i)
+        connector(b, ipport_t{56850}, remaining);
+    b.run_until([&] { return b.stopped_; });
+
+    r.elapsed_ = bench_clock_t::now() - start;
+    r.iterations_ = b.accepted_;
+    r.latency_ = b.latency_;
+    r.counter("concurrency", concurrency);
+}
+
+[[maybe_unused]] auto const registered = std::array {
+    register_benchmark("tcp/echo/1", [] (options_t const & o, result_t & r) { echo(1, ipport_t{56801}, o, r); }),
+    register_benchmark("tcp/echo/100", [] (options_t const & o, result_t & r) { echo(100, ipport_t{56802}, o, r); }),
+    register_benchmark("tcp/echo/10000", [] (options_t const & o, result_t & r) { echo(10000, ipport_t{56803}, o, r); }),
+    register_benchmark("tcp/accept_rate", &accept_rate),
+};
+
+}
@@ -1,6 +1,21 @@
 #include <iouring.hpp>
+#include <iouring_utils_histogram.hpp>
 
+#include <charconv>
+#include <iostream>
 #include <span>
+#include <string_view>
+#include <vector>
+
+//  echo load generator
+//
+//  iouring_echo_client [--host <ip>] [--port <n>] [--connections <n>] [--size <bytes>] [--rate <msgs/s>] [--depth <n>] [--duration-ms <n>]
+//
+//  every connection sends fixed size messages on its own schedule.  with a rate the run is open loop: message k of a
+//  connection is due at start + k * connections / rate and its latency is measured from when it was due, not from
+//  when it could actually be sent, so a stalled server shows up in the percentiles instead of slowing the generator
+//  down (coordinated omission).  depth caps the messages in flight per connection; without a rate the run is closed
+//  loop and each connection keeps depth messages in flight
 
 namespace
 {
@@ -10,58 +25,254 @@ using namespace zsl::iouring::coroutine;
 using namespace zsl::iouring::net;
 using namespace zsl::iouring::scheduler;
 
-template < typename T, size_t SZ, typename L >
-std::string_view to_string_view(std::array < T, SZ > const & v, L const len)
+using load_clock_t = std::chrono::steady_clock;
+using histogram_t = utils::histogram::histogram_t < 7 >;
+
+struct options_t
+{
+    ipaddressv4_t host_{IPADDRV4_LOOPBACK};
+    ipport_t port_{56789};
+    uint32_t connections_{1};
+    uint32_t size_{64};
+    uint32_t rate_{0};
+    uint32_t depth_{1};
+    std::chrono::milliseconds duration_{std::chrono::seconds(10)};
+};
+
+struct run_t
+{
+    options_t const & options_;
+    bool stopped_{false};
+    uint32_t active_{};
+    uint32_t connected_{};
+    uint64_t sent_{};
+    uint64_t received_{};
+    uint64_t errors_{};
+    histogram_t latency_{};
+    load_clock_t::time_point start_{};
+    load_clock_t::time_point deadline_{};
+    load_clock_t::time_point end_{};
+};
+
+//  parks one coroutine until another one lets it go
+struct gate_t
+{
+    std::coroutine_handle<> waiter_{};
+
+    bool await_ready() const
+    {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> h)
+    {
+        waiter_ = h;
+    }
+
+    void await_resume() const
+    {
+    }
+
+    void open()
+    {
+        if (auto h = std::exchange(waiter_, nullptr); h)
+            h.resume();
+    }
+};
+
+struct connection_t
+{
+    run_t & run_;
+    tcp_socket_t socket_;
+    std::vector < load_clock_t::time_point > due_;      //  due times of the messages in flight, oldest at head_
+    uint32_t head_{};
+    uint32_t in_flight_{};
+    bool sending_{true};
+    bool done_{false};                                  //  receiver gone, nothing more will come back
+    gate_t window_{};
+    gate_t drained_{};
+
+    connection_t(run_t & run, ring_t & ring) : run_{run}, socket_{ring}, due_(run.options_.depth_)
+    {
+    }
+};
+
+awaitable_t < void > receiver(connection_t & c)
+{
+    auto const size = c.run_.options_.size_;
+    std::vector < uint8_t > buf(std::max < uint32_t >(size, 4096));
+    uint64_t pending_bytes{0};
+    while (true)
+    {
+        auto rr = co_await c.socket_.recv(buf);
+        if (!rr.has_value())
+        {
+            if (c.sending_ || c.in_flight_ > 0)
+                ++c.run_.errors_;
+            break;
+        }
+        pending_bytes += rr.value();
+        auto const now = load_clock_t::now();
+        for (; pending_bytes >= size && c.in_flight_ > 0; pending_bytes -= size)
+        {
+            c.run_.latency_.record(static_cast < uint64_t >(std::chrono::duration_cast < std::chrono::nanoseconds >(now - c.due_[c.head_]).count()));
+            c.head_ = (c.head_ + 1) % c.due_.size();
+            --c.in_flight_;
+            ++c.run_.received_;
+        }
+        c.window_.open();
+        if (!c.sending_ && c.in_flight_ == 0)
+            c.drained_.open();
+    }
+    c.done_ = true;
+    c.window_.open();
+    c.drained_.open();
+}
+
+//  replies that never come back must not keep the run alive
+awaitable_t < void > close_if_stuck(ring_t & ring, connection_t & c)
 {
-    return {std::bit_cast < char const * >(v.data()), size_t(len)};
+    scheduler_t scheduler{ring};
+    co_await scheduler.create_timer(std::chrono::seconds(1));
+    if (!c.done_)
+        c.socket_.close();
 }
 
-awaitable_t < void > handle_server(tcp_socket_t ss)
+awaitable_t < void > run_connection(ring_t & ring, connection_t & c, uint32_t const index)
 {
-    std::array < char, 4096 > buffer;
-    for (auto s : {"hello", "world!", "coroutines", "are", "cool"})
+    auto & run = c.run_;
+    auto const & o = run.options_;
+    if (co_await c.socket_.connect(o.host_, o.port_) == socket_t::connect_status_t::SUCCEEDED)
     {
-        std::string_view sent{s};
-        auto && sr = co_await ss.send(sent);
-        if (!sr.has_value())
+        ++run.connected_;
+        receiver(c);
+
+        scheduler_t scheduler{ring};
+        std::vector < uint8_t > message(o.size_, 'x');
+
+        //  connections are staggered over one interval so they don't all fire at once
+        auto const interval = o.rate_ == 0 ? load_clock_t::duration::zero() : std::chrono::duration_cast < load_clock_t::duration >(std::chrono::duration < double >(double(o.connections_) / o.rate_));
+        auto due = run.start_ + interval * index / o.connections_;
+
+        while (due < run.deadline_ && !c.done_)
         {
-            logc(ss, "Send failed on...  {}", sent);
-             break;
+            if (auto const now = load_clock_t::now(); due > now)
+                co_await scheduler.create_timer(std::chrono::duration_cast < duration_t >(due - now));
+            while (c.in_flight_ == o.depth_ && !c.done_)
+                co_await c.window_;
+            if (c.done_)
+                break;
+            if (interval == load_clock_t::duration::zero())
+                due = load_clock_t::now();
+
+            c.due_[(c.head_ + c.in_flight_) % c.due_.size()] = due;
+            ++c.in_flight_;
+            //  a short send only queued part of the message, the rest has to follow before it counts
+            std::span < uint8_t const > rest{message};
+            while (!rest.empty())
+            {
+                auto sr = co_await c.socket_.send(rest);
+                if (!sr.has_value() || sr.value() == 0)
+                    break;
+                rest = rest.subspan(static_cast < size_t >(sr.value()));
+            }
+            if (!rest.empty())
+            {
+                ++run.errors_;
+                break;
+            }
+            ++run.sent_;
+            due += interval;
         }
-        logc(ss, "Sent...  {} bytes containing {}", sr.value(), sent);
-        logc(ss, "Waiting for server to echo it");
-        auto && rr = co_await ss.recv(buffer);
-        logc(ss, "Received something...  {}");
-        if (!rr.has_value())
+        c.sending_ = false;
+
+        if (c.in_flight_ > 0 && !c.done_)
         {
-            logc(ss, "Receive failed when expecting...  {}", sent);
-            break;
+            close_if_stuck(ring, c);
+            co_await c.drained_;
         }
-        auto received{to_string_view(buffer, rr.value())};
-        logc(ss, "Received...  {}", received);
-        if (sent != received)
-            break;
     }
-    logc(ss, "Stopping...");
+    else
+    {
+        ++run.errors_;
+    }
+    c.socket_.close();
+    if (--run.active_ == 0)
+        run.stopped_ = true;
+}
+
+template < typename T >
+T to_number(std::string_view const s)
+{
+    T v{};
+    if (auto const [_, ec] = std::from_chars(s.data(), s.data() + s.size(), v); ec != std::errc{})
+        throw std::invalid_argument(std::format("not a number: {}", s));
+    return v;
+}
+
+options_t parse(int argc, char ** argv)
+{
+    options_t o;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string_view const arg{argv[i]};
+        std::string_view const value{argv[i + 1]};
+        if (arg == "--host")
+            o.host_ = ipaddressv4_t{value};
+        else
+        if (arg == "--port")
+            o.port_ = ipport_t{to_number < uint16_t >(value)};
+        else
+        if (arg == "--connections")
+            o.connections_ = std::max(1U, to_number < uint32_t >(value));
+        else
+        if (arg == "--size")
+            o.size_ = std::max(1U, to_number < uint32_t >(value));
+        else
+        if (arg == "--rate")
+            o.rate_ = to_number < uint32_t >(value);
+        else
+        if (arg == "--depth")
+            o.depth_ = std::max(1U, to_number < uint32_t >(value));
+        else
+        if (arg == "--duration-ms")
+            o.duration_ = std::chrono::milliseconds(to_number < uint32_t >(value));
+        else
+            throw std::invalid_argument(std::format("unknown option {}", arg));
+    }
+    return o;
 }
 
-awaitable_t < void > run_echo_client(ring_t & ring, ipaddressv4_t const & ip, ipport_t const & port)
+void report(run_t const & run)
 {
-    log("Creating...");
-    auto ss = tcp_socket_t(ring);
-    log("Connecting...");
-    auto cs = co_await ss.connect(ip, port);
-    if (cs == socket_t::connect_status_t::SUCCEEDED)
-        co_await handle_server(std::move(ss));
-    log("Done with client...");
+    auto const & h = run.latency_;
+    //  the run ends when the last reply is in, which may be well after the configured duration
+    auto const secs = std::chrono::duration < double >(run.end_ - run.start_).count();
+    std::cout << std::format("connections {} size {} rate {} depth {} duration {}", run.connected_, run.options_.size_, run.options_.rate_, run.options_.depth_, run.options_.duration_) << std::endl;
+    std::cout << std::format("sent {} received {} errors {} elapsed {:.3f}s throughput {:.1f} msgs/s", run.sent_, run.received_, run.errors_, secs, secs > 0 ? double(run.received_) / secs : 0.0) << std::endl;
+    std::cout << std::format("latency (us)  min {:.1f}  mean {:.1f}  max {:.1f}", h.min() / 1e3, h.mean() / 1e3, h.max() / 1e3) << std::endl;
+    for (auto p : {50.0, 90.0, 99.0, 99.9, 99.99, 100.0})
+        std::cout << std::format("  p{:<6} {:>12.1f}", p, h.value_at_percentile(p) / 1e3) << std::endl;
 }
 
 }
 
-int main()
+int main(int argc, char ** argv)
 {
+    auto const options = parse(argc, argv);
+    auto run = std::make_unique < run_t >(options);
     ring_t ring{};
-    run_echo_client(ring, IPADDRV4_LOOPBACK, ipport_t{56789});
-    ring.run();
+    //  connections outlive their coroutines, a receiver or watchdog may still be parked on one when the run ends
+    std::vector < std::unique_ptr < connection_t > > connections;
+    for (uint32_t i = 0; i < options.connections_; ++i)
+        connections.push_back(std::make_unique < connection_t >(*run, ring));
+    run->active_ = options.connections_;
+    run->start_ = load_clock_t::now();
+    run->deadline_ = run->start_ + options.duration_;
+    for (uint32_t i = 0; i < options.connections_; ++i)
+        run_connection(ring, *connections[i], i);
+    ring.run(run->stopped_);
+    run->end_ = load_clock_t::now();
+    report(*run);
     return 0;
 }
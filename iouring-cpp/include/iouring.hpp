@@ -1,6 +1,22 @@
 #pragma once
 
 #include "iouring_service.hpp"
+#include "iouring_buffer_pool.hpp"
+#include "iouring_buffered.hpp"
+#include "iouring_chain.hpp"
+#include "iouring_channel.hpp"
 #include "iouring_coroutine.hpp"
+#include "iouring_combinators.hpp"
+#include "iouring_connection_table.hpp"
+#include "iouring_framing.hpp"
+#include "iouring_metrics.hpp"
 #include "iouring_net.hpp"
+#include "iouring_pool.hpp"
+#include "iouring_relay.hpp"
+#include "iouring_shm.hpp"
+#include "iouring_sync.hpp"
 #include "iouring_timer.hpp"
+#ifdef ZSL_IOURING_TLS
+#include "iouring_tls.hpp"
+#endif
+#include "iouring_trace.hpp"
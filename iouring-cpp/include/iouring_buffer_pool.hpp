@@ -0,0 +1,161 @@
+#pragma once
+
+#include "iouring_service.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+import zsl.types.bitset;
+
+namespace zsl::iouring::buffers
+{
+
+//  fixed size I/O buffers carved out of 2MB huge pages
+//
+//      buffers::pool_t pool{ring, {.buffer_size_ = 4096, .buffer_count_ = 4096}};
+//      if (auto lease = pool.acquire())
+//          co_await chain.read_fixed(fd, lease->buffer(), 0, lease->index().value());
+//
+//  the pages come from the hugetlb pool when it has any to give, else they are plain memory aligned to 2MB and
+//  left to transparent huge pages, and they are bound to the NUMA node of the CPU that builds the pool, so build it
+//  on the ring's thread.  each page is registered with the ring as one fixed buffer, every buffer in it shares the
+//  page's index.  a free list per page is a bitset, pages with a free buffer are kept on a stack, acquire and
+//  release are a bitset scan of one page and no allocation.  ring's thread only
+struct pool_t
+{
+    inline constexpr static size_t const page_size{2 * 1024 * 1024};
+    inline constexpr static uint32_t const min_buffer_size{1024};
+    inline constexpr static uint32_t const max_buffers_per_page{page_size / min_buffer_size};
+
+    struct options_t
+    {
+        uint32_t buffer_size_{4096};        //  power of two, min_buffer_size up to page_size
+        uint32_t buffer_count_{1024};       //  rounded up to whole pages
+        bool register_{true};               //  with the ring, for the *_fixed operations
+    };
+
+    struct stats_t
+    {
+        uint32_t capacity_{};
+        uint32_t in_use_{};
+        uint32_t in_use_max_{};
+        uint64_t acquired_{};
+        uint64_t exhausted_{};              //  acquires that found nothing free
+        uint32_t pages_{};
+        uint32_t huge_pages_{};             //  pages from the hugetlb pool rather than transparent huge pages
+        uint32_t registered_pages_{};       //  pages the ring took as fixed buffers, not all of them past RLIMIT_MEMLOCK
+        int32_t node_{-1};                  //  NUMA node the pages are bound to, -1 when unbound
+
+        double utilization() const
+        {
+            return capacity_ == 0 ? 0.0 : static_cast < double >(in_use_) / capacity_;
+        }
+    };
+
+    //  a buffer until it goes out of scope
+    struct lease_t
+    {
+        lease_t() = default;
+
+        lease_t(lease_t && rhs) noexcept : pool_{std::exchange(rhs.pool_, nullptr)}, page_{rhs.page_}, slot_{rhs.slot_}
+        {
+        }
+
+        lease_t & operator = (lease_t && rhs) noexcept
+        {
+            if (this != &rhs)
+            {
+                release();
+                pool_ = std::exchange(rhs.pool_, nullptr);
+                page_ = rhs.page_;
+                slot_ = rhs.slot_;
+            }
+            return *this;
+        }
+
+        lease_t(lease_t const &) = delete;
+        lease_t & operator = (lease_t const &) = delete;
+
+        ~lease_t()
+        {
+            release();
+        }
+
+        std::span < uint8_t > buffer() const
+        {
+            return pool_->buffer(page_, slot_);
+        }
+
+        //  the ring's fixed buffer index, nothing when the page couldn't be registered
+        std::optional < uint16_t > index() const
+        {
+            return pool_->pages_[page_].index_;
+        }
+
+        void release()
+        {
+            if (pool_)
+                std::exchange(pool_, nullptr)->release(page_, slot_);
+        }
+
+    private:
+        friend struct pool_t;
+
+        lease_t(pool_t & pool, uint32_t const page, uint32_t const slot) : pool_{&pool}, page_{page}, slot_{slot}
+        {
+        }
+
+        pool_t * pool_{};
+        uint32_t page_{};
+        uint32_t slot_{};
+    };
+
+    pool_t(ring_t & ring, options_t const & options);
+    ~pool_t();
+    pool_t(pool_t const &) = delete;
+    pool_t & operator = (pool_t const &) = delete;
+
+    //  nothing when every buffer is leased
+    std::optional < lease_t > acquire();
+
+    uint32_t buffer_size() const
+    {
+        return options_.buffer_size_;
+    }
+
+    stats_t const & stats() const
+    {
+        return stats_;
+    }
+
+private:
+    struct page_t
+    {
+        uint8_t * base_{};
+        types::bitset < max_buffers_per_page > free_{};
+        uint32_t free_count_{};
+        std::optional < uint16_t > index_{};
+        bool listed_{false};                //  on the stack of pages with a free buffer
+        bool huge_{false};
+    };
+
+    std::span < uint8_t > buffer(uint32_t const page, uint32_t const slot) const
+    {
+        return {pages_[page].base_ + size_t{slot} * options_.buffer_size_, options_.buffer_size_};
+    }
+
+    void release(uint32_t const page, uint32_t const slot);
+    void unmap();
+
+    ring_t & ring_;
+    options_t const options_;
+    uint32_t const buffers_per_page_;
+    std::vector < page_t > pages_{};
+    std::vector < uint32_t > available_{};  //  pages with a free buffer, most recently freed on top
+    stats_t stats_{};
+};
+
+}
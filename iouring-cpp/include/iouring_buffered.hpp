@@ -0,0 +1,207 @@
+#pragma once
+
+#include "iouring_net.hpp"
+#include "iouring_framing.hpp"
+
+#include <array>
+#include <coroutine>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+
+//  buffered streams over a socket
+//
+//      buffered_writer_t writer{socket};
+//      co_await writer.write(reply);           //  a copy, no submission unless the buffer is full
+//      ...
+//      co_await writer.flush();
+//
+//      buffered_reader_t reader{socket};
+//      auto line = co_await reader.read_until('\n');
+//
+//  small writes are coalesced: the writer copies them into a buffer registered with the ring and sends it at the
+//  end of the pass through wait_for_events that filled it, when it's full, or on flush(), whichever comes first.
+//  while one buffer is on its way a second one takes new writes, a write only suspends when both are full
+
+namespace zsl::iouring::net
+{
+
+struct buffered_writer_t
+{
+    using write_result_t = expected_t < size_t, int32_t >;
+    using flush_result_t = expected_t < uint64_t /* bytes sent so far */, int32_t >;
+
+    inline constexpr static size_t const default_capacity{16 * 1024};
+
+    //  capacity of each of the two buffers
+    explicit buffered_writer_t(socket_t & socket, size_t const capacity = default_capacity);
+    ~buffered_writer_t();
+
+    buffered_writer_t(buffered_writer_t const &) = delete;
+    buffered_writer_t & operator = (buffered_writer_t const &) = delete;
+
+    struct write_awaitable_t
+    {
+        buffered_writer_t & self_;
+        std::span < uint8_t const > data_;
+        size_t size_{data_.size()};
+
+        //  the common case, it all fits and there's nothing to wait for
+        bool await_ready()
+        {
+            return self_.error_ != 0 || self_.append(data_);
+        }
+
+        void await_suspend(std::coroutine_handle<> coroutine)
+        {
+            self_.wait(coroutine, data_);
+        }
+
+        write_result_t await_resume() const
+        {
+            if (self_.error_ != 0)
+                return std::unexpected(self_.error_);
+            return size_;
+        }
+    };
+
+    struct flush_awaitable_t
+    {
+        buffered_writer_t & self_;
+
+        bool await_ready() const
+        {
+            return self_.error_ != 0 || self_.idle();
+        }
+
+        void await_suspend(std::coroutine_handle<> coroutine)
+        {
+            self_.wait(coroutine, {});
+        }
+
+        flush_result_t await_resume() const
+        {
+            if (self_.error_ != 0)
+                return std::unexpected(self_.error_);
+            return self_.sent_;
+        }
+    };
+
+    //  one writer at a time, the data is copied before the awaitable completes
+    [[nodiscard]] write_awaitable_t write(std::span < uint8_t const > data)
+    {
+        return {*this, data};
+    }
+
+    template < SizedBuffer T >
+    [[nodiscard]] write_awaitable_t write(T const & data)
+    {
+        return write(std::span(std::bit_cast < uint8_t const * >(std::ranges::data(data)), std::ranges::size(data) * sizeof(std::ranges::range_value_t < T >)));
+    }
+
+    //  completes once everything written so far has been sent.  writes from outside a pass through wait_for_events,
+    //  i.e. not from a completion, aren't sent before the next pass ends, flush to send them right away.  what isn't
+    //  flushed is lost: destroying the writer cancels a send still on its way, whose buffers are freed once it's back
+    [[nodiscard]] flush_awaitable_t flush()
+    {
+        return {*this};
+    }
+
+    //  buffered and not sent yet
+    size_t buffered() const;
+
+    //  whether the buffers were registered, sends are then write_fixed rather than send
+    bool registered() const
+    {
+        return buffers_[0].index_.has_value();
+    }
+
+private:
+    struct buffer_t
+    {
+        uint8_t * data_{};
+        uint32_t size_{};
+        std::optional < uint16_t > index_{};
+    };
+
+    //  on the heap, a send still on its way when the writer goes takes it over along with the buffers
+    struct send_event_t : ring_t::event_t
+    {
+        buffered_writer_t * self_;
+        std::unique_ptr < uint8_t[] > memory_{};
+    };
+
+    struct deferred_t : ring_t::posted_t
+    {
+        buffered_writer_t & self_;
+    };
+
+    static void on_send(io_uring_cqe * cqe, ring_t::event_t & e);
+    static void on_deferred(ring_t::posted_t & p, bool const run);
+
+    bool append(std::span < uint8_t const > & data);
+    void wait(std::coroutine_handle<> coroutine, std::span < uint8_t const > data);
+    void start();
+    void send();
+    void resume();
+    bool idle() const;
+
+    socket_t & socket_;
+    size_t const capacity_;
+    std::unique_ptr < uint8_t[] > memory_;
+    std::array < buffer_t, 2 > buffers_{};
+    uint32_t active_{0};                                //  taking writes, the other one may be on its way
+    uint32_t offset_{0};                                //  of the buffer on its way, after a short send
+    bool sending_{false};
+    bool deferred_{false};
+    bool flushing_{false};                              //  the waiter is a flush rather than a write
+    int32_t error_{0};
+    uint64_t sent_{0};
+    std::coroutine_handle<> waiter_{};
+    std::span < uint8_t const > pending_{};             //  the waiter's data that didn't fit yet
+    std::unique_ptr < send_event_t > send_event_{std::make_unique < send_event_t >(ring_t::event_t{&on_send}, this)};
+    deferred_t deferred_event_{{&on_deferred}, *this};
+};
+
+//  reads from a socket through a buffer, what's handed out stays valid until the next read
+struct buffered_reader_t
+{
+    using read_result_t = expected_t < std::span < uint8_t const >, int32_t >;
+
+    inline constexpr static size_t const default_capacity{64 * 1024};
+
+    explicit buffered_reader_t(socket_t & socket, size_t const capacity = default_capacity) : socket_{socket}, buffer_{capacity}
+    {
+    }
+
+    //  up to and including the delimiter, -EMSGSIZE when the buffer fills up without one.  fails with whatever recv
+    //  failed with, 0 when the peer closed
+    coroutine::awaitable_t < read_result_t > read_until(uint8_t const delimiter);
+
+    //  exactly size bytes
+    coroutine::awaitable_t < read_result_t > read_exactly(size_t const size);
+
+    //  whatever is buffered, receiving first if nothing is
+    coroutine::awaitable_t < read_result_t > read_some();
+
+    size_t buffered() const
+    {
+        return tail_ - head_ - consumed_;
+    }
+
+private:
+    //  false when the peer closed or recv failed, error_ then says which
+    coroutine::awaitable_t < bool > fill();
+    read_result_t take(size_t const size);
+
+    socket_t & socket_;
+    framing::mirrored_buffer_t buffer_;
+    uint64_t head_{};
+    uint64_t tail_{};
+    uint64_t consumed_{};       //  handed out last, released on the next read
+    uint64_t scanned_{};        //  bytes past head_ already searched for the delimiter
+    int32_t error_{0};
+};
+
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "iouring_service.hpp"
+
+#include <array>
+#include <coroutine>
+#include <cstdint>
+#include <expected>
+#include <optional>
+#include <span>
+
+//  linked operation chains, submitted in one go and run by the kernel one after the other
+//
+//      chain::chain_t < 2 > c{ring};
+//      auto r = co_await c.recv(fd, buffer, MSG_WAITALL).send(fd, buffer);
+//
+//  every link but the last is flagged IOSQE_CQE_SKIP_SUCCESS, so a chain that goes through posts exactly one
+//  completion, the last link's, and one that breaks posts exactly one too, the failing link's, the kernel dropping
+//  the rest quietly.  either way the awaiting coroutine is resumed once.  a short recv with MSG_WAITALL, or a
+//  short read or write, counts as a failure and breaks the chain.  hard links (hard()) go on past a failure, the
+//  chain then ends with its last link and reports the first failure.
+//
+//  the buffers are taken as they are when the chain is submitted, the kernel can't carry a result from one link
+//  into the next, e.g. a recv's byte count into the send after it, so chains suit fixed size messages.  fds are
+//  plain descriptors, std::to_underlying(socket.fd()).  skipped completions don't show up in the ring's metrics
+
+namespace zsl::iouring::chain
+{
+
+struct link_t
+{
+    enum class op_t : uint8_t { NOP, RECV, SEND, READ, WRITE, READ_FIXED, WRITE_FIXED, FSYNC };
+
+    op_t op_{op_t::NOP};
+    int32_t fd_{-1};
+    void * buf_{};
+    uint32_t len_{};
+    uint64_t offset_{};
+    uint32_t flags_{};          //  msg flags for recv and send, fsync flags for fsync
+    uint16_t buf_index_{};      //  registered buffer, *_FIXED only
+    bool hard_{false};          //  the next link runs even if this one fails
+};
+
+struct error_t
+{
+    uint32_t index_{};          //  of the first link that failed
+    int32_t error_{};           //  negative errno, or the byte count of a short transfer
+};
+
+//  the last link's result
+using result_t = std::expected < int32_t, error_t >;
+
+struct chain_base_t
+{
+    chain_base_t(chain_base_t const &) = delete;
+    chain_base_t & operator = (chain_base_t const &) = delete;
+
+    chain_base_t & nop();
+    chain_base_t & recv(int32_t const fd, std::span < uint8_t > buf, uint32_t const flags = 0);
+    chain_base_t & send(int32_t const fd, std::span < uint8_t const > buf, uint32_t const flags = 0);
+    chain_base_t & read(int32_t const fd, std::span < uint8_t > buf, uint64_t const offset);
+    chain_base_t & write(int32_t const fd, std::span < uint8_t const > buf, uint64_t const offset);
+    chain_base_t & read_fixed(int32_t const fd, std::span < uint8_t > buf, uint64_t const offset, uint16_t const index);
+    chain_base_t & write_fixed(int32_t const fd, std::span < uint8_t const > buf, uint64_t const offset, uint16_t const index);
+    chain_base_t & fsync(int32_t const fd, uint32_t const flags = 0);
+
+    //  hard links the last link added to the next one
+    chain_base_t & hard();
+
+    size_t size() const
+    {
+        return count_;
+    }
+
+    //  links can be added again, a chain is reusable once it has completed
+    void clear()
+    {
+        count_ = 0;
+    }
+
+    bool await_ready() const
+    {
+        return count_ == 0;
+    }
+
+    void await_suspend(std::coroutine_handle<> coroutine);
+
+    result_t await_resume() const
+    {
+        if (error_)
+            return std::unexpected(*error_);
+        return last_;
+    }
+
+    //  cancels whichever link is in flight, the chain breaks with -ECANCELED
+    void cancel();
+
+protected:
+    struct event_t : ring_t::event_t
+    {
+        chain_base_t * self_{};
+        uint32_t index_{};
+    };
+
+    chain_base_t(ring_t & ring, std::span < link_t > links, std::span < event_t > events) : ring_{ring}, links_{links}, events_{events}
+    {
+    }
+
+private:
+    static void on_link(io_uring_cqe * cqe, ring_t::event_t & e);
+
+    link_t & add(link_t::op_t const op, int32_t const fd);
+
+    ring_t & ring_;
+    std::span < link_t > links_;
+    std::span < event_t > events_;
+    uint32_t count_{0};
+    std::coroutine_handle<> coroutine_{};
+    std::optional < error_t > error_{};
+    int32_t last_{};
+};
+
+//  up to N links, kept in place so a chain never allocates
+template < size_t N >
+struct chain_t : chain_base_t
+{
+    static_assert(N > 0);
+
+    explicit chain_t(ring_t & ring) : chain_base_t{ring, links_, events_}
+    {
+    }
+
+private:
+    std::array < link_t, N > links_{};
+    std::array < event_t, N > events_{};
+};
+
+}
@@ -0,0 +1,509 @@
+#pragma once
+
+#include "iouring_service.hpp"
+#include "iouring_utils_mpmc.hpp"
+
+#include <array>
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+//  bounded channels between coroutines, the stages of a pipeline
+//
+//      channel_t < order_t, 1024, channel_mode_t::CROSS_RING > orders;
+//      co_await orders.push(ring, order);                  //  suspends while full, false once closed
+//      while (auto order = co_await orders.pop(ring))      //  suspends while empty, nullopt once closed and drained
+//          ...
+//
+//  a SAME_RING channel is for coroutines on one ring: a plain ring buffer, no atomics, a parked coroutine is woken by
+//  a no-op the push or pop that lets it through prepares on the ring, so a chain of waiters doesn't nest resumptions
+//  on the waker's stack.  a CROSS_RING channel takes producers and consumers on any
+//  ring: items go through a lock-free bounded queue (utils::mpmc::queue_t), a coroutine that has to wait parks on a
+//  short spin locked list and is woken on its own ring by an IORING_OP_MSG_RING from the waker's.  an operation that
+//  doesn't wait makes no system call, and only looks past an atomic counter at the waiter lists when someone's parked.
+//
+//  every operation takes the calling coroutine's ring.  the batch versions move as many items as fit, waiting only
+//  when none do.  close() once the producers are done, pushes racing it may be lost.  a channel has to outlive its
+//  waiters
+
+namespace zsl::iouring
+{
+
+enum class channel_mode_t : uint8_t
+{
+    SAME_RING,
+    CROSS_RING,
+};
+
+namespace detail
+{
+
+//  a coroutine parked on a full or empty channel
+struct channel_waiter_t : ring_t::event_t
+{
+    //  true once the operation is over, whether it went through or found the channel closed
+    using attempt_t = bool (*)(channel_waiter_t &);
+
+    channel_waiter_t(ring_t & ring, void * channel, attempt_t const attempt) : ring_{ring}, channel_{channel}, attempt_{attempt}
+    {
+    }
+
+    ring_t & ring_;
+    void * channel_;
+    attempt_t attempt_;
+    void * list_{};
+    channel_waiter_t * next_waiter_{};
+};
+
+template < bool ATOMIC >
+struct channel_waiters_t
+{
+    void add(channel_waiter_t & w)
+    {
+        lock();
+        w.next_waiter_ = nullptr;
+        if (tail_ != nullptr)
+            tail_->next_waiter_ = &w;
+        else
+            head_ = &w;
+        tail_ = &w;
+        ++count_;
+        unlock();
+    }
+
+    bool remove(channel_waiter_t & w)
+    {
+        lock();
+        channel_waiter_t * previous{};
+        for (auto ** link = &head_; *link != nullptr; previous = *link, link = &(*link)->next_waiter_)
+            if (*link == &w)
+            {
+                *link = w.next_waiter_;
+                if (tail_ == &w)
+                    tail_ = previous;
+                --count_;
+                unlock();
+                return true;
+            }
+        unlock();
+        return false;
+    }
+
+    //  up to n waiters off the list, oldest first, linked through next_waiter_
+    channel_waiter_t * take(size_t n)
+    {
+        if (count_ == 0)
+            return nullptr;
+        lock();
+        auto * first = head_;
+        channel_waiter_t * last{};
+        for (auto * w = head_; w != nullptr && n > 0; w = w->next_waiter_, --n)
+        {
+            last = w;
+            --count_;
+        }
+        if (last == nullptr)
+        {
+            unlock();
+            return nullptr;
+        }
+        head_ = last->next_waiter_;
+        if (head_ == nullptr)
+            tail_ = nullptr;
+        last->next_waiter_ = nullptr;
+        unlock();
+        return first;
+    }
+
+private:
+    void lock()
+    {
+        if constexpr (ATOMIC)
+            while (lock_.test_and_set(std::memory_order_acquire))
+                while (lock_.test(std::memory_order_relaxed))
+                    ;
+    }
+
+    void unlock()
+    {
+        if constexpr (ATOMIC)
+            lock_.clear(std::memory_order_release);
+    }
+
+    channel_waiter_t * head_{};
+    channel_waiter_t * tail_{};
+    std::conditional_t < ATOMIC, std::atomic < uint32_t >, uint32_t > count_{0};
+    std::atomic_flag lock_{};
+};
+
+//  the SAME_RING queue, one ring's thread only
+template < typename T, uint32_t N >
+struct channel_local_queue_t
+{
+    template < typename U >
+    bool push(U && value)
+    {
+        if (count_ == N)
+            return false;
+        items_[(head_ + count_) & (N - 1)].emplace(std::forward < U >(value));
+        ++count_;
+        return true;
+    }
+
+    std::optional < T > pop()
+    {
+        if (count_ == 0)
+            return std::nullopt;
+        auto & item = items_[head_];
+        std::optional < T > value{std::move(*item)};
+        item.reset();
+        head_ = (head_ + 1) & (N - 1);
+        --count_;
+        return value;
+    }
+
+    bool empty() const
+    {
+        return count_ == 0;
+    }
+
+    size_t size() const
+    {
+        return count_;
+    }
+
+private:
+    std::array < std::optional < T >, N > items_{};
+    alignas(64) uint32_t head_{0};
+    alignas(64) uint32_t count_{0};
+};
+
+}
+
+template < typename T, uint32_t N, channel_mode_t MODE = channel_mode_t::SAME_RING >
+struct channel_t
+{
+    static_assert(N > 0 && (N & (N - 1)) == 0, "capacity must be a power of two");
+    inline constexpr static bool const cross_ring{MODE == channel_mode_t::CROSS_RING};
+
+    channel_t() = default;
+    channel_t(channel_t const &) = delete;
+    channel_t & operator = (channel_t const &) = delete;
+
+    template < typename U >
+    bool try_push(ring_t & ring, U && value)
+    {
+        if (closed() || !queue_.push(std::forward < U >(value)))
+            return false;
+        wake(ring, consumers_, 1);
+        return true;
+    }
+
+    //  moves out of the first values that fit, returns how many
+    size_t try_push(ring_t & ring, std::span < T > values)
+    {
+        return closed() ? 0 : push_some(ring, values);
+    }
+
+    std::optional < T > try_pop(ring_t & ring)
+    {
+        auto value = queue_.pop();
+        if (value)
+            wake(ring, producers_, 1);
+        return value;
+    }
+
+    //  fills the front of out, returns how many
+    size_t try_pop(ring_t & ring, std::span < T > out)
+    {
+        return pop_some(ring, out);
+    }
+
+    struct push_awaitable_t : detail::channel_waiter_t
+    {
+        push_awaitable_t(ring_t & ring, channel_t & channel, T && value) : channel_waiter_t{ring, &channel, &attempt_push}, value_{std::move(value)}
+        {
+        }
+
+        bool await_ready()
+        {
+            return attempt_(*this);
+        }
+
+        bool await_suspend(std::coroutine_handle<> coroutine)
+        {
+            coroutine_ = coroutine;
+            auto & self = *static_cast < channel_t * >(channel_);
+            return self.park(self.producers_, *this);
+        }
+
+        //  false when the channel was closed
+        bool await_resume() const
+        {
+            return pushed_;
+        }
+
+        T value_;
+        bool pushed_{false};
+    };
+
+    struct push_some_awaitable_t : detail::channel_waiter_t
+    {
+        push_some_awaitable_t(ring_t & ring, channel_t & channel, std::span < T > values) : channel_waiter_t{ring, &channel, &attempt_push_some}, values_{values}
+        {
+        }
+
+        bool await_ready()
+        {
+            return attempt_(*this);
+        }
+
+        bool await_suspend(std::coroutine_handle<> coroutine)
+        {
+            coroutine_ = coroutine;
+            auto & self = *static_cast < channel_t * >(channel_);
+            return self.park(self.producers_, *this);
+        }
+
+        //  0 when the channel was closed
+        size_t await_resume() const
+        {
+            return count_;
+        }
+
+        std::span < T > values_;
+        size_t count_{0};
+    };
+
+    struct pop_awaitable_t : detail::channel_waiter_t
+    {
+        pop_awaitable_t(ring_t & ring, channel_t & channel) : channel_waiter_t{ring, &channel, &attempt_pop}
+        {
+        }
+
+        bool await_ready()
+        {
+            return attempt_(*this);
+        }
+
+        bool await_suspend(std::coroutine_handle<> coroutine)
+        {
+            coroutine_ = coroutine;
+            auto & self = *static_cast < channel_t * >(channel_);
+            return self.park(self.consumers_, *this);
+        }
+
+        //  nullopt when the channel was closed and drained
+        std::optional < T > await_resume()
+        {
+            return std::move(value_);
+        }
+
+        std::optional < T > value_{};
+    };
+
+    struct pop_some_awaitable_t : detail::channel_waiter_t
+    {
+        pop_some_awaitable_t(ring_t & ring, channel_t & channel, std::span < T > out) : channel_waiter_t{ring, &channel, &attempt_pop_some}, out_{out}
+        {
+        }
+
+        bool await_ready()
+        {
+            return attempt_(*this);
+        }
+
+        bool await_suspend(std::coroutine_handle<> coroutine)
+        {
+            coroutine_ = coroutine;
+            auto & self = *static_cast < channel_t * >(channel_);
+            return self.park(self.consumers_, *this);
+        }
+
+        //  0 when the channel was closed and drained
+        size_t await_resume() const
+        {
+            return count_;
+        }
+
+        std::span < T > out_;
+        size_t count_{0};
+    };
+
+    [[nodiscard]] push_awaitable_t push(ring_t & ring, T value)
+    {
+        return push_awaitable_t{ring, *this, std::move(value)};
+    }
+
+    //  waits for room for at least one, moves out of as many values as fit
+    [[nodiscard]] push_some_awaitable_t push(ring_t & ring, std::span < T > values)
+    {
+        return push_some_awaitable_t{ring, *this, values};
+    }
+
+    [[nodiscard]] pop_awaitable_t pop(ring_t & ring)
+    {
+        return pop_awaitable_t{ring, *this};
+    }
+
+    //  waits for at least one, fills the front of out with as many as there are
+    [[nodiscard]] pop_some_awaitable_t pop(ring_t & ring, std::span < T > out)
+    {
+        return pop_some_awaitable_t{ring, *this, out};
+    }
+
+    //  wakes every waiter, pushes fail from now on and pops once the channel is drained
+    void close(ring_t & ring)
+    {
+        closed_ = true;
+        wake(ring, consumers_, SIZE_MAX);
+        wake(ring, producers_, SIZE_MAX);
+    }
+
+    bool closed() const
+    {
+        return closed_;
+    }
+
+    //  hints only across rings
+    bool empty() const
+    {
+        return queue_.empty();
+    }
+
+    size_t size() const
+    {
+        return queue_.size();
+    }
+
+private:
+    using waiters_t = detail::channel_waiters_t < cross_ring >;
+    using queue_t = std::conditional_t < cross_ring, utils::mpmc::queue_t < T, N >, detail::channel_local_queue_t < T, N > >;
+
+    size_t push_some(ring_t & ring, std::span < T > values)
+    {
+        size_t count{0};
+        while (count < values.size() && queue_.push(std::move(values[count])))
+            ++count;
+        if (count > 0)
+            wake(ring, consumers_, count);
+        return count;
+    }
+
+    size_t pop_some(ring_t & ring, std::span < T > out)
+    {
+        size_t count{0};
+        while (count < out.size())
+            if (auto value = queue_.pop(); value)
+                out[count++] = std::move(*value);
+            else
+                break;
+        if (count > 0)
+            wake(ring, producers_, count);
+        return count;
+    }
+
+    static bool attempt_push(detail::channel_waiter_t & w)
+    {
+        auto & a = static_cast < push_awaitable_t & >(w);
+        auto & self = *static_cast < channel_t * >(w.channel_);
+        if (self.closed())
+            return true;
+        return a.pushed_ = self.try_push(w.ring_, std::move(a.value_));
+    }
+
+    static bool attempt_push_some(detail::channel_waiter_t & w)
+    {
+        auto & a = static_cast < push_some_awaitable_t & >(w);
+        auto & self = *static_cast < channel_t * >(w.channel_);
+        if (self.closed())
+            return true;
+        a.count_ = self.push_some(w.ring_, a.values_);
+        return a.count_ > 0;
+    }
+
+    static bool attempt_pop(detail::channel_waiter_t & w)
+    {
+        auto & a = static_cast < pop_awaitable_t & >(w);
+        auto & self = *static_cast < channel_t * >(w.channel_);
+        a.value_ = self.try_pop(w.ring_);
+        return a.value_.has_value() || self.closed();
+    }
+
+    static bool attempt_pop_some(detail::channel_waiter_t & w)
+    {
+        auto & a = static_cast < pop_some_awaitable_t & >(w);
+        auto & self = *static_cast < channel_t * >(w.channel_);
+        a.count_ = self.pop_some(w.ring_, a.out_);
+        return a.count_ > 0 || self.closed();
+    }
+
+    //  false when the operation went through after all and the coroutine carries on without suspending.  a waiter
+    //  only ever attempts its operation off the list, so a wake nested in that attempt can't pick it up again
+    bool park(waiters_t & list, detail::channel_waiter_t & w)
+    {
+        w.handler_ = &on_message;
+        w.list_ = &list;
+        for (;;)
+        {
+            list.add(w);
+            if constexpr (!cross_ring)
+                return true;
+            else
+            {
+                //  pairs with the fence in wake(), either the waker finds us on the list or we see what it did
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                auto const hopeful = closed() || (&list == &consumers_ ? !queue_.empty() : queue_.size() < N);
+                if (!hopeful)
+                    return true;
+                //  not there any more, a waker got to us first and its wakeup makes the attempt
+                if (!list.remove(w))
+                    return true;
+                if (w.attempt_(w))
+                    return false;
+            }
+        }
+    }
+
+    //  on the waiter's ring, by a no-op from a waker on the same ring or a message from another
+    static void on_message(io_uring_cqe *, ring_t::event_t & e)
+    {
+        auto & w = static_cast < detail::channel_waiter_t & >(e);
+        auto & self = *static_cast < channel_t * >(w.channel_);
+        if (w.attempt_(w) || !self.park(*static_cast < waiters_t * >(w.list_), w))
+            w.resume();
+    }
+
+    void wake(ring_t & ring, waiters_t & list, size_t const count)
+    {
+        if constexpr (cross_ring)
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto * w = list.take(count);
+        bool local{false};
+        while (w != nullptr)
+        {
+            auto * next = w->next_waiter_;
+            if (&w->ring_ == &ring)
+            {
+                ring.nop(*w);
+                local = true;
+            }
+            else
+                ring.msg_ring(w->ring_, *w);
+            w = next;
+        }
+        if (local)
+            ring.submit();
+    }
+
+    queue_t queue_{};
+    waiters_t consumers_{};
+    waiters_t producers_{};
+    std::conditional_t < cross_ring, std::atomic < bool >, bool > closed_{false};
+};
+
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "iouring_service.hpp"
+#include "iouring_coroutine.hpp"
+
+#include <array>
+#include <coroutine>
+#include <cstdint>
+#include <stop_token>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+//  when_all / when_any over ring awaitables and tasks
+//
+//      auto [sent, received] = co_await when_all(a.send(request), b.recv(reply));
+//      auto [index, results] = co_await when_any(s.recv(buffer), scheduler.create_timer(10s));
+//
+//  the awaitables are moved into the combinator, which lives in the awaiting coroutine's frame for as long as the
+//  co_await does, so nothing is allocated.  every operation is started at once, each one's completion is counted
+//  and the awaiting coroutine is resumed when the last one is in.  when_any cancels the others as soon as the first
+//  one completes and still waits for them to come back, so their events are never left behind in the ring; losing
+//  tasks are asked to stop through their stop source.  everything runs on the ring's thread
+
+namespace zsl::iouring::coroutine
+{
+
+//  void results show up as std::monostate
+template < typename A >
+using when_result_t = std::conditional_t <
+        std::is_void_v < decltype(std::declval < A & >().await_resume()) >,
+        std::monostate,
+        decltype(std::declval < A & >().await_resume()) >;
+
+template < typename... R >
+struct when_any_result_t
+{
+    uint32_t index_{};              //  of the first awaitable to complete
+    std::tuple < R... > results_{};
+};
+
+template < bool ANY, typename... A >
+struct when_t
+{
+    inline constexpr static uint32_t const count{sizeof...(A)};
+    static_assert(count > 0);
+
+    struct slot_t : ring_t::completion_t
+    {
+        when_t * self_{};
+        uint32_t index_{};
+        bool done_{false};
+    };
+
+    std::tuple < A... > awaitables_;
+    std::array < slot_t, count > slots_{};
+    std::coroutine_handle<> continuation_{};
+    uint32_t remaining_{count + 1};     //  plus one for await_suspend itself, completions may come in while starting
+    uint32_t winner_{count};
+    bool started_{false};
+
+    explicit when_t(A &&... awaitables) : awaitables_{std::move(awaitables)...}
+    {
+    }
+
+    bool await_ready() const
+    {
+        return false;
+    }
+
+    //  a stop request for the awaiting task reaches every operation and task in the combinator
+    template < typename P >
+    bool await_suspend(std::coroutine_handle < P > continuation)
+    {
+        continuation_ = continuation;
+        std::stop_token token{};
+        if constexpr (StoppablePromise < P >)
+            token = continuation.promise().stop_source().get_token();
+        [this, &token] < size_t... I > (std::index_sequence < I... >)
+        {
+            (start < I >(token), ...);
+        }(std::index_sequence_for < A... >{});
+        started_ = true;
+        if constexpr (ANY)
+            if (winner_ != count)
+                cancel_pending();
+        return --remaining_ != 0;
+    }
+
+    auto await_resume()
+    {
+        auto results = [this] < size_t... I > (std::index_sequence < I... >)
+        {
+            return std::tuple < when_result_t < A >... >{result < I >()...};
+        }(std::index_sequence_for < A... >{});
+        if constexpr (ANY)
+            return when_any_result_t < when_result_t < A >... >{winner_, std::move(results)};
+        else
+            return results;
+    }
+
+private:
+    template < size_t I >
+    void start(std::stop_token const & token)
+    {
+        auto & s = slots_[I];
+        s.notify_ = &on_complete;
+        s.self_ = this;
+        s.index_ = I;
+        std::get < I >(awaitables_).start(s, token);
+    }
+
+    template < size_t I >
+    when_result_t < std::tuple_element_t < I, std::tuple < A... > > > result()
+    {
+        auto & a = std::get < I >(awaitables_);
+        if constexpr (std::is_void_v < decltype(a.await_resume()) >)
+        {
+            a.await_resume();
+            return {};
+        }
+        else
+        {
+            return a.await_resume();
+        }
+    }
+
+    void cancel_pending()
+    {
+        [this] < size_t... I > (std::index_sequence < I... >)
+        {
+            ((slots_[I].done_ ? void() : std::get < I >(awaitables_).cancel()), ...);
+        }(std::index_sequence_for < A... >{});
+    }
+
+    static void on_complete(ring_t::completion_t & c)
+    {
+        auto & s = static_cast < slot_t & >(c);
+        auto & self = *s.self_;
+        s.done_ = true;
+        if constexpr (ANY)
+        {
+            if (self.winner_ == count)
+            {
+                self.winner_ = s.index_;
+                if (self.started_)
+                    self.cancel_pending();
+            }
+        }
+        //  last thing, resuming may destroy the combinator
+        if (--self.remaining_ == 0)
+            self.continuation_.resume();
+    }
+};
+
+template < typename... A >
+[[nodiscard]] auto when_all(A &&... awaitables)
+{
+    return when_t < false, std::remove_cvref_t < A >... >{std::forward < A >(awaitables)...};
+}
+
+template < typename... A >
+[[nodiscard]] auto when_any(A &&... awaitables)
+{
+    return when_t < true, std::remove_cvref_t < A >... >{std::forward < A >(awaitables)...};
+}
+
+}
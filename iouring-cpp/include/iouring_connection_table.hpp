@@ -0,0 +1,133 @@
+#pragma once
+
+#include "iouring_net.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace zsl::iouring::net
+{
+
+//  request/response connections without a coroutine per connection
+//
+//  connections are accepted straight into the ring's fixed file table (multishot accept with direct descriptors)
+//  and the slot the kernel picks is the connection's index into a slab of fixed size records allocated up front,
+//  so the table's capacity is also the cap on concurrent connections.  receives pick a buffer from a provided
+//  buffer ring when data actually arrives, a connection only holds a buffer while its request is handled and its
+//  response sent, an idle one is just its record.  one timer sweeps the slab and evicts connections idle for
+//  longer than the idle timeout.  the table owns the ring's fixed file table, one table per ring
+struct connection_table_t
+{
+    struct options_t
+    {
+        uint32_t capacity_{1024};                               //  concurrent connections
+        uint32_t buffer_size_{4096};
+        uint32_t buffer_count_{256};                            //  power of two
+        uint16_t buffer_group_{0};
+        std::chrono::milliseconds idle_timeout_{std::chrono::seconds(10)};
+        std::chrono::milliseconds sweep_interval_{std::chrono::seconds(1)};
+    };
+
+    struct stats_t
+    {
+        uint64_t accepted_{};
+        uint64_t rejected_{};                                   //  accepts refused with the table full
+        uint64_t closed_{};
+        uint64_t evicted_{};                                    //  closed for being idle
+        uint64_t starved_{};                                    //  receives that found no free buffer
+        uint32_t active_{};
+    };
+
+    struct connection_t : ring_t::event_t
+    {
+        enum class state_t : uint8_t { FREE, RECEIVING, HANDLING, SENDING, STARVED, CLOSING };
+
+        connection_table_t * table_{};
+        uint64_t last_activity_{};                              //  steady clock nanoseconds
+        uint64_t bytes_in_{};
+        uint64_t bytes_out_{};
+        uint8_t const * reply_{};                               //  response being sent
+        uint32_t reply_size_{};
+        uint32_t reply_sent_{};
+        uint32_t slot_{};
+        uint32_t next_starved_{};
+        uint16_t buffer_{};                                     //  leased while sending
+        bool leased_{false};
+        state_t state_{state_t::FREE};
+    };
+
+    //  called with each chunk received, returns the response to send, empty for none.  the response may point
+    //  into the request, which stays valid until the response has been sent
+    using on_data_t = std::function < std::span < uint8_t const > (connection_t &, std::span < uint8_t const >) >;
+
+    connection_table_t(ring_t & ring, tcp_socket_t & listener, on_data_t on_data, options_t const & options = {});
+
+    //  the buffers and the fixed file table must outlive every receive and send on them, so a table that isn't
+    //  stopped() yet is stopped here and the ring run until it is, on the ring's thread.  which can't be done from
+    //  inside a completion handler, a table destroyed by one has to be stopped() already
+    ~connection_table_t();
+    connection_table_t(connection_table_t const &) = delete;
+    connection_table_t & operator = (connection_table_t const &) = delete;
+
+    //  starts accepting and sweeping
+    void start();
+
+    //  stops accepting and sweeping and closes every connection, the table is done once stopped() holds
+    void stop();
+    bool stopped() const;
+
+    void close(connection_t & c);
+
+    stats_t const & stats() const
+    {
+        return stats_;
+    }
+
+    options_t const & options() const
+    {
+        return options_;
+    }
+
+private:
+    struct table_event_t : ring_t::event_t
+    {
+        connection_table_t & table_;
+        bool armed_{false};
+    };
+
+    static void on_accept(io_uring_cqe * cqe, ring_t::event_t & e);
+    static void on_sweep(io_uring_cqe * cqe, ring_t::event_t & e);
+    static void on_connection(io_uring_cqe * cqe, ring_t::event_t & e);
+
+    void accept();
+    void sweep();
+    void receive(connection_t & c);
+    void send(connection_t & c);
+    void received(connection_t & c, io_uring_cqe const * cqe);
+    void sent(connection_t & c, io_uring_cqe const * cqe);
+    void release(connection_t & c);
+    void give_back(uint16_t const buffer);
+    uint8_t * buffer(uint16_t const id);
+
+    inline constexpr static uint32_t const no_connection{~0U};
+
+    ring_t & ring_;
+    tcp_socket_t & listener_;
+    on_data_t on_data_;
+    options_t const options_;
+    std::vector < connection_t > connections_;
+    std::unique_ptr < uint8_t[] > buffers_;
+    io_uring_buf_ring * buffer_ring_{};
+    table_event_t accept_event_{{&on_accept}, *this};
+    table_event_t sweep_event_{{&on_sweep}, *this};
+    __kernel_timespec sweep_ts_{};
+    uint32_t starved_{no_connection};                           //  head of the connections waiting for a buffer
+    bool stopping_{false};
+    stats_t stats_{};
+};
+
+}
@@ -1,11 +1,18 @@
 #pragma once
 
 #include "iouring_service.hpp"
+#include "iouring_trace.hpp"
 
 #include <logging/logging.hpp>
 
+#include <atomic>
+#include <cerrno>
+#include <concepts>
 #include <coroutine>
 #include <expected>
+#include <optional>
+#include <stop_token>
+#include <type_traits>
 
 namespace zsl::iouring::coroutine
 {
@@ -15,25 +22,153 @@ struct awaitable_t;
 
 struct awaitable_task_base_t
 {
+    //  at the final suspend point a task hands over to whoever is waiting for it.  the frame is freed by whichever
+    //  comes last, the task finishing or its awaitable_t going away, so a task nobody holds on to frees itself
+    struct final_awaiter_t
+    {
+        bool await_ready() noexcept
+        {
+            return false;
+        }
+
+        template < typename P >
+        std::coroutine_handle<> await_suspend(std::coroutine_handle < P > coroutine) noexcept
+        {
+            auto & p = coroutine.promise();
+            auto const continuation = p.continuation_;
+            auto * const completion = p.completion_;
+            if (p.released_.exchange(true, std::memory_order_acq_rel))
+            {
+                coroutine.destroy();
+                return std::noop_coroutine();
+            }
+            if (completion)
+            {
+                //  may well destroy this frame
+                completion->notify_(*completion);
+                return std::noop_coroutine();
+            }
+            return continuation ? continuation : std::noop_coroutine();
+        }
+
+        void await_resume() noexcept
+        {
+        }
+    };
+
     auto initial_suspend()
     {
         logc(this, "Initial suspend...");
+        trace::async_begin("coroutine", this);
         return std::suspend_never{};
     }
 
-    auto final_suspend() noexcept
+    final_awaiter_t final_suspend() noexcept
     {
         logc(this, "Final suspend...");
-        return std::suspend_never{};
+        trace::async_end("coroutine", this);
+        return {};
     }
 
     void unhandled_exception()
     {
     }
 
+    //  a task has no stop source of its own until something can ask it to stop: cancel(), get_stop_token(), a
+    //  std::stop_token among its arguments or the token of whoever awaits it.  a stop cancels whatever the task is
+    //  suspended on at the time, a ring operation or a task it awaits, so a task nobody can stop allocates nothing
+    //  and no operation it awaits registers a stop callback
+    struct stop_forwarder_t
+    {
+        awaitable_task_base_t & task_;
+
+        void operator () () const noexcept
+        {
+            task_.request_stop();
+        }
+    };
+
+    struct canceller_t
+    {
+        awaitable_task_base_t & task_;
+
+        void operator () () const noexcept
+        {
+            if (auto const awaited = std::exchange(task_.awaited_, {}); awaited.cancel_)
+                awaited.cancel_(awaited.what_);
+        }
+    };
+
+    using stop_link_t = std::optional < std::stop_callback < stop_forwarder_t > >;
+
+    //  what the task is suspended on, and how to cancel it
+    struct awaited_t
+    {
+        void (*cancel_)(void *){};
+        void * what_{};
+    };
+
+    std::stop_source & stop_source()
+    {
+        if (!stop_source_.stop_possible())
+        {
+            stop_source_ = std::stop_source{};
+            stop_.emplace(stop_source_.get_token(), canceller_t{*this});
+        }
+        return stop_source_;
+    }
+
+    void request_stop()
+    {
+        stop_source().request_stop();
+    }
+
+    bool stop_requested() const
+    {
+        return stop_source_.stop_requested();
+    }
+
+    //  set on suspending, cleared on resuming
+    void awaiting(void (*cancel)(void *), void * what)
+    {
+        awaited_ = {cancel, what};
+    }
+
+    static void stop_task(void * task)
+    {
+        static_cast < awaitable_task_base_t * >(task)->request_stop();
+    }
+
+    void link(stop_link_t & l, std::stop_token const & token)
+    {
+        if (token.stop_possible())
+            l.emplace(token, stop_forwarder_t{*this});
+    }
+
+    void inherit(std::stop_token const & token)
+    {
+        link(argument_stop_, token);
+    }
+
+    template < typename A >
+    void inherit(A const &)
+    {
+    }
+
     std::coroutine_handle<> continuation_{};
+    ring_t::completion_t * completion_{};
+    std::atomic < bool > released_{false};
+    std::stop_source stop_source_{std::nostopstate};
+    std::optional < std::stop_callback < canceller_t > > stop_{};
+    awaited_t awaited_{};
+    awaitable_task_base_t * awaiter_{};     //  the task awaiting this one
+    stop_link_t argument_stop_{};           //  the stop token the task was called with
+    stop_link_t awaiter_stop_{};            //  the stop token of whoever awaits the task, see start()
 };
 
+template < typename P >
+concept StoppablePromise = std::derived_from < P, awaitable_task_base_t >;
+
 template < typename T >
 struct awaitable_result_t
 {
@@ -44,7 +179,7 @@ struct awaitable_result_t
 
     T get()
     {
-        return std::exchange(v_, std::unexpected(-1)).value();
+        return std::move(*std::exchange(v_, std::nullopt));
     }
 
     void return_value(T && v)
@@ -52,7 +187,7 @@ struct awaitable_result_t
         set(std::move(v));
     }
     
-    T v_{std::unexpected(-1)};
+    std::optional < T > v_{};
 };
 
 template <>
@@ -61,6 +196,10 @@ struct awaitable_result_t < void >
     void return_void()
     {
     }
+
+    void get()
+    {
+    }
 };
 
 template < typename T = void >
@@ -70,9 +209,10 @@ struct awaitable_task_t : awaitable_task_base_t, awaitable_result_t < T >
     coroutine_t coroutine_{nullptr};
 
     template < typename... Args >
-    awaitable_task_t(Args &&...)
+    awaitable_task_t(Args const &... args)
     {
         logc(this, "Creating task...");
+        (inherit(args), ...);
     }
 
     awaitable_task_t()
@@ -89,40 +229,112 @@ struct awaitable_task_t : awaitable_task_base_t, awaitable_result_t < T >
     }
 };
 
+//  a task starts running as soon as it's called; co_await it to wait for its result, or drop it to let it run on
+//  its own.  awaiting a task is for coroutines on the thread it finishes on
 template < typename T >
 struct awaitable_t
 {
     using coroutine_t = awaitable_task_t < T >::coroutine_t;
     coroutine_t coroutine_{};
 
+    explicit awaitable_t(coroutine_t coroutine) : coroutine_{coroutine}
+    {
+    }
+
+    awaitable_t(awaitable_t && rhs) : coroutine_{std::exchange(rhs.coroutine_, nullptr)}
+    {
+    }
+
+    awaitable_t(awaitable_t const &) = delete;
+    awaitable_t & operator = (awaitable_t const &) = delete;
+    awaitable_t & operator = (awaitable_t &&) = delete;
+
+    ~awaitable_t()
+    {
+        if (coroutine_ && coroutine_.promise().released_.exchange(true, std::memory_order_acq_rel))
+            coroutine_.destroy();
+    }
+
     bool await_ready()
     {
         logc(this, "Await ready...");
-        return false;
+        return coroutine_.done();
     }
 
-    template < typename U >
-    void await_suspend(std::coroutine_handle < awaitable_task_t < U > > continuation)
+    template < typename P >
+    void await_suspend(std::coroutine_handle < P > continuation)
     {
+        if constexpr (StoppablePromise < P >)
+        {
+            auto & awaiter = continuation.promise();
+            coroutine_.promise().awaiter_ = &awaiter;
+            awaiter.awaiting(&awaitable_task_base_t::stop_task, &coroutine_.promise());
+            if (awaiter.stop_requested())
+                coroutine_.promise().request_stop();
+        }
         coroutine_.promise().continuation_ = continuation;
-        log("Suspending... coroutine_ = {} coroutine_.continuation_ = {}", coroutine_, coroutine_.promise().continuation_);
+        logc(this, "Suspending... coroutine_ = {} continuation = {}", coroutine_, continuation);
     }
 
-    void await_resume()
+    T await_resume()
     {
         logc(this, "Resuming...");
-        // if constexpr (!std::is_same_v < T, void >)
-        // {
-        //     T * v{};
-        //     // if (v.has_value())
-        //     //     logc(this, "Got... value {}", v.value());
-        //     // else
-        //     //     logc(this, "Got... error {}", v.error());
-        //     return std::move(*v);
-        // }
+        if (auto * const awaiter = coroutine_.promise().awaiter_)
+            awaiter->awaiting(nullptr, nullptr);
+        return coroutine_.promise().get();
+    }
+
+    //  completion reported to c instead of resuming an awaiting coroutine, see when_all and when_any
+    void start(ring_t::completion_t & c)
+    {
+        if (coroutine_.done())
+            c.notify_(c);
+        else
+            coroutine_.promise().completion_ = &c;
+    }
+
+    //  completion reported to c instead of resuming an awaiting coroutine, see when_all and when_any
+    void start(ring_t::completion_t & c, std::stop_token const & token)
+    {
+        coroutine_.promise().link(coroutine_.promise().awaiter_stop_, token);
+        start(c);
+    }
+
+    //  asks the task to stop, whatever it's waiting for on the ring completes with -ECANCELED
+    void cancel()
+    {
+        coroutine_.promise().request_stop();
     }
 };
 
+//  co_await get_stop_token() gives a task its stop token, to pass on to the tasks it starts
+struct get_stop_token_t
+{
+    std::stop_token token_{};
+
+    bool await_ready() const
+    {
+        return false;
+    }
+
+    template < StoppablePromise P >
+    bool await_suspend(std::coroutine_handle < P > coroutine)
+    {
+        token_ = coroutine.promise().stop_source().get_token();
+        return false;
+    }
+
+    std::stop_token await_resume()
+    {
+        return std::move(token_);
+    }
+};
+
+inline get_stop_token_t get_stop_token()
+{
+    return {};
+}
+
 struct ring_awaitable_base_t
 {
     ring_t & ring_;
@@ -140,13 +352,27 @@ template < typename T, typename E >
 struct ring_awaitable_t : ring_awaitable_base_t
 {
     E e_;
+
+    //  stop requests have to come from the ring's thread, from anywhere else go through ring_t::post
+    struct canceller_t
+    {
+        ring_awaitable_t & self_;
+
+        void operator () () const noexcept
+        {
+            self_.cancel();
+        }
+    };
+    std::optional < std::stop_callback < canceller_t > > stop_{};
+    awaitable_task_base_t * task_{};        //  the task awaiting the operation
+    bool started_{false};                   //  submitted, rather than failed for a stop requested beforehand
  
     template < typename... Args >
     constexpr explicit ring_awaitable_t(ring_t & ring, Args &&... args) : ring_awaitable_base_t{ring, e_}, e_{std::forward < Args >(args)...}
     {
     }
 
-    constexpr ring_awaitable_t(ring_awaitable_t && rhs) : ring_awaitable_base_t{std::move(rhs.ring_), this->e_}, e_{std::move(rhs.e_)}
+    constexpr ring_awaitable_t(ring_awaitable_t && rhs) : ring_awaitable_base_t{rhs.ring_, this->e_}, e_{std::move(rhs.e_)}
     {
     }
 
@@ -156,23 +382,88 @@ struct ring_awaitable_t : ring_awaitable_base_t
 
     void submit();
 
+    //  the operation is never submitted and fails right away
+    void stopped()
+    {
+        if constexpr (!std::is_same_v < T, void >)
+            std::exchange(this->e_.response_.result_, std::unexpected(-ECANCELED));
+    }
+
+    //  false when stop has already been requested
+    bool watch(std::stop_token const & token)
+    {
+        if (token.stop_requested())
+        {
+            stopped();
+            return false;
+        }
+        if (token.stop_possible())
+            stop_.emplace(token, canceller_t{*this});
+        return true;
+    }
+
+    static void stop_operation(void * self)
+    {
+        static_cast < ring_awaitable_t * >(self)->cancel();
+    }
+
     constexpr bool await_ready()
     {
         logc(this, "Await ready... ring_ = {} event_ = {} event_.coroutine_ = {} event_.handler_ = {}", &ring_, &event_, event_.coroutine_, event_.handler_);
         return false;
     }
 
+    //  false, i.e. carry on without suspending, when the awaiting task has already been asked to stop
     template < typename U >
-    void await_suspend(typename std::coroutine_handle < U > coroutine)
+    bool await_suspend(typename std::coroutine_handle < U > coroutine)
     {
         event_.coroutine_ = coroutine;
+        if constexpr (StoppablePromise < U >)
+        {
+            auto & task = coroutine.promise();
+            if (task.stop_requested())
+            {
+                stopped();
+                return false;
+            }
+            task.awaiting(&stop_operation, this);
+            task_ = &task;
+        }
+        trace::async_begin(trace::name_of < E >(), &event_, coroutine.address());
+        started_ = true;
         submit();
         logc(this, "Suspending ... ring_ = {} event_ = {} event_.coroutine_ = {} event_.handler_ = {}", &ring_, &event_, event_.coroutine_, event_.handler_);
+        return true;
+    }
+
+    //  completion reported to c instead of resuming an awaiting coroutine, see when_all and when_any
+    void start(ring_t::completion_t & c, std::stop_token const & token = {})
+    {
+        event_.completion_ = &c;
+        if (!watch(token))
+        {
+            c.notify_(c);
+            return;
+        }
+        trace::async_begin(trace::name_of < E >(), &event_);
+        started_ = true;
+        submit();
+    }
+
+    void cancel()
+    {
+        ring_.cancel(event_);
+        ring_.submit();
     }
 
     T await_resume()
     {
         logc(this, "Resuming... ring_ = {} event_ = {} event_.coroutine_ = {} event_.handler_ = {}", &ring_, &event_, event_.coroutine_, event_.handler_);
+        stop_.reset();
+        if (task_)
+            std::exchange(task_, nullptr)->awaiting(nullptr, nullptr);
+        if (std::exchange(started_, false))
+            trace::async_end(trace::name_of < E >(), &event_, event_.coroutine_.address());
         if constexpr (!std::is_same_v < T, void >)
         {
             T v = std::exchange(this->e_.response_.result_, std::unexpected(-1));
@@ -0,0 +1,308 @@
+#pragma once
+
+#include "iouring_net.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <climits>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include <sys/uio.h>
+
+//  length prefixed message framing over a stream socket
+//
+//      framed_reader_t < u32_header_t > reader{socket};
+//      while (auto f = co_await reader.next())
+//          handle(f.value());
+//
+//      framed_writer_t < u32_header_t > writer{socket};
+//      writer.push(a);
+//      writer.push(b);
+//      co_await writer.flush();
+//
+//  the reader receives into a ring buffer mapped twice back to back, so a frame straddling the end of the ring is
+//  still one contiguous span and frames are handed out without copying.  the writer queues frames and sends them
+//  all, headers and payloads, with one sendmsg
+
+namespace zsl::iouring::net::framing
+{
+
+struct decoded_t
+{
+    uint32_t length_{};         //  of the payload
+    uint32_t size_{};           //  of the header
+};
+
+//  decode returns nothing while the header is incomplete, encode returns the header size
+template < typename H >
+concept Header = requires (std::span < uint8_t const > in, uint32_t const length, uint8_t * out)
+{
+    { H::max_size } -> std::convertible_to < size_t >;
+    { H::max_length } -> std::convertible_to < uint32_t >;
+    { H::decode(in) } -> std::same_as < std::optional < decoded_t > >;
+    { H::encode(length, out) } -> std::same_as < uint32_t >;
+};
+
+namespace detail
+{
+
+template < std::unsigned_integral T >
+constexpr T to_big_endian(T const v)
+{
+    if constexpr (std::endian::native == std::endian::little)
+        return std::byteswap(v);
+    else
+        return v;
+}
+
+//  fixed size big endian length
+template < std::unsigned_integral T >
+struct fixed_header_t
+{
+    inline constexpr static size_t const max_size{sizeof(T)};
+    inline constexpr static uint32_t const max_length{std::numeric_limits < T >::max()};
+
+    static std::optional < decoded_t > decode(std::span < uint8_t const > const in)
+    {
+        if (in.size() < sizeof(T))
+            return std::nullopt;
+        T v;
+        std::memcpy(&v, in.data(), sizeof(T));
+        return decoded_t{.length_ = to_big_endian(v), .size_ = sizeof(T)};
+    }
+
+    static uint32_t encode(uint32_t const length, uint8_t * out)
+    {
+        auto const v = to_big_endian(static_cast < T >(length));
+        std::memcpy(out, &v, sizeof(T));
+        return sizeof(T);
+    }
+};
+
+}
+
+using u16_header_t = detail::fixed_header_t < uint16_t >;
+using u32_header_t = detail::fixed_header_t < uint32_t >;
+
+//  LEB128, seven bits a byte, low bits first
+struct varint_header_t
+{
+    inline constexpr static size_t const max_size{5};
+    inline constexpr static uint32_t const max_length{std::numeric_limits < uint32_t >::max() - 1};
+
+    static std::optional < decoded_t > decode(std::span < uint8_t const > const in)
+    {
+        uint64_t length{0};
+        for (uint32_t i = 0; i < std::min(in.size(), max_size); ++i)
+        {
+            length |= uint64_t{in[i] & 0x7fU} << (7 * i);
+            if ((in[i] & 0x80U) == 0)
+                return decoded_t{.length_ = static_cast < uint32_t >(std::min < uint64_t >(length, max_length)), .size_ = i + 1};
+        }
+        if (in.size() < max_size)
+            return std::nullopt;
+        //  over long, decodes to a length no buffer holds
+        return decoded_t{.length_ = std::numeric_limits < uint32_t >::max(), .size_ = max_size};
+    }
+
+    static uint32_t encode(uint32_t length, uint8_t * out)
+    {
+        uint32_t size{0};
+        while (length >= 0x80U)
+        {
+            out[size++] = static_cast < uint8_t >(length | 0x80U);
+            length >>= 7;
+        }
+        out[size++] = static_cast < uint8_t >(length);
+        return size;
+    }
+};
+
+//  capacity bytes of memory mapped twice in a row, data()[i] and data()[i + capacity()] are the same byte so any
+//  capacity() bytes from any offset are contiguous.  capacity is rounded up to whole pages
+struct mirrored_buffer_t
+{
+    explicit mirrored_buffer_t(size_t const capacity);
+    ~mirrored_buffer_t();
+
+    mirrored_buffer_t(mirrored_buffer_t const &) = delete;
+    mirrored_buffer_t & operator = (mirrored_buffer_t const &) = delete;
+
+    mirrored_buffer_t(mirrored_buffer_t && rhs) noexcept : data_{std::exchange(rhs.data_, nullptr)}, capacity_{std::exchange(rhs.capacity_, 0)}
+    {
+    }
+
+    uint8_t * data() const
+    {
+        return data_;
+    }
+
+    size_t capacity() const
+    {
+        return capacity_;
+    }
+
+private:
+    uint8_t * data_{};
+    size_t capacity_{};
+};
+
+//  frames received from a socket
+//
+//  a frame handed out stays valid until the next call to next() or try_next().  frames larger than the buffer fail
+//  with -EMSGSIZE, the stream can't be resynchronised after that
+template < Header H >
+struct framed_reader_t
+{
+    using frame_result_t = expected_t < std::span < uint8_t const >, int32_t >;
+
+    inline constexpr static size_t const default_capacity{64 * 1024};
+
+    explicit framed_reader_t(socket_t & socket, size_t const capacity = default_capacity) : socket_{socket}, buffer_{capacity}
+    {
+    }
+
+    //  the next frame, receiving until one is complete.  fails with whatever recv failed with, 0 when the peer closed
+    coroutine::awaitable_t < frame_result_t > next()
+    {
+        while (true)
+        {
+            if (auto f = try_next(); f.has_value() || f.error() != -EAGAIN)
+                co_return std::move(f);
+            auto rr = co_await socket_.recv(writable());
+            if (!rr.has_value())
+                co_return std::unexpected(rr.error());
+            tail_ += static_cast < uint64_t >(rr.value());
+        }
+    }
+
+    //  the next frame already buffered, -EAGAIN when more has to be received first
+    frame_result_t try_next()
+    {
+        head_ += std::exchange(consumed_, 0);
+        auto const available = tail_ - head_;
+        auto const * const at = buffer_.data() + head_ % buffer_.capacity();
+        auto const header = H::decode(std::span < uint8_t const >{at, available});
+        if (!header)
+            return std::unexpected(-EAGAIN);
+        auto const size = uint64_t{header->size_} + header->length_;
+        if (size > buffer_.capacity())
+            return std::unexpected(-EMSGSIZE);
+        if (size > available)
+            return std::unexpected(-EAGAIN);
+        consumed_ = size;
+        return std::span < uint8_t const >{at + header->size_, header->length_};
+    }
+
+    //  received and not yet handed out
+    size_t buffered() const
+    {
+        return tail_ - head_ - consumed_;
+    }
+
+private:
+    std::span < uint8_t > writable()
+    {
+        auto const used = tail_ - head_;
+        return {buffer_.data() + tail_ % buffer_.capacity(), buffer_.capacity() - used};
+    }
+
+    socket_t & socket_;
+    mirrored_buffer_t buffer_;
+    uint64_t head_{};           //  start of the first frame not handed out, or of the one handed out last
+    uint64_t tail_{};           //  end of what's been received
+    uint64_t consumed_{};       //  size of the frame handed out last, released on the next call
+};
+
+//  frames sent to a socket, queued and then flushed with as few sendmsg as IOV_MAX allows
+//
+//  payloads aren't copied and have to stay alive until the flush completes
+template < Header H >
+struct framed_writer_t
+{
+    explicit framed_writer_t(socket_t & socket) : socket_{socket}
+    {
+    }
+
+    void push(std::span < uint8_t const > const payload)
+    {
+        if (payload.size() > H::max_length)
+            throw std::length_error("frame too long for its header");
+        auto & f = frames_.emplace_back();
+        f.header_size_ = H::encode(static_cast < uint32_t >(payload.size()), f.header_.data());
+        f.payload_ = payload;
+    }
+
+    template < SizedBuffer T >
+    void push(T const & payload)
+    {
+        push(std::span(std::bit_cast < uint8_t const * >(std::ranges::data(payload)), std::ranges::size(payload) * sizeof(std::ranges::range_value_t < T >)));
+    }
+
+    size_t pending() const
+    {
+        return frames_.size();
+    }
+
+    //  sends every queued frame, short sends are carried on from where they stopped.  the queue is emptied either way
+    coroutine::awaitable_t < socket_t::send_result_t > flush()
+    {
+        iov_.clear();
+        for (auto & f : frames_)
+        {
+            iov_.push_back({f.header_.data(), f.header_size_});
+            if (!f.payload_.empty())
+                iov_.push_back({const_cast < uint8_t * >(f.payload_.data()), f.payload_.size()});
+        }
+
+        ssize_t sent{0};
+        size_t first{0};
+        while (first < iov_.size())
+        {
+            auto const count = std::min < size_t >(iov_.size() - first, IOV_MAX);
+            auto sr = co_await socket_.sendv(std::span < iovec const >{iov_.data() + first, count});
+            if (!sr.has_value() || sr.value() == 0)
+            {
+                frames_.clear();
+                co_return sr.has_value() ? socket_t::send_result_t{std::unexpected(-EPIPE)} : std::move(sr);
+            }
+            sent += sr.value();
+            for (auto left = static_cast < size_t >(sr.value()); left > 0; )
+            {
+                auto & v = iov_[first];
+                if (left < v.iov_len)
+                {
+                    v.iov_base = static_cast < uint8_t * >(v.iov_base) + left;
+                    v.iov_len -= left;
+                    break;
+                }
+                left -= v.iov_len;
+                ++first;
+            }
+        }
+        frames_.clear();
+        co_return socket_t::send_result_t{sent};
+    }
+
+private:
+    struct frame_t
+    {
+        std::array < uint8_t, H::max_size > header_{};
+        uint32_t header_size_{};
+        std::span < uint8_t const > payload_{};
+    };
+
+    socket_t & socket_;
+    std::vector < frame_t > frames_{};
+    std::vector < iovec > iov_{};
+};
+
+}
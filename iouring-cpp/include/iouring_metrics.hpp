@@ -0,0 +1,187 @@
+#pragma once
+
+#include "iouring_utils_histogram.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace zsl::iouring::metrics
+{
+
+//  ring_t counters
+//
+//  every value has a single writer, the ring's thread, which updates it with a relaxed load and store rather than
+//  a read-modify-write, so on x86 a counter costs what a plain increment does.  any other thread may take a
+//  snapshot() at any time; each value in it is exact but values are read one after the other, not as a transaction
+inline constexpr uint32_t const op_count{64};   //  io_uring opcodes are well below this (IORING_OP_LAST)
+
+using latency_histogram_t = utils::histogram::histogram_t < 5 >;
+
+struct counter_t
+{
+    void add(uint64_t const n = 1)
+    {
+        v_.store(v_.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    void set(uint64_t const v)
+    {
+        v_.store(v, std::memory_order_relaxed);
+    }
+
+    uint64_t load() const
+    {
+        return v_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic < uint64_t > v_{};
+};
+
+//  last observed value and high water mark
+struct gauge_t
+{
+    void set(uint64_t const v)
+    {
+        last_.set(v);
+        if (v > max_.load())
+            max_.set(v);
+    }
+
+    counter_t last_{};
+    counter_t max_{};
+};
+
+//  bucket counts only, a snapshot places every sample at the low end of its bucket
+struct atomic_latency_histogram_t
+{
+    void record(uint64_t const v)
+    {
+        counts_[latency_histogram_t::index_of(v)].add();
+    }
+
+    latency_histogram_t snapshot() const
+    {
+        latency_histogram_t h;
+        for (uint32_t i = 0; i < latency_histogram_t::bucket_count; ++i)
+            if (auto const n = counts_[i].load(); n != 0)
+                h.record(latency_histogram_t::lowest_equivalent(i), n);
+        return h;
+    }
+
+private:
+    std::array < counter_t, latency_histogram_t::bucket_count > counts_{};
+};
+
+struct op_snapshot_t
+{
+    uint64_t submitted_{};
+    uint64_t completed_{};
+    uint64_t errors_{};             //  completions with a negative result
+};
+
+//  prepare to completion in nanoseconds per opcode, only while latency tracking is on.  kept out of snapshot_t,
+//  at several KB a histogram it's too big to return by value, ring_t::latencies fills one in place
+struct latencies_t
+{
+    std::array < latency_histogram_t, op_count > ops_{};
+};
+
+struct snapshot_t
+{
+    std::array < op_snapshot_t, op_count > ops_{};
+    uint64_t submits_{};            //  io_uring_submit calls
+    uint64_t waits_{};              //  wait_for_events calls
+    uint64_t completions_{};        //  CQEs reaped
+    uint64_t handler_ns_{};         //  time spent in completion handlers, only while latency tracking is on
+    uint64_t sq_pending_{};         //  SQEs handed to the kernel by the last submit
+    uint64_t sq_pending_max_{};
+    uint64_t cq_backlog_{};         //  CQEs ready when the last wait returned
+    uint64_t cq_backlog_max_{};
+    uint64_t cq_overflow_{};        //  CQEs the kernel couldn't post to the CQ ring
+    uint64_t cq_overflow_events_{}; //  waits that found the CQ ring overflown
+    uint64_t wakeups_{};            //  eventfd wakeups from other threads
+    uint64_t posted_{};             //  posted work run
+    uint64_t spin_ns_{};            //  time spent polling the CQ ring from user space, see ring_t::run_mode
+    uint64_t idle_ns_{};            //  time spent asleep in the kernel waiting for completions
+    uint64_t spin_hits_{};          //  waits the spinning saw through
+    uint64_t spin_misses_{};        //  waits the spinning gave up on, to sleep or time out
+};
+
+struct op_metrics_t
+{
+    counter_t submitted_{};
+    counter_t completed_{};
+    counter_t errors_{};
+    atomic_latency_histogram_t latency_{};
+};
+
+struct ring_metrics_t
+{
+    std::array < op_metrics_t, op_count > ops_{};
+    counter_t submits_{};
+    counter_t waits_{};
+    counter_t completions_{};
+    counter_t handler_ns_{};
+    gauge_t sq_pending_{};
+    gauge_t cq_backlog_{};
+    counter_t cq_overflow_{};
+    counter_t cq_overflow_events_{};
+    counter_t wakeups_{};
+    counter_t posted_{};
+    counter_t spin_ns_{};
+    counter_t idle_ns_{};
+    counter_t spin_hits_{};
+    counter_t spin_misses_{};
+
+    void prepared(uint8_t const opcode)
+    {
+        ops_[opcode % op_count].submitted_.add();
+    }
+
+    void completed(uint8_t const opcode, int32_t const res)
+    {
+        auto & op = ops_[opcode % op_count];
+        op.completed_.add();
+        if (res < 0)
+            op.errors_.add();
+    }
+
+    snapshot_t snapshot() const
+    {
+        snapshot_t s;
+        for (uint32_t i = 0; i < op_count; ++i)
+        {
+            auto & o = s.ops_[i];
+            o.submitted_ = ops_[i].submitted_.load();
+            o.completed_ = ops_[i].completed_.load();
+            o.errors_ = ops_[i].errors_.load();
+        }
+        s.submits_ = submits_.load();
+        s.waits_ = waits_.load();
+        s.completions_ = completions_.load();
+        s.handler_ns_ = handler_ns_.load();
+        s.sq_pending_ = sq_pending_.last_.load();
+        s.sq_pending_max_ = sq_pending_.max_.load();
+        s.cq_backlog_ = cq_backlog_.last_.load();
+        s.cq_backlog_max_ = cq_backlog_.max_.load();
+        s.cq_overflow_ = cq_overflow_.load();
+        s.cq_overflow_events_ = cq_overflow_events_.load();
+        s.wakeups_ = wakeups_.load();
+        s.posted_ = posted_.load();
+        s.spin_ns_ = spin_ns_.load();
+        s.idle_ns_ = idle_ns_.load();
+        s.spin_hits_ = spin_hits_.load();
+        s.spin_misses_ = spin_misses_.load();
+        return s;
+    }
+
+    void latencies(latencies_t & l) const
+    {
+        for (uint32_t i = 0; i < op_count; ++i)
+            l.ops_[i] = ops_[i].submitted_.load() != 0 ? ops_[i].latency_.snapshot() : latency_histogram_t{};
+    }
+};
+
+}
@@ -37,6 +37,59 @@ using ipaddressv6_t = types::typed_bounded_estring_t < tag_ipaddressv6_t, INET6_
 struct tag_hostname_t;
 using hostname_t = types::typed_bounded_estring_t < tag_hostname_t, HOST_NAME_MAX - 1 >;
 
+//  kernel pipe used as the in-kernel staging buffer for splice/tee
+struct pipe_t
+{
+    inline constexpr static size_t default_capacity{64 * 1024};
+
+    pipe_t() = default;
+    explicit pipe_t(size_t const capacity);
+    ~pipe_t();
+
+    pipe_t(pipe_t const &) = delete;
+    pipe_t & operator = (pipe_t const &) = delete;
+
+    pipe_t(pipe_t && rhs) noexcept : read_fd_{std::exchange(rhs.read_fd_, invalid_fd)}, write_fd_{std::exchange(rhs.write_fd_, invalid_fd)}, capacity_{rhs.capacity_}
+    {
+    }
+
+    pipe_t & operator = (pipe_t && rhs) noexcept
+    {
+        if (this != &rhs)
+        {
+            read_fd_ = std::exchange(rhs.read_fd_, read_fd_);
+            write_fd_ = std::exchange(rhs.write_fd_, write_fd_);
+            capacity_ = std::exchange(rhs.capacity_, capacity_);
+        }
+        return *this;
+    }
+
+    constexpr bool is_valid() const noexcept
+    {
+        return read_fd_ != invalid_fd && write_fd_ != invalid_fd;
+    }
+
+    constexpr auto read_fd() const
+    {
+        return read_fd_;
+    }
+
+    constexpr auto write_fd() const
+    {
+        return write_fd_;
+    }
+
+    constexpr auto capacity() const
+    {
+        return capacity_;
+    }
+
+private:
+    fd_t read_fd_{invalid_fd};
+    fd_t write_fd_{invalid_fd};
+    size_t capacity_{};
+};
+
 struct socket_t
 {
 protected:
@@ -76,6 +129,14 @@ public:
 
     bool bind(ipaddressv4_t const ip, ipport_t const port);
 
+    //  SO_REUSEADDR, a listener can bind its port again while connections it closed sit in TIME_WAIT
+    bool reuse_address(bool const on = true);
+
+    //  SO_BUSY_POLL, the socket polls its device queue for up to timeout when a receive on it finds nothing there,
+    //  and with prefer its NAPI instance is left to busy pollers rather than interrupts.  raising it past
+    //  net.core.busy_read takes CAP_NET_ADMIN.  see also ring_t::busy_poll
+    bool busy_poll(duration_t const timeout, bool const prefer = true);
+
     enum class connect_status_t : bool { FAILED, SUCCEEDED };
     using connect_result_t = expected_t < connect_status_t, int32_t >;
     struct connect_event_t : ring_t::event_t
@@ -140,6 +201,34 @@ public:
         return send(std::span(std::bit_cast < uint8_t const * >(std::ranges::data(buf)), std::ranges::size(buf)));
     }
 
+    //  gathered send, every buffer in one sendmsg.  the iovecs have to stay put until the send completes
+    struct sendv_event_t : ring_t::event_t
+    {
+        struct context_t
+        {
+            socket_t & self_;
+            msghdr msg_{};
+        };
+        context_t context_;
+
+        struct request_t
+        {
+            std::span < iovec const > iov_{};
+        };
+        request_t request_{};
+
+        struct response_t
+        {
+            send_result_t result_{std::unexpected(-1)};
+        };
+        response_t response_{};
+    };
+    using sendv_awaitable_t = coroutine::ring_awaitable_t < send_result_t, sendv_event_t >;
+
+    static void on_sendv(io_uring_cqe * cqe, ring_t::event_t & e);
+
+    sendv_awaitable_t sendv(std::span < iovec const > iov);
+
     using recv_result_t = expected_t < ssize_t /* num bytes received */, int32_t >;
     struct recv_event_t : ring_t::event_t
     {
@@ -175,14 +264,60 @@ public:
         return recv(std::span(std::bit_cast < uint8_t  * >(std::ranges::data(buf)), std::ranges::size(buf)));
     }
 
-protected:
-    ring_t * ring_{};
-    socket_fd_t fd_{-1};
+    //  file to socket streaming through a pipe, the payload never enters user space
+    //
+    //  the file is moved in chunks of at most the pipe capacity, each chunk going back through the event loop so
+    //  multi-GB transfers don't starve other connections.  every chunk is linked to a timeout for whatever is left
+    //  until the deadline.  length may be larger than the file, the transfer then completes at EOF
+    using send_file_result_t = expected_t < uint64_t /* num bytes sent */, int32_t >;
+    using send_file_progress_t = std::function < void (uint64_t /* sent */, uint64_t /* total */) >;
+    struct send_file_event_t : ring_t::event_t
+    {
+        enum class stage_t : uint8_t { FILL, DRAIN, EXPIRED };
+
+        struct context_t
+        {
+            socket_t & self_;
+            pipe_t pipe_{};
+            stage_t stage_{stage_t::FILL};
+            uint64_t filled_{};
+            uint32_t pending_{};
+            __kernel_timespec timeout_{};
+        };
+        context_t context_;
+
+        struct request_t
+        {
+            fd_t file_{invalid_fd};
+            uint64_t offset_{};
+            uint64_t length_{};
+            deadline_t deadline_{deadline_t::max()};
+            send_file_progress_t progress_{};
+        };
+        request_t request_{};
+
+        struct response_t
+        {
+            uint64_t sent_{};
+            send_file_result_t result_{std::unexpected(-1)};
+        };
+        response_t response_{};
+    };
+    using send_file_task_t = coroutine::awaitable_task_t < send_file_result_t >;
+    using send_file_awaitable_t = coroutine::ring_awaitable_t < send_file_result_t, send_file_event_t >;
+
+    static void on_send_file(io_uring_cqe * cqe, ring_t::event_t & e);
+
+    send_file_awaitable_t send_file(fd_t const file, uint64_t const offset, uint64_t const length, deadline_t const deadline = deadline_t::max(), send_file_progress_t progress = {}, size_t const chunk_size = pipe_t::default_capacity);
 
     ring_t & ring()
     {
         return *ring_;
     }
+
+protected:
+    ring_t * ring_{};
+    socket_fd_t fd_{-1};
 };
 
 struct tcp_socket_t : socket_t
@@ -199,7 +334,7 @@ struct tcp_socket_t : socket_t
     tcp_socket_t(tcp_socket_t &&) = default;
     tcp_socket_t & operator = (tcp_socket_t &&) = default;
 
-    bool listen();
+    bool listen(int32_t const backlog = 8);
 
     struct acceptor_t;
     acceptor_t acceptor();
@@ -254,15 +389,16 @@ inline tcp_socket_t::acceptor_t tcp_socket_t::acceptor()
     return acceptor_t{ring(), *this};
 }
 
-inline auto tcp_server(ring_t & ring, ipaddressv4_t const & ip, ipport_t const & port)
+inline auto tcp_server(ring_t & ring, ipaddressv4_t const & ip, ipport_t const & port, int32_t const backlog = 8)
 {
     tcp_socket_t s{ring};
+    s.reuse_address();
     while (!s.bind(ip, port))
     {
         log("Couldn't bind...  will try in 5 seconds");
         std::this_thread::sleep_for(std::chrono::seconds(5));
     }
-    if (!s.listen())
+    if (!s.listen(backlog))
         throw std::runtime_error("Can't listen");
     return s;
 }
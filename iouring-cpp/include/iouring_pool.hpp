@@ -0,0 +1,99 @@
+#pragma once
+
+#include "iouring_utils_deque.hpp"
+#include "iouring_utils_mpsc.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <coroutine>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace zsl::iouring::pool
+{
+
+//  work stealing thread pool for coroutines
+//
+//  co_await pool.schedule() continues a coroutine on one of the pool's workers, co_await ring.schedule() brings it
+//  back to the ring's thread, so compute heavy steps don't hold up completions.  the node handed over lives in the
+//  awaitable, i.e. in the awaiting coroutine's frame, nothing is allocated per hop.  a worker runs its own deque
+//  newest first, work scheduled from outside the pool lands in a shared inbox any worker drains into its deque, and
+//  idle workers steal the oldest work from the others before going to sleep
+struct pool_t
+{
+    struct task_t
+    {
+        task_t * next_{};                   //  inbox link
+        std::coroutine_handle<> coroutine_{};
+    };
+
+    struct schedule_awaitable_t : task_t
+    {
+        pool_t & pool_;
+
+        bool await_ready() const
+        {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> coroutine)
+        {
+            coroutine_ = coroutine;
+            pool_.submit(*this);
+        }
+
+        void await_resume() const
+        {
+        }
+    };
+
+    //  destroy the pool only once nothing is scheduled on it any more, pending coroutines are not resumed
+    explicit pool_t(uint32_t const workers = std::max(1U, std::thread::hardware_concurrency()));
+    ~pool_t();
+    pool_t(pool_t const &) = delete;
+    pool_t & operator = (pool_t const &) = delete;
+
+    [[nodiscard]] schedule_awaitable_t schedule()
+    {
+        return schedule_awaitable_t{{}, *this};
+    }
+
+    //  any thread; t must stay alive until its coroutine has been resumed
+    void submit(task_t & t);
+
+    uint32_t size() const
+    {
+        return static_cast < uint32_t >(workers_.size());
+    }
+
+    //  tasks workers took from each other, for tuning
+    uint64_t steals() const
+    {
+        return steals_.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct worker_t
+    {
+        pool_t & pool_;
+        uint32_t index_;
+        utils::work_stealing::deque_t < task_t > deque_{};
+        std::jthread thread_{};
+    };
+
+    void run(worker_t & w);
+    task_t * next(worker_t & w);
+    bool has_work() const;
+    void wake();
+
+    std::vector < std::unique_ptr < worker_t > > workers_{};
+    //  every worker takes from it, which is fine as take() is a single exchange and each gets a batch of its own
+    utils::mpsc::queue_t < task_t > inbox_{};
+    std::atomic < uint32_t > sleepers_{0};
+    std::atomic < uint32_t > epoch_{0};         //  bumped to wake sleepers
+    std::atomic < bool > stopping_{false};
+    std::atomic < uint64_t > steals_{0};
+};
+
+}
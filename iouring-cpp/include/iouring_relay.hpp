@@ -0,0 +1,88 @@
+#pragma once
+
+#include "iouring_net.hpp"
+
+#include <span>
+#include <vector>
+
+namespace zsl::iouring::net
+{
+
+//  zero-copy socket to socket(s) forwarding
+//
+//  payload is spliced from the source socket into a pipe and from the pipe into the destination, it never
+//  enters user space.  with several destinations every extra one gets its own pipe which is fed with tee(2)
+//  from the source pipe before the source pipe is drained into the first destination
+struct relay_stats_t
+{
+    uint64_t bytes_in_{};       //  spliced from the source into the pipe
+    uint64_t bytes_out_{};      //  spliced out of the pipes, summed over all destinations
+    uint64_t splices_{};
+    uint64_t tees_{};
+    uint64_t rounds_{};         //  source reads
+};
+
+using relay_result_t = expected_t < relay_stats_t, int32_t >;
+
+struct relay_event_t : ring_t::event_t
+{
+    enum class stage_t : uint8_t { SPLICE_IN, TEE, SPLICE_OUT, DRAIN };
+
+    struct target_t
+    {
+        socket_t * socket_{};
+        pipe_t pipe_{};             //  unused for the first destination, which drains the source pipe
+        uint32_t pending_{};
+    };
+
+    struct context_t
+    {
+        socket_t & from_;
+        std::vector < target_t > to_{};
+        pipe_t pipe_{};
+        stage_t stage_{stage_t::SPLICE_IN};
+        size_t target_{};
+        uint32_t pending_{};
+    };
+    context_t context_;
+
+    struct request_t
+    {
+        uint32_t chunk_size_{};
+    };
+    request_t request_{};
+
+    struct response_t
+    {
+        relay_stats_t stats_{};
+        relay_result_t result_{std::unexpected(-1)};
+    };
+    response_t response_{};
+};
+
+using relay_task_t = coroutine::awaitable_task_t < relay_result_t >;
+using relay_awaitable_t = coroutine::ring_awaitable_t < relay_result_t, relay_event_t >;
+
+void on_relay(io_uring_cqe * cqe, ring_t::event_t & e);
+
+//  completes when the source reaches EOF (with the transfer counters) or when any leg fails (with -errno)
+relay_awaitable_t relay(socket_t & from, socket_t & to, size_t const chunk_size = pipe_t::default_capacity);
+
+//  fan-out: every destination receives the full stream
+relay_awaitable_t relay(socket_t & from, std::span < socket_t * const > to, size_t const chunk_size = pipe_t::default_capacity);
+
+}
+
+namespace std
+{
+
+template <>
+struct formatter < zsl::iouring::net::relay_stats_t > : std::formatter < std::string >
+{
+    auto format(zsl::iouring::net::relay_stats_t const & s, format_context & ctx) const
+    {
+        return formatter < std::string >::format(std::format("in = {} out = {} splices = {} tees = {} rounds = {}", s.bytes_in_, s.bytes_out_, s.splices_, s.tees_, s.rounds_), ctx);
+    }
+};
+
+}
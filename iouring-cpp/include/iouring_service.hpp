@@ -1,10 +1,14 @@
 #pragma once
 
 #include <chrono>
+#include <concepts>
+#include <coroutine>
 #include <functional>
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <ranges>
+#include <span>
 #include <thread>
 #include <utility>
 
@@ -28,10 +32,19 @@ using namespace std::literals::chrono_literals;
 using highres_clock_t = std::chrono::high_resolution_clock;
 using timepoint_t = std::chrono::time_point < highres_clock_t >;
 using duration_t = std::chrono::microseconds;
+//  deadlines compared against now() on the event loop, immune to wall clock steps
+using steady_clock_t = std::chrono::steady_clock;
+using deadline_t = std::chrono::time_point < steady_clock_t >;
 
 using ::zsl::logging::log;
 using ::zsl::logging::logc;
 
+namespace metrics
+{
+struct snapshot_t;
+struct latencies_t;
+}
+
 struct ring_t
 {
     ring_t();
@@ -41,25 +54,90 @@ struct ring_t
     ring_t(ring_t && rhs) = delete;
     ring_t & operator = (ring_t && rhs) = delete;
 
+    //  told about a completion instead of the awaiting coroutine being resumed, see when_all and when_any
+    struct completion_t
+    {
+        using notify_t = void (*)(completion_t &);
+        notify_t notify_{};
+    };
+
     struct event_t
     {
         using handler_t = void (*)(io_uring_cqe *, event_t &);
         handler_t handler_{};
         std::coroutine_handle<> coroutine_{};
+        completion_t * completion_{};
+        uint64_t prepared_at_{};    //  steady clock nanoseconds, only stamped while latency tracking is on
+        uint8_t opcode_{};          //  of the last operation prepared on this event
+        bool cancelled_{};          //  set by ring_t::cancel, multi step operations check it between steps
+
+        //  handlers call this once the operation is over
+        void resume()
+        {
+            if (completion_)
+                completion_->notify_(*completion_);
+            else
+                coroutine_.resume();
+        }
 
         constexpr friend auto operator <=> (event_t const &, event_t const &) = default;
     };
 
+    //  events are at least 8 byte aligned, the low bits of user_data tell the reaper what to do with a completion
+    //  without having to touch the event first
+    enum class event_tag_t : uint8_t
+    {
+        HANDLER = 0,    //  call event_t::handler_
+        DETACHED = 1,   //  nobody is waiting, e.g. linked timeouts and fire-and-forget cancellations
+        WAKE = 2,       //  the ring's own eventfd read, another thread posted work
+    };
+    inline constexpr static uint64_t event_tag_mask{alignof(event_t) - 1};
+    static_assert(alignof(event_t) >= 8);
+
+    enum class reap_mode_t : uint8_t
+    {
+        EACH,           //  walk the completion queue one entry at a time
+        BATCH,          //  peek completions in bulk and prefetch their events ahead of dispatch
+    };
+
+    void reap_mode(reap_mode_t const mode);
+    reap_mode_t reap_mode() const;
+
     inline constexpr static duration_t default_wait_interval{1s};
 
+    //  not from inside a completion handler, the reaper isn't re-entrant and would dispatch the completions being
+    //  handled again, std::logic_error when it is
     void wait_for_events(size_t const count = 1, duration_t const wait_timeout = default_wait_interval);
 
+    //  ring's thread only; true while completion handlers are being run
+    bool reaping() const;
+
     template < typename R, typename P, typename D = std::chrono::duration < R, P > >
     void wait_for_events(size_t const count = 1, D const wait_timeout = D{default_wait_interval})
     {
         wait_for_events(count, duration_t{wait_timeout});
     }
 
+    enum class run_mode_t : uint8_t
+    {
+        BLOCK,          //  sleep in io_uring_enter until there are completions or the wait times out
+        SPIN,           //  poll the completion queue from user space for the whole wait, no system call
+        HYBRID,         //  poll for up to spin_for, then sleep for the rest of the wait
+    };
+
+    inline constexpr static duration_t default_spin_interval{50us};
+
+    //  SPIN and HYBRID trade the ring's core for not paying a wakeup per completion, for a thread pinned to a core
+    //  of its own.  spin_for only matters to HYBRID
+    void run_mode(run_mode_t const mode, duration_t const spin_for = default_spin_interval);
+    run_mode_t run_mode() const;
+
+    //  NAPI busy polling of the sockets the ring has operations on, done by the kernel for up to timeout whenever
+    //  the ring sleeps in io_uring_enter, i.e. in BLOCK and once HYBRID stops spinning.  false when the kernel can't
+    //  (before 6.9)
+    bool busy_poll(duration_t const timeout, bool const prefer = true);
+    void no_busy_poll();
+
     void run(bool & stopped)
     {
         while (!stopped)
@@ -75,8 +153,111 @@ struct ring_t
     template < typename F, typename... Args >
     void prepare(event_t & e, F && f, Args &&... args);
 
+    //  prepares an operation whose completion is dropped by the reaper
+    template < typename F, typename... Args >
+    void prepare_detached(F && f, Args &&... args);
+
+    //  prepares a no-op completing on e, i.e. a round trip through the rings with no I/O
+    void nop(event_t & e);
+
     void submit();
 
+    //  makes room for count operations prepared back to back, submitting whatever is queued if it has to, e.g. for a
+    //  chain of linked operations that has to go in whole
+    void reserve(uint32_t const count);
+
+    //  a fixed file table of count empty slots, for direct descriptors and IOSQE_FIXED_FILE operations
+    void register_files_sparse(uint32_t const count);
+    void unregister_files();
+
+    //  buf in the ring's table of registered buffers, for the *_fixed operations.  the table is registered sparse on
+    //  first use, nothing comes back once it's full or when the kernel won't pin the memory (RLIMIT_MEMLOCK)
+    std::optional < uint16_t > register_buffer(std::span < uint8_t > buf);
+    void unregister_buffer(uint16_t const index);
+
+    //  a provided buffer ring for IOSQE_BUFFER_SELECT operations in group, entries is a power of two
+    io_uring_buf_ring * setup_buffer_ring(uint32_t const entries, uint16_t const group);
+    void free_buffer_ring(io_uring_buf_ring * br, uint32_t const entries, uint16_t const group);
+
+    //  prepares the cancellation of every operation in flight on e, each completes with -ECANCELED unless it got
+    //  there first, and marks e cancelled so a multi step operation doesn't start its next step
+    void cancel(event_t & e);
+
+    //  ring's thread only; completes e on target with res, without target's thread having to be woken by anything
+    //  else, by an IORING_OP_MSG_RING prepared on this ring.  e's handler then runs on target's thread
+    void msg_ring(ring_t & target, event_t & e, int32_t const res = 0);
+
+    //  work handed to the ring's thread, see post() and schedule()
+    struct posted_t
+    {
+        //  run is false when the ring is destroyed before getting to it
+        using handler_t = void (*)(posted_t &, bool const run);
+        handler_t handler_{};
+        posted_t * next_{};
+    };
+
+    //  any thread; p is run by the ring's thread on its next pass through wait_for_events and must stay alive until
+    //  then.  the first post after the ring last woke up writes to an eventfd the ring keeps a read pending on, posts
+    //  while that wakeup is still in flight don't make another system call
+    void post(posted_t & p);
+
+    //  ring's thread only; p runs once at the end of the current pass through wait_for_events, after every completion
+    //  reaped in it, and has to stay alive until then.  for work that gains from batching a whole pass, e.g. flushing
+    //  small writes
+    void defer(posted_t & p);
+
+    //  drops p if it's still waiting for the end of the pass
+    void undefer(posted_t & p);
+
+    //  any thread; runs a copy of f on the ring's thread
+    template < std::invocable F >
+    void post(F && f)
+    {
+        struct callable_t : posted_t
+        {
+            std::decay_t < F > f_;
+        };
+        auto * c = new callable_t{{+[] (posted_t & p, bool const run) {
+            std::unique_ptr < callable_t > c{static_cast < callable_t * >(&p)};
+            if (run)
+                c->f_();
+        }}, std::forward < F >(f)};
+        post(*c);
+    }
+
+    struct schedule_awaitable_t : posted_t
+    {
+        ring_t & ring_;
+        std::coroutine_handle<> coroutine_{};
+
+        bool await_ready() const
+        {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> coroutine)
+        {
+            coroutine_ = coroutine;
+            ring_.post(*this);
+        }
+
+        void await_resume() const
+        {
+        }
+    };
+
+    //  co_await ring.schedule() continues the awaiting coroutine on the ring's thread
+    [[nodiscard]] schedule_awaitable_t schedule();
+
+    //  counters and gauges, safe to call from any thread (see iouring_metrics.hpp)
+    ::zsl::iouring::metrics::snapshot_t metrics() const;
+
+    //  the per operation latency histograms, likewise, into l rather than on the stack
+    void latencies(::zsl::iouring::metrics::latencies_t & l) const;
+
+    //  per operation prepare to completion latency and time spent in handlers, costs two clock reads per operation
+    void track_latency(bool const on);
+
   private:
     struct impl_t;
     std::unique_ptr < impl_t > impl_;
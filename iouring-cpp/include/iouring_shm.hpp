@@ -0,0 +1,188 @@
+#pragma once
+
+#include "iouring_net.hpp"
+#include "iouring_sync.hpp"
+
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <optional>
+#include <ranges>
+#include <span>
+
+//  message queues in shared memory, for processes on one host
+//
+//      auto q = shm::queue_t::create(1 << 20);             //  the fd goes to the other process, inherited or SCM_RIGHTS
+//      ...
+//      shm::writer_t writer{q};                            //  any number of writers, in any processes
+//      writer.push(a);
+//      writer.push(b);
+//      writer.flush(ring);
+//      ...
+//      shm::reader_t reader{q};                            //  one reader
+//      while (auto m = co_await reader.next(ring))
+//          handle(m.value());
+//
+//  a memfd holding a header page and a byte ring mapped twice back to back, so every message is one contiguous span
+//  and is read where it was written.  a writer claims room with a CAS, copies the payload in and publishes it with a
+//  release store of its length; the reader hands out the message in place and zeroes it once done with it.  a hop
+//  is a memcpy and a few cache lines changing hands, no system call while the reader is awake.
+//
+//  a reader that finds nothing waits with an IORING_OP_FUTEX_WAIT on its ring, after spinning for a while first if
+//  asked to.  writers only wake it from flush(), and only when it's asleep.  spin_forever never sleeps: next() then
+//  busy waits on the calling thread, for a reader with a core of its own
+
+namespace zsl::iouring::shm
+{
+
+struct queue_t
+{
+    //  capacity is rounded up to whole pages
+    static queue_t create(size_t const capacity);
+
+    //  maps the queue behind fd, the queue keeps its own duplicate
+    static queue_t open(int32_t const fd);
+
+    queue_t(queue_t && rhs) noexcept;
+    queue_t & operator = (queue_t && rhs) = delete;
+    queue_t(queue_t const &) = delete;
+    queue_t & operator = (queue_t const &) = delete;
+    ~queue_t();
+
+    int32_t fd() const
+    {
+        return fd_;
+    }
+
+    size_t capacity() const
+    {
+        return capacity_;
+    }
+
+    //  largest message that fits
+    size_t max_length() const
+    {
+        return capacity_ - record_header_size;
+    }
+
+private:
+    friend struct reader_t;
+    friend struct writer_t;
+
+    inline constexpr static size_t const record_header_size{8};
+    inline constexpr static size_t const record_alignment{8};
+
+    //  at the start of the memfd, shared by every process mapping it
+    struct header_t
+    {
+        inline constexpr static uint64_t const magic{0x7a736c2d73686d31};      //  "zsl-shm1"
+
+        explicit header_t(uint64_t const capacity) : magic_{magic}, capacity_{capacity}
+        {
+        }
+
+        uint64_t magic_;
+        uint64_t capacity_;
+        alignas(64) std::atomic < uint64_t > reserved_{0};      //  writers claim room up to here
+        alignas(64) std::atomic < uint64_t > head_{0};          //  the reader has released everything before this
+        alignas(64) sync::detail::futex_t signal_{0, true};     //  bumped to wake the reader
+    };
+
+    queue_t(int32_t const fd, size_t const capacity, bool const initialise);
+
+    static size_t record_size(size_t const length)
+    {
+        return (record_header_size + length + record_alignment - 1) / record_alignment * record_alignment;
+    }
+
+    int32_t fd_{-1};
+    size_t capacity_{};
+    size_t page_{};
+    uint8_t * base_{};
+    header_t * header_{};
+    uint8_t * data_{};
+};
+
+struct writer_t
+{
+    explicit writer_t(queue_t & queue) : queue_{queue}
+    {
+    }
+
+    //  copies payload into the queue and publishes it, false when there's no room for it right now
+    bool push(std::span < uint8_t const > const payload);
+
+    template < std::ranges::contiguous_range T >
+    bool push(T const & payload)
+    {
+        return push(std::span(reinterpret_cast < uint8_t const * >(std::ranges::data(payload)), std::ranges::size(payload) * sizeof(std::ranges::range_value_t < T >)));
+    }
+
+    //  wakes the reader if it's asleep, on ring or with a system call from a thread without one
+    void flush(ring_t & ring);
+    void flush();
+
+private:
+    bool reader_asleep();
+
+    queue_t & queue_;
+};
+
+struct reader_t
+{
+    using frame_result_t = net::expected_t < std::span < uint8_t const >, int32_t >;
+
+    inline constexpr static uint32_t const spin_forever{UINT32_MAX};
+
+    //  spin is how many times next() looks again before it sleeps
+    explicit reader_t(queue_t & queue, uint32_t const spin = 0) : queue_{queue}, spin_{spin}, head_{queue.header_->head_.load(std::memory_order_acquire)}
+    {
+    }
+
+    //  the next message, valid until the next call to next() or try_next(), -EAGAIN when there's none yet
+    frame_result_t try_next();
+
+    struct next_awaitable_t : sync::detail::wait_t
+    {
+        next_awaitable_t(ring_t & ring, reader_t & reader) : wait_t{ring, reader.signal(), &ready}, reader_{reader}
+        {
+        }
+
+        bool await_ready();
+
+        void await_suspend(std::coroutine_handle<> coroutine)
+        {
+            suspend(coroutine);
+        }
+
+        frame_result_t await_resume() const
+        {
+            return *result_;
+        }
+
+        reader_t & reader_;
+        std::optional < frame_result_t > result_{};
+
+    private:
+        static bool ready(sync::detail::wait_t & w);
+    };
+
+    //  the next message, waiting on ring for one
+    [[nodiscard]] next_awaitable_t next(ring_t & ring)
+    {
+        return next_awaitable_t{ring, *this};
+    }
+
+private:
+    sync::detail::futex_t & signal()
+    {
+        return queue_.header_->signal_;
+    }
+
+    queue_t & queue_;
+    uint32_t const spin_;
+    uint64_t head_{};           //  start of the message handed out last, or of the next one
+    uint64_t consumed_{};       //  size of the message handed out last, released on the next call
+};
+
+}
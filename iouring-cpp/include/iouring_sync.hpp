@@ -0,0 +1,277 @@
+#pragma once
+
+#include "iouring_service.hpp"
+
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+
+//  coroutine synchronisation across rings, e.g. a table or a cache shared by rings on different threads
+//
+//      sync::async_mutex_t m;
+//      co_await m.lock(ring);
+//      ...
+//      m.unlock(ring);
+//
+//  each primitive is a single 32 bit futex word.  the uncontended path is an atomic operation and nothing else, a
+//  coroutine that has to wait suspends on an IORING_OP_FUTEX_WAIT prepared on its own ring, so contention costs the
+//  waiter a suspended coroutine and its ring carries on with everything else.  waking is an IORING_OP_FUTEX_WAKE on
+//  the waker's ring, or the futex system call from a thread that has no ring.  needs Linux 6.7.
+//
+//  none of them is fair, a woken waiter competes with whoever gets there first and waits again if it loses
+
+namespace zsl::iouring::sync
+{
+
+namespace detail
+{
+
+//  the futex word itself, shared with the kernel.  a shared one can live in memory mapped by several processes
+struct futex_t
+{
+    static_assert(sizeof(std::atomic < uint32_t >) == sizeof(uint32_t) && std::atomic < uint32_t >::is_always_lock_free);
+
+    explicit futex_t(uint32_t const value = 0, bool const shared = false) : value_{value}, shared_{shared}
+    {
+    }
+
+    uint32_t * word()
+    {
+        return reinterpret_cast < uint32_t * >(&value_);
+    }
+
+    //  wakes up to count waiters, on the ring or with a system call
+    void wake(ring_t & ring, uint32_t const count);
+    void wake(uint32_t const count);
+
+    std::atomic < uint32_t > value_;
+    std::atomic < uint32_t > waiters_{0};
+    bool const shared_;
+};
+
+//  a coroutine waiting on a futex from ring, ready() is retried each time the word changes
+struct wait_t : ring_t::event_t
+{
+    using ready_t = bool (*)(wait_t &);
+
+    wait_t(ring_t & ring, futex_t & futex, ready_t const ready) : ring_{ring}, futex_{futex}, ready_{ready}
+    {
+    }
+
+    ring_t & ring_;
+    futex_t & futex_;
+    ready_t ready_;
+    uint32_t expected_{};       //  the value that means "keep waiting", set by ready() before it fails
+    bool waiting_{false};       //  counted in futex_t::waiters_
+
+    void suspend(std::coroutine_handle<> coroutine);
+
+private:
+    static void on_wait(io_uring_cqe * cqe, ring_t::event_t & e);
+
+    void wait();
+    void retry();
+};
+
+}
+
+struct async_mutex_t
+{
+    async_mutex_t() = default;
+    async_mutex_t(async_mutex_t const &) = delete;
+    async_mutex_t & operator = (async_mutex_t const &) = delete;
+
+    struct lock_awaitable_t : detail::wait_t
+    {
+        using wait_t::wait_t;
+
+        bool await_ready()
+        {
+            return ready_(*this);
+        }
+
+        void await_suspend(std::coroutine_handle<> coroutine)
+        {
+            suspend(coroutine);
+        }
+
+        void await_resume() const
+        {
+        }
+    };
+
+    bool try_lock()
+    {
+        uint32_t expected{UNLOCKED};
+        return futex_.value_.compare_exchange_strong(expected, LOCKED, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    //  the awaiting coroutine holds the mutex once resumed
+    [[nodiscard]] lock_awaitable_t lock(ring_t & ring)
+    {
+        return lock_awaitable_t{ring, futex_, &acquire};
+    }
+
+    //  ring is the unlocking thread's, the plain one is for threads without one
+    void unlock(ring_t & ring)
+    {
+        if (release())
+            futex_.wake(ring, 1);
+    }
+
+    void unlock()
+    {
+        if (release())
+            futex_.wake(1);
+    }
+
+private:
+    enum : uint32_t { UNLOCKED = 0, LOCKED = 1, CONTENDED = 2 };
+
+    static bool acquire(detail::wait_t & w);
+
+    //  true when there might be someone to wake
+    bool release()
+    {
+        return futex_.value_.exchange(UNLOCKED, std::memory_order_release) == CONTENDED;
+    }
+
+    detail::futex_t futex_{UNLOCKED};
+};
+
+struct async_semaphore_t
+{
+    explicit async_semaphore_t(uint32_t const count) : futex_{count}
+    {
+    }
+
+    async_semaphore_t(async_semaphore_t const &) = delete;
+    async_semaphore_t & operator = (async_semaphore_t const &) = delete;
+
+    struct acquire_awaitable_t : detail::wait_t
+    {
+        using wait_t::wait_t;
+
+        bool await_ready()
+        {
+            return ready_(*this);
+        }
+
+        void await_suspend(std::coroutine_handle<> coroutine)
+        {
+            suspend(coroutine);
+        }
+
+        void await_resume() const
+        {
+        }
+    };
+
+    bool try_acquire()
+    {
+        auto count = futex_.value_.load(std::memory_order_relaxed);
+        while (count > 0)
+            if (futex_.value_.compare_exchange_weak(count, count - 1, std::memory_order_acquire, std::memory_order_relaxed))
+                return true;
+        return false;
+    }
+
+    [[nodiscard]] acquire_awaitable_t acquire(ring_t & ring)
+    {
+        return acquire_awaitable_t{ring, futex_, &take};
+    }
+
+    void release(ring_t & ring, uint32_t const count = 1)
+    {
+        if (give(count))
+            futex_.wake(ring, count);
+    }
+
+    void release(uint32_t const count = 1)
+    {
+        if (give(count))
+            futex_.wake(count);
+    }
+
+    uint32_t available() const
+    {
+        return futex_.value_.load(std::memory_order_relaxed);
+    }
+
+private:
+    static bool take(detail::wait_t & w);
+
+    bool give(uint32_t const count)
+    {
+        futex_.value_.fetch_add(count, std::memory_order_seq_cst);
+        return futex_.waiters_.load(std::memory_order_seq_cst) > 0;
+    }
+
+    detail::futex_t futex_;
+};
+
+//  manual reset: once set every waiter goes through until reset()
+struct async_event_t
+{
+    async_event_t() = default;
+    async_event_t(async_event_t const &) = delete;
+    async_event_t & operator = (async_event_t const &) = delete;
+
+    struct wait_awaitable_t : detail::wait_t
+    {
+        using wait_t::wait_t;
+
+        bool await_ready()
+        {
+            return ready_(*this);
+        }
+
+        void await_suspend(std::coroutine_handle<> coroutine)
+        {
+            suspend(coroutine);
+        }
+
+        void await_resume() const
+        {
+        }
+    };
+
+    [[nodiscard]] wait_awaitable_t wait(ring_t & ring)
+    {
+        return wait_awaitable_t{ring, futex_, &signalled};
+    }
+
+    void set(ring_t & ring)
+    {
+        if (raise())
+            futex_.wake(ring, UINT32_MAX >> 1);
+    }
+
+    void set()
+    {
+        if (raise())
+            futex_.wake(UINT32_MAX >> 1);
+    }
+
+    void reset()
+    {
+        futex_.value_.store(0, std::memory_order_relaxed);
+    }
+
+    bool is_set() const
+    {
+        return futex_.value_.load(std::memory_order_acquire) != 0;
+    }
+
+private:
+    static bool signalled(detail::wait_t & w);
+
+    bool raise()
+    {
+        return futex_.value_.exchange(1, std::memory_order_seq_cst) == 0 && futex_.waiters_.load(std::memory_order_seq_cst) > 0;
+    }
+
+    detail::futex_t futex_{0};
+};
+
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "iouring_net.hpp"
+
+#include <cstdint>
+#include <string>
+
+//  TLS with the record layer in the kernel (kTLS)
+//
+//      tls::context_t ctx{tls::role_t::SERVER, {.certificate_ = cert, .private_key_ = key}};
+//      if (auto hr = co_await tls::handshake(socket, ctx); hr.has_value())
+//          co_await socket.send(reply);        //  encrypted by the kernel
+//
+//  the handshake runs through OpenSSL on memory BIOs, its records going over the ring like any other send and recv.
+//  records are received one at a time, header then body, so nothing past the handshake is ever pulled out of the
+//  socket.  once it's done the traffic secrets are handed to the kernel with TCP_ULP "tls" and TLS_TX/TLS_RX, and
+//  from then on send, recv, send_file and relay work on the socket unchanged, only seeing plaintext.
+//
+//  TLS 1.3 only, AES-GCM only, no session tickets (they would move the server's record sequence past the one handed
+//  to the kernel).  records other than application data, i.e. alerts and key updates, make recv fail with -EIO
+
+struct ssl_ctx_st;
+
+namespace zsl::iouring::net::tls
+{
+
+enum class role_t : uint8_t { CLIENT, SERVER };
+
+struct context_t
+{
+    //  PEM text
+    struct options_t
+    {
+        std::string certificate_{};             //  with its chain, required for a server
+        std::string private_key_{};
+        std::string ca_{};                      //  peer certificates are verified against it when given
+        std::string server_name_{};             //  client only, sent as SNI and checked against the server certificate
+    };
+
+    //  throws std::runtime_error with OpenSSL's error queue when the certificate, key or CA don't load
+    context_t(role_t const role, options_t const & options);
+    ~context_t();
+
+    context_t(context_t const &) = delete;
+    context_t & operator = (context_t const &) = delete;
+
+    role_t role() const
+    {
+        return role_;
+    }
+
+    options_t const & options() const
+    {
+        return options_;
+    }
+
+    ssl_ctx_st * native() const
+    {
+        return ctx_;
+    }
+
+private:
+    role_t const role_;
+    options_t const options_;
+    ssl_ctx_st * ctx_{};
+};
+
+//  -EPROTO for a failed handshake, the errno of setsockopt when the kernel won't take the keys (e.g. -ENOENT without
+//  the tls module), whatever send or recv failed with otherwise
+using handshake_result_t = expected_t < void, int32_t >;
+
+coroutine::awaitable_t < handshake_result_t > handshake(socket_t & socket, context_t const & context);
+
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <source_location>
+#include <string>
+
+#include <clock/clock.hpp>
+
+//  await/resume tracing, dumped as Chrome trace event JSON (chrome://tracing, ui.perfetto.dev)
+//
+//  built in only with ZSL_IOURING_TRACING defined (cmake -DZSL_IOURING_TRACING=ON), otherwise every call below is
+//  an empty inline function.  each thread appends fixed size records to its own ring buffer, no locks and no
+//  allocation after the first record; when a buffer wraps the oldest records are lost.  an awaitable shows up as an
+//  async span from await_suspend to await_resume keyed by its event, a coroutine as an async span from its initial
+//  to its final suspend, and completion handlers as nested spans on the ring's thread
+
+namespace zsl::iouring::trace
+{
+
+#if defined(ZSL_IOURING_TRACING)
+inline constexpr bool const enabled{true};
+#else
+inline constexpr bool const enabled{false};
+#endif
+
+enum class phase_t : uint8_t { ASYNC_BEGIN, ASYNC_END, BEGIN, END };
+
+struct record_t
+{
+    uint64_t ts_ns_{};
+    char const * name_{};
+    void const * id_{};
+    void const * coroutine_{};
+    phase_t phase_{};
+};
+
+struct buffer_t
+{
+    inline constexpr static size_t const capacity{1 << 16};
+    std::array < record_t, capacity > records_{};
+    uint64_t next_{};
+    uint32_t tid_{};
+};
+
+//  the calling thread's buffer, created and registered for dumping on first use
+buffer_t & attach();
+
+inline thread_local buffer_t * tls_buffer{nullptr};
+
+inline void record(phase_t const phase, char const * name, void const * id, void const * coroutine = nullptr)
+{
+    if constexpr (enabled)
+    {
+        auto * b = tls_buffer ? tls_buffer : &attach();
+        b->records_[b->next_++ & (buffer_t::capacity - 1)] = {
+            static_cast < uint64_t >(::zsl::clock::tsc_clock_t::now().time_since_epoch().count()),
+            name, id, coroutine, phase
+        };
+    }
+}
+
+inline void async_begin(char const * name, void const * id, void const * coroutine = nullptr)
+{
+    record(phase_t::ASYNC_BEGIN, name, id, coroutine);
+}
+
+inline void async_end(char const * name, void const * id, void const * coroutine = nullptr)
+{
+    record(phase_t::ASYNC_END, name, id, coroutine);
+}
+
+//  synchronous span on the current thread
+struct scope_t
+{
+    char const * name_;
+    void const * id_;
+
+    scope_t(char const * name, void const * id = nullptr) : name_{name}, id_{id}
+    {
+        record(phase_t::BEGIN, name_, id_);
+    }
+
+    ~scope_t()
+    {
+        record(phase_t::END, name_, id_);
+    }
+};
+
+//  "... [with T = zsl::iouring::net::socket_t::recv_event_t]", trimmed to the type when dumping
+template < typename T >
+consteval char const * name_of()
+{
+    return std::source_location::current().function_name();
+}
+
+//  writes every thread's records to path, call it once the rings are quiet
+bool dump(std::string const & path);
+
+//  forget everything recorded so far
+void clear();
+
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace zsl::iouring::utils::work_stealing
+{
+
+//  Chase-Lev work stealing deque of T pointers, fixed capacity
+//
+//  the owning thread pushes and pops at the bottom, any other thread steals from the top.  follows the C11 version
+//  of Lê, Pop, Cohen and Zappa Nardelli, "Correct and Efficient Work-Stealing for Weak Memory Models" (PPoPP 2013)
+//  without the growable array: a full deque refuses the push and the caller keeps the item somewhere else
+template < typename T, uint32_t CAPACITY = 4096 >
+struct deque_t
+{
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "capacity must be a power of two");
+    inline constexpr static int64_t const mask{CAPACITY - 1};
+
+    //  owner only
+    bool push(T * item)
+    {
+        auto const b = bottom_.load(std::memory_order_relaxed);
+        auto const t = top_.load(std::memory_order_acquire);
+        if (b - t >= int64_t{CAPACITY})
+            return false;
+        items_[b & mask].store(item, std::memory_order_relaxed);
+        bottom_.store(b + 1, std::memory_order_release);
+        return true;
+    }
+
+    //  owner only, newest first
+    T * pop()
+    {
+        auto const b = bottom_.load(std::memory_order_relaxed) - 1;
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto t = top_.load(std::memory_order_relaxed);
+        if (t > b)
+        {
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        auto * item = items_[b & mask].load(std::memory_order_relaxed);
+        if (t == b)
+        {
+            //  last one, race the thieves for it
+            if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                item = nullptr;
+            bottom_.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    //  any thread, oldest first; nullptr when empty or when another thread got there first
+    T * steal()
+    {
+        auto t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto const b = bottom_.load(std::memory_order_acquire);
+        if (t >= b)
+            return nullptr;
+        auto * item = items_[t & mask].load(std::memory_order_relaxed);
+        if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr;
+        return item;
+    }
+
+    //  any thread, a hint only
+    bool empty() const
+    {
+        return bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed);
+    }
+
+private:
+    alignas(64) std::atomic < int64_t > top_{0};
+    alignas(64) std::atomic < int64_t > bottom_{0};
+    alignas(64) std::array < std::atomic < T * >, CAPACITY > items_{};
+};
+
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <limits>
+
+namespace zsl::iouring::utils::histogram
+{
+
+//  log-linear (HDR style) histogram over uint64_t values
+//
+//  values below 2^SIGNIFICANT_BITS get a bucket each, above that every power of two range is split into
+//  2^(SIGNIFICANT_BITS - 1) equal buckets, so a recorded value is off by at most 1 / 2^(SIGNIFICANT_BITS - 1)
+//  of itself.  recording is a bit_width and a shift, no floating point and no allocation
+template < uint8_t SIGNIFICANT_BITS = 7 >
+struct histogram_t
+{
+    static_assert(SIGNIFICANT_BITS >= 2 && SIGNIFICANT_BITS <= 16, "significant bits must be within [2, 16]");
+
+    constexpr static uint32_t const linear_buckets{1U << SIGNIFICANT_BITS};
+    constexpr static uint32_t const sub_buckets{linear_buckets / 2};
+    constexpr static uint32_t const bucket_count{linear_buckets + (64 - SIGNIFICANT_BITS) * sub_buckets};
+
+    constexpr static uint32_t index_of(uint64_t const v)
+    {
+        if (v < linear_buckets)
+            return static_cast < uint32_t >(v);
+        auto const shift = static_cast < uint32_t >(std::bit_width(v)) - SIGNIFICANT_BITS;
+        return linear_buckets + (shift - 1) * sub_buckets + static_cast < uint32_t >((v >> shift) - sub_buckets);
+    }
+
+    constexpr static uint64_t lowest_equivalent(uint32_t const index)
+    {
+        if (index < linear_buckets)
+            return index;
+        auto const k = index - linear_buckets;
+        auto const shift = k / sub_buckets + 1;
+        return static_cast < uint64_t >(k % sub_buckets + sub_buckets) << shift;
+    }
+
+    constexpr static uint64_t highest_equivalent(uint32_t const index)
+    {
+        if (index < linear_buckets)
+            return index;
+        auto const k = index - linear_buckets;
+        auto const shift = k / sub_buckets + 1;
+        return lowest_equivalent(index) + ((uint64_t{1} << shift) - 1);
+    }
+
+    constexpr void record(uint64_t const v, uint64_t const n = 1)
+    {
+        counts_[index_of(v)] += n;
+        total_ += n;
+        sum_ += v * n;
+        min_ = std::min(min_, v);
+        max_ = std::max(max_, v);
+    }
+
+    constexpr void merge(histogram_t const & rhs)
+    {
+        for (uint32_t i = 0; i < bucket_count; ++i)
+            counts_[i] += rhs.counts_[i];
+        total_ += rhs.total_;
+        sum_ += rhs.sum_;
+        min_ = std::min(min_, rhs.min_);
+        max_ = std::max(max_, rhs.max_);
+    }
+
+    constexpr void reset()
+    {
+        *this = histogram_t{};
+    }
+
+    constexpr uint64_t count() const
+    {
+        return total_;
+    }
+
+    constexpr uint64_t min() const
+    {
+        return total_ == 0 ? 0 : min_;
+    }
+
+    constexpr uint64_t max() const
+    {
+        return max_;
+    }
+
+    constexpr double mean() const
+    {
+        return total_ == 0 ? 0.0 : static_cast < double >(sum_) / static_cast < double >(total_);
+    }
+
+    //  highest value equivalent to the one at the given percentile, i.e. a conservative upper bound
+    constexpr uint64_t value_at_percentile(double const percentile) const
+    {
+        if (total_ == 0)
+            return 0;
+        auto const p = std::clamp(percentile, 0.0, 100.0);
+        auto target = static_cast < uint64_t >(p / 100.0 * static_cast < double >(total_) + 0.5);
+        target = std::clamp < uint64_t >(target, 1, total_);
+        uint64_t seen{0};
+        for (uint32_t i = 0; i < bucket_count; ++i)
+        {
+            seen += counts_[i];
+            if (seen >= target)
+                return std::min(highest_equivalent(i), max_);
+        }
+        return max_;
+    }
+
+    constexpr uint64_t count_at(uint32_t const index) const
+    {
+        return counts_[index];
+    }
+
+private:
+    std::array < uint64_t, bucket_count > counts_{};
+    uint64_t total_{};
+    uint64_t sum_{};
+    uint64_t min_{std::numeric_limits < uint64_t >::max()};
+    uint64_t max_{};
+};
+
+}
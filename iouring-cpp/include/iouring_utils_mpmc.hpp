@@ -0,0 +1,124 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+
+namespace zsl::iouring::utils::mpmc
+{
+
+//  bounded multi producer multi consumer queue of T, fixed capacity
+//
+//  D. Vyukov's: every cell carries a sequence number saying whose turn it is, a push claims its cell with one CAS on
+//  the tail and publishes it with a release store of the cell's sequence, a pop does the same on the head.  a full
+//  queue refuses the push, an empty one the pop.  ends and cells are a cache line each so producers, consumers and
+//  neighbouring items don't share lines
+template < typename T, uint32_t CAPACITY >
+struct queue_t
+{
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "capacity must be a power of two");
+    inline constexpr static uint64_t const mask{CAPACITY - 1};
+
+    queue_t()
+    {
+        for (uint64_t i = 0; i < CAPACITY; ++i)
+            cells_[i].sequence_.store(i, std::memory_order_relaxed);
+    }
+
+    ~queue_t()
+    {
+        while (pop())
+            ;
+    }
+
+    queue_t(queue_t const &) = delete;
+    queue_t & operator = (queue_t const &) = delete;
+
+    //  any thread; the value is only moved from when there's room for it
+    template < typename U >
+    bool push(U && value)
+    {
+        auto pos = tail_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            auto & c = cells_[pos & mask];
+            auto const sequence = c.sequence_.load(std::memory_order_acquire);
+            auto const diff = static_cast < int64_t >(sequence - pos);
+            if (diff == 0)
+            {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    std::construct_at(c.item(), std::forward < U >(value));
+                    c.sequence_.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+                return false;
+            else
+                pos = tail_.load(std::memory_order_relaxed);
+        }
+    }
+
+    //  any thread, oldest first
+    std::optional < T > pop()
+    {
+        auto pos = head_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            auto & c = cells_[pos & mask];
+            auto const sequence = c.sequence_.load(std::memory_order_acquire);
+            auto const diff = static_cast < int64_t >(sequence - (pos + 1));
+            if (diff == 0)
+            {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    std::optional < T > value{std::move(*c.item())};
+                    std::destroy_at(c.item());
+                    c.sequence_.store(pos + CAPACITY, std::memory_order_release);
+                    return value;
+                }
+            }
+            else if (diff < 0)
+                return std::nullopt;
+            else
+                pos = head_.load(std::memory_order_relaxed);
+        }
+    }
+
+    //  any thread, hints only
+    bool empty() const
+    {
+        return head_.load(std::memory_order_relaxed) >= tail_.load(std::memory_order_relaxed);
+    }
+
+    size_t size() const
+    {
+        auto const head = head_.load(std::memory_order_relaxed);
+        auto const tail = tail_.load(std::memory_order_relaxed);
+        return tail > head ? static_cast < size_t >(tail - head) : 0;
+    }
+
+private:
+    struct alignas(64) cell_t
+    {
+        std::atomic < uint64_t > sequence_;
+        alignas(T) std::byte storage_[sizeof(T)];
+
+        T * item()
+        {
+            return std::launder(reinterpret_cast < T * >(storage_));
+        }
+    };
+
+    alignas(64) std::atomic < uint64_t > head_{0};
+    alignas(64) std::atomic < uint64_t > tail_{0};
+    std::array < cell_t, CAPACITY > cells_;
+};
+
+}
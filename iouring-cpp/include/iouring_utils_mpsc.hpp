@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+
+namespace zsl::iouring::utils::mpsc
+{
+
+//  intrusive multi producer single consumer queue
+//
+//  producers push onto a lock-free stack, the consumer takes the whole stack in one exchange and reverses it, so
+//  there's no ABA and no per node synchronisation on the consumer side.  T needs a T * next_ member which belongs to
+//  the queue from push() until the node comes back out of take()
+template < typename T >
+struct queue_t
+{
+    //  any thread
+    void push(T & n)
+    {
+        auto * head = head_.load(std::memory_order_relaxed);
+        do
+            n.next_ = head;
+        while (!head_.compare_exchange_weak(head, &n, std::memory_order_seq_cst, std::memory_order_relaxed));
+    }
+
+    //  consumer only, everything pushed so far, oldest first
+    T * take()
+    {
+        T * fifo{nullptr};
+        for (auto * n = head_.exchange(nullptr, std::memory_order_seq_cst); n != nullptr; )
+        {
+            auto * next = n->next_;
+            n->next_ = fifo;
+            fifo = n;
+            n = next;
+        }
+        return fifo;
+    }
+
+    bool empty() const
+    {
+        return head_.load(std::memory_order_acquire) == nullptr;
+    }
+
+private:
+    std::atomic < T * > head_{nullptr};
+};
+
+}
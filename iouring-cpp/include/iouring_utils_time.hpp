@@ -7,22 +7,22 @@
 namespace zsl::iouring::utils::time
 {
 
-template < typename C >
-constexpr auto to_timespec(std::chrono::time_point < C > when)
+//  one conversion to nanoseconds and integer arithmetic from there, rather than a round trip through chrono per field
+constexpr __kernel_timespec to_timespec(std::chrono::nanoseconds const ns)
 {
-    auto const nsecs_since_epoch = std::chrono::duration_cast < std::chrono::nanoseconds >(when.time_since_epoch());
-    auto const secs_since_epoch = std::chrono::duration_cast < std::chrono::seconds >(nsecs_since_epoch);
-    auto const nsecs = nsecs_since_epoch - secs_since_epoch;
-    return __kernel_timespec{ .tv_sec = secs_since_epoch.count(), .tv_nsec = nsecs.count() };
+    return __kernel_timespec{ .tv_sec = ns.count() / std::nano::den, .tv_nsec = ns.count() % std::nano::den };
+}
+
+template < typename C, typename D >
+constexpr auto to_timespec(std::chrono::time_point < C, D > when)
+{
+    return to_timespec(std::chrono::duration_cast < std::chrono::nanoseconds >(when.time_since_epoch()));
 }
 
 template < typename R, typename P >
 constexpr auto to_timespec(std::chrono::duration < R, P > interval)
 {
-    auto const nsecs_since_epoch = std::chrono::duration_cast < std::chrono::nanoseconds >(interval);
-    auto const secs_since_epoch = std::chrono::duration_cast < std::chrono::seconds >(nsecs_since_epoch);
-    auto const nsecs = nsecs_since_epoch - secs_since_epoch;
-    return __kernel_timespec{ .tv_sec = secs_since_epoch.count(), .tv_nsec = nsecs.count() };
+    return to_timespec(std::chrono::duration_cast < std::chrono::nanoseconds >(interval));
 }
 
 }
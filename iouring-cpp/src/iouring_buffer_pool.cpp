@@ -0,0 +1,170 @@
+#include "iouring_buffer_pool.hpp"
+
+#include <logging/logging.hpp>
+
+#include <bit>
+#include <cerrno>
+#include <cstdint>
+#include <stdexcept>
+#include <system_error>
+
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+
+using zsl::logging::log;
+using zsl::iouring::buffers::pool_t;
+
+//  the node of the CPU we're on, -1 when the kernel won't say
+int32_t current_node()
+{
+    uint32_t cpu{};
+    uint32_t node{};
+    if (::syscall(SYS_getcpu, &cpu, &node, nullptr) != 0)
+        return -1;
+    return static_cast < int32_t >(node);
+}
+
+//  preferred rather than bound, a node that runs out falls back to the others instead of failing the fault
+void bind(void * const base, size_t const size, int32_t const node)
+{
+    if (node < 0 || node >= 64)
+        return;
+    unsigned long mask{1UL << node};
+    ::syscall(SYS_mbind, base, size, MPOL_PREFERRED, &mask, 64UL, 0U);
+}
+
+//  from the hugetlb pool if it has a page to spare, else 2MB aligned memory left to transparent huge pages
+uint8_t * map_page(bool & huge)
+{
+    if (auto * p = ::mmap(nullptr, pool_t::page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_2MB, -1, 0); p != MAP_FAILED)
+    {
+        huge = true;
+        return static_cast < uint8_t * >(p);
+    }
+
+    //  twice the size and trimmed to an aligned page either side
+    auto * const raw = static_cast < uint8_t * >(::mmap(nullptr, 2 * pool_t::page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (raw == MAP_FAILED)
+        throw std::system_error(errno, std::generic_category(), "mmap");
+    auto const offset = (pool_t::page_size - std::bit_cast < uintptr_t >(raw) % pool_t::page_size) % pool_t::page_size;
+    if (offset != 0)
+        ::munmap(raw, offset);
+    ::munmap(raw + offset + pool_t::page_size, pool_t::page_size - offset);
+    ::madvise(raw + offset, pool_t::page_size, MADV_HUGEPAGE);
+    huge = false;
+    return raw + offset;
+}
+
+}
+
+namespace zsl::iouring::buffers
+{
+
+pool_t::pool_t(ring_t & ring, options_t const & options)
+    : ring_{ring}
+    , options_{options}
+    , buffers_per_page_{options.buffer_size_ == 0 ? 0 : static_cast < uint32_t >(page_size / options.buffer_size_)}
+{
+    if (!std::has_single_bit(options_.buffer_size_) || options_.buffer_size_ < min_buffer_size || options_.buffer_size_ > page_size)
+        throw std::invalid_argument("buffer size has to be a power of two from 1KB to 2MB");
+
+    auto const page_count = (options_.buffer_count_ + buffers_per_page_ - 1) / buffers_per_page_;
+    stats_.node_ = current_node();
+    pages_.resize(page_count);
+    available_.reserve(page_count);
+    try
+    {
+        for (uint32_t i = 0; i < page_count; ++i)
+        {
+            auto & page = pages_[i];
+            page.base_ = map_page(page.huge_);
+            //  before the first touch, that's when the page gets placed
+            bind(page.base_, page_size, stats_.node_);
+#ifdef MADV_POPULATE_WRITE
+            ::madvise(page.base_, page_size, MADV_POPULATE_WRITE);
+#endif
+            if (options_.register_)
+                page.index_ = ring_.register_buffer({page.base_, page_size});
+
+            for (uint32_t slot = 0; slot < buffers_per_page_; ++slot)
+                page.free_.set(slot);
+            page.free_count_ = buffers_per_page_;
+            page.listed_ = true;
+
+            stats_.huge_pages_ += page.huge_ ? 1 : 0;
+            stats_.registered_pages_ += page.index_ ? 1 : 0;
+        }
+    }
+    catch (...)
+    {
+        unmap();
+        throw;
+    }
+    //  page 0 on top
+    for (auto i = page_count; i-- > 0;)
+        available_.push_back(i);
+    stats_.pages_ = page_count;
+    stats_.capacity_ = page_count * buffers_per_page_;
+    log("Buffer pool... pages = {} huge = {} registered = {} node = {}", stats_.pages_, stats_.huge_pages_, stats_.registered_pages_, stats_.node_);
+}
+
+pool_t::~pool_t()
+{
+    unmap();
+}
+
+void pool_t::unmap()
+{
+    for (auto & page : pages_)
+        if (page.base_)
+        {
+            if (page.index_)
+                ring_.unregister_buffer(*page.index_);
+            ::munmap(std::exchange(page.base_, nullptr), page_size);
+        }
+}
+
+std::optional < pool_t::lease_t > pool_t::acquire()
+{
+    if (available_.empty()) [[unlikely]]
+    {
+        ++stats_.exhausted_;
+        return std::nullopt;
+    }
+
+    auto const p = available_.back();
+    auto & page = pages_[p];
+    auto const slot = static_cast < uint32_t >(page.free_.ffs());
+    page.free_.reset(slot);
+    if (--page.free_count_ == 0)
+    {
+        page.listed_ = false;
+        available_.pop_back();
+    }
+
+    ++stats_.acquired_;
+    if (++stats_.in_use_ > stats_.in_use_max_)
+        stats_.in_use_max_ = stats_.in_use_;
+    return lease_t{*this, p, slot};
+}
+
+void pool_t::release(uint32_t const p, uint32_t const slot)
+{
+    auto & page = pages_[p];
+    page.free_.set(slot);
+    ++page.free_count_;
+    if (!page.listed_)
+    {
+        page.listed_ = true;
+        available_.push_back(p);
+    }
+    --stats_.in_use_;
+}
+
+}
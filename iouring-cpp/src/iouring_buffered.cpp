@@ -0,0 +1,242 @@
+#include "iouring_buffered.hpp"
+#include "iouring_impl.hpp"
+
+#include <logging/logging.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#include <liburing/io_uring.h>
+#include <liburing.h>
+
+namespace zsl::iouring::net
+{
+
+buffered_writer_t::buffered_writer_t(socket_t & socket, size_t const capacity)
+    : socket_{socket}
+    , capacity_{capacity}
+    , memory_{std::make_unique < uint8_t[] >(2 * capacity)}
+{
+    for (uint32_t i = 0; i < buffers_.size(); ++i)
+    {
+        auto & b = buffers_[i];
+        b.data_ = memory_.get() + i * capacity_;
+        b.index_ = socket_.ring().register_buffer(std::span < uint8_t >{b.data_, capacity_});
+    }
+    //  both or neither, so registered() tells the truth
+    if (buffers_[0].index_.has_value() != buffers_[1].index_.has_value())
+        for (auto & b : buffers_)
+            if (b.index_)
+                socket_.ring().unregister_buffer(*std::exchange(b.index_, std::nullopt));
+    logc(socket_, "Buffered writer... capacity = {} registered = {}", capacity_, registered());
+}
+
+buffered_writer_t::~buffered_writer_t()
+{
+    if (deferred_)
+        socket_.ring().undefer(deferred_event_);
+    //  the send on its way points into memory_ and at the send event, the event keeps both and frees them once the
+    //  send is back.  no running the ring from here, the writer may well be going away inside a completion
+    if (sending_)
+    {
+        auto * e = send_event_.release();
+        e->self_ = nullptr;
+        e->memory_ = std::move(memory_);
+        socket_.ring().cancel(*e);
+        socket_.ring().submit();
+    }
+    for (auto & b : buffers_)
+        if (b.index_)
+            socket_.ring().unregister_buffer(*b.index_);
+}
+
+size_t buffered_writer_t::buffered() const
+{
+    auto size = size_t{buffers_[active_].size_};
+    if (sending_)
+        size += buffers_[active_ ^ 1].size_ - offset_;
+    return size;
+}
+
+bool buffered_writer_t::idle() const
+{
+    return !sending_ && buffers_[active_].size_ == 0;
+}
+
+bool buffered_writer_t::append(std::span < uint8_t const > & data)
+{
+    while (!data.empty())
+    {
+        auto & b = buffers_[active_];
+        if (b.size_ == capacity_)
+        {
+            if (sending_)
+                break;
+            start();
+            continue;
+        }
+        auto const n = std::min < size_t >(data.size(), capacity_ - b.size_);
+        std::memcpy(b.data_ + b.size_, data.data(), n);
+        b.size_ += static_cast < uint32_t >(n);
+        data = data.subspan(n);
+    }
+
+    auto const size = buffers_[active_].size_;
+    if (size == capacity_ && !sending_)
+        start();
+    else
+    if (size != 0 && !sending_ && !deferred_)
+    {
+        //  the rest of this pass gets to add to it
+        deferred_ = true;
+        socket_.ring().defer(deferred_event_);
+    }
+    return data.empty();
+}
+
+void buffered_writer_t::wait(std::coroutine_handle<> coroutine, std::span < uint8_t const > data)
+{
+    waiter_ = coroutine;
+    pending_ = data;
+    flushing_ = data.empty();
+    if (!sending_ && buffers_[active_].size_ != 0)
+        start();
+}
+
+void buffered_writer_t::start()
+{
+    sending_ = true;
+    offset_ = 0;
+    active_ ^= 1;
+    send();
+}
+
+void buffered_writer_t::send()
+{
+    auto & b = buffers_[active_ ^ 1];
+    auto & ring = socket_.ring();
+    auto const fd = std::to_underlying(socket_.fd());
+    if (b.index_)
+        ring.prepare(*send_event_, &io_uring_prep_write_fixed, fd, b.data_ + offset_, b.size_ - offset_, uint64_t{0}, static_cast < int >(*b.index_));
+    else
+        ring.prepare(*send_event_, &io_uring_prep_send, fd, b.data_ + offset_, size_t{b.size_ - offset_}, 0);
+    ring.submit();
+}
+
+void buffered_writer_t::resume()
+{
+    if (waiter_)
+        std::exchange(waiter_, nullptr).resume();
+}
+
+void buffered_writer_t::on_deferred(ring_t::posted_t & p, bool const run)
+{
+    auto & self = static_cast < deferred_t & >(p).self_;
+    self.deferred_ = false;
+    if (run && !self.sending_ && self.buffers_[self.active_].size_ != 0)
+        self.start();
+}
+
+void buffered_writer_t::on_send(io_uring_cqe * cqe, ring_t::event_t & e)
+{
+    auto & event = static_cast < send_event_t & >(e);
+    //  the writer is gone
+    if (event.self_ == nullptr)
+    {
+        delete &event;
+        return;
+    }
+
+    trace::scope_t const span{"on_buffered_send", &e};
+    auto & self = *event.self_;
+    auto & b = self.buffers_[self.active_ ^ 1];
+    if (cqe->res <= 0)
+    {
+        self.error_ = cqe->res == 0 ? -EPIPE : cqe->res;
+        logc(self.socket_, "Buffered send failed... sent = {} error = {}", self.sent_, self.error_);
+        self.sending_ = false;
+        for (auto & buffer : self.buffers_)
+            buffer.size_ = 0;
+        self.resume();
+        return;
+    }
+
+    self.sent_ += static_cast < uint64_t >(cqe->res);
+    self.offset_ += static_cast < uint32_t >(cqe->res);
+    if (self.offset_ < b.size_)
+    {
+        self.send();
+        return;
+    }
+
+    b.size_ = 0;
+    self.sending_ = false;
+    //  whatever piled up while this one was on its way has had its chance to coalesce
+    if (self.waiter_ && !self.pending_.empty())
+        self.append(self.pending_);
+    if (!self.sending_ && self.buffers_[self.active_].size_ != 0)
+        self.start();
+
+    if (self.waiter_ && (self.flushing_ ? self.idle() : self.pending_.empty()))
+        self.resume();
+}
+
+buffered_reader_t::read_result_t buffered_reader_t::take(size_t const size)
+{
+    consumed_ = size;
+    scanned_ = 0;
+    return std::span < uint8_t const >{buffer_.data() + head_ % buffer_.capacity(), size};
+}
+
+coroutine::awaitable_t < bool > buffered_reader_t::fill()
+{
+    auto const used = tail_ - head_;
+    auto rr = co_await socket_.recv(std::span < uint8_t >{buffer_.data() + tail_ % buffer_.capacity(), buffer_.capacity() - used});
+    if (!rr.has_value())
+    {
+        error_ = rr.error();
+        co_return false;
+    }
+    tail_ += static_cast < uint64_t >(rr.value());
+    co_return true;
+}
+
+coroutine::awaitable_t < buffered_reader_t::read_result_t > buffered_reader_t::read_until(uint8_t const delimiter)
+{
+    head_ += std::exchange(consumed_, 0);
+    while (true)
+    {
+        auto const * const at = buffer_.data() + head_ % buffer_.capacity();
+        auto const available = tail_ - head_;
+        if (auto const * p = static_cast < uint8_t const * >(std::memchr(at + scanned_, delimiter, available - scanned_)); p)
+            co_return take(static_cast < size_t >(p - at) + 1);
+        scanned_ = available;
+        if (available == buffer_.capacity())
+            co_return std::unexpected(-EMSGSIZE);
+        if (!co_await fill())
+            co_return std::unexpected(error_);
+    }
+}
+
+coroutine::awaitable_t < buffered_reader_t::read_result_t > buffered_reader_t::read_exactly(size_t const size)
+{
+    head_ += std::exchange(consumed_, 0);
+    if (size > buffer_.capacity())
+        co_return std::unexpected(-EMSGSIZE);
+    while (tail_ - head_ < size)
+        if (!co_await fill())
+            co_return std::unexpected(error_);
+    co_return take(size);
+}
+
+coroutine::awaitable_t < buffered_reader_t::read_result_t > buffered_reader_t::read_some()
+{
+    head_ += std::exchange(consumed_, 0);
+    if (tail_ == head_ && !co_await fill())
+        co_return std::unexpected(error_);
+    co_return take(tail_ - head_);
+}
+
+}
@@ -0,0 +1,178 @@
+#include "iouring.hpp"
+
+#include "iouring_impl.hpp"
+
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+
+namespace zsl::iouring::chain
+{
+
+link_t & chain_base_t::add(link_t::op_t const op, int32_t const fd)
+{
+    if (count_ == links_.size())
+        throw std::length_error("chain full");
+    auto & l = links_[count_++];
+    l = link_t{.op_ = op, .fd_ = fd};
+    return l;
+}
+
+chain_base_t & chain_base_t::nop()
+{
+    add(link_t::op_t::NOP, -1);
+    return *this;
+}
+
+chain_base_t & chain_base_t::recv(int32_t const fd, std::span < uint8_t > buf, uint32_t const flags)
+{
+    auto & l = add(link_t::op_t::RECV, fd);
+    l.buf_ = buf.data();
+    l.len_ = static_cast < uint32_t >(buf.size());
+    l.flags_ = flags;
+    return *this;
+}
+
+chain_base_t & chain_base_t::send(int32_t const fd, std::span < uint8_t const > buf, uint32_t const flags)
+{
+    auto & l = add(link_t::op_t::SEND, fd);
+    l.buf_ = const_cast < uint8_t * >(buf.data());
+    l.len_ = static_cast < uint32_t >(buf.size());
+    l.flags_ = flags;
+    return *this;
+}
+
+chain_base_t & chain_base_t::read(int32_t const fd, std::span < uint8_t > buf, uint64_t const offset)
+{
+    auto & l = add(link_t::op_t::READ, fd);
+    l.buf_ = buf.data();
+    l.len_ = static_cast < uint32_t >(buf.size());
+    l.offset_ = offset;
+    return *this;
+}
+
+chain_base_t & chain_base_t::write(int32_t const fd, std::span < uint8_t const > buf, uint64_t const offset)
+{
+    auto & l = add(link_t::op_t::WRITE, fd);
+    l.buf_ = const_cast < uint8_t * >(buf.data());
+    l.len_ = static_cast < uint32_t >(buf.size());
+    l.offset_ = offset;
+    return *this;
+}
+
+chain_base_t & chain_base_t::read_fixed(int32_t const fd, std::span < uint8_t > buf, uint64_t const offset, uint16_t const index)
+{
+    auto & l = add(link_t::op_t::READ_FIXED, fd);
+    l.buf_ = buf.data();
+    l.len_ = static_cast < uint32_t >(buf.size());
+    l.offset_ = offset;
+    l.buf_index_ = index;
+    return *this;
+}
+
+chain_base_t & chain_base_t::write_fixed(int32_t const fd, std::span < uint8_t const > buf, uint64_t const offset, uint16_t const index)
+{
+    auto & l = add(link_t::op_t::WRITE_FIXED, fd);
+    l.buf_ = const_cast < uint8_t * >(buf.data());
+    l.len_ = static_cast < uint32_t >(buf.size());
+    l.offset_ = offset;
+    l.buf_index_ = index;
+    return *this;
+}
+
+chain_base_t & chain_base_t::fsync(int32_t const fd, uint32_t const flags)
+{
+    auto & l = add(link_t::op_t::FSYNC, fd);
+    l.flags_ = flags;
+    return *this;
+}
+
+chain_base_t & chain_base_t::hard()
+{
+    if (count_ > 0)
+        links_[count_ - 1].hard_ = true;
+    return *this;
+}
+
+void chain_base_t::await_suspend(std::coroutine_handle<> coroutine)
+{
+    coroutine_ = coroutine;
+    error_.reset();
+    last_ = 0;
+
+    //  the whole chain in one submission, a link whose successor isn't in the same one just ends the chain
+    ring_.reserve(count_);
+    for (uint32_t i = 0; i < count_; ++i)
+    {
+        auto & e = events_[i];
+        e.handler_ = &on_link;
+        e.coroutine_ = coroutine;
+        e.cancelled_ = false;
+        e.self_ = this;
+        e.index_ = i;
+
+        uint8_t flags{0};
+        if (i + 1 < count_)
+            flags = (links_[i].hard_ ? IOSQE_IO_HARDLINK : IOSQE_IO_LINK) | IOSQE_CQE_SKIP_SUCCESS;
+
+        ring_.prepare(e, [] (io_uring_sqe * sqe, link_t const & l, uint8_t const flags)
+        {
+            switch (l.op_)
+            {
+            case link_t::op_t::NOP:
+                io_uring_prep_nop(sqe);
+                break;
+            case link_t::op_t::RECV:
+                io_uring_prep_recv(sqe, l.fd_, l.buf_, l.len_, static_cast < int >(l.flags_));
+                break;
+            case link_t::op_t::SEND:
+                io_uring_prep_send(sqe, l.fd_, l.buf_, l.len_, static_cast < int >(l.flags_));
+                break;
+            case link_t::op_t::READ:
+                io_uring_prep_read(sqe, l.fd_, l.buf_, l.len_, l.offset_);
+                break;
+            case link_t::op_t::WRITE:
+                io_uring_prep_write(sqe, l.fd_, l.buf_, l.len_, l.offset_);
+                break;
+            case link_t::op_t::READ_FIXED:
+                io_uring_prep_read_fixed(sqe, l.fd_, l.buf_, l.len_, l.offset_, l.buf_index_);
+                break;
+            case link_t::op_t::WRITE_FIXED:
+                io_uring_prep_write_fixed(sqe, l.fd_, l.buf_, l.len_, l.offset_, l.buf_index_);
+                break;
+            case link_t::op_t::FSYNC:
+                io_uring_prep_fsync(sqe, l.fd_, l.flags_);
+                break;
+            }
+            io_uring_sqe_set_flags(sqe, flags);
+        }, links_[i], flags);
+    }
+    ring_.submit();
+}
+
+void chain_base_t::on_link(io_uring_cqe * cqe, ring_t::event_t & e)
+{
+    auto & le = static_cast < event_t & >(e);
+    auto & self = *le.self_;
+    auto const last = le.index_ + 1 == self.count_;
+
+    //  links before the last only complete when they fail, a short transfer failing with its byte count
+    if ((!last || cqe->res < 0) && !self.error_)
+        self.error_ = error_t{le.index_, cqe->res};
+    if (last)
+        self.last_ = cqe->res;
+
+    //  a soft link failing is the chain's only completion, the kernel skips the cancelled links after it.  past a
+    //  hard link the chain goes on to its last link
+    if (last || !self.links_[le.index_].hard_)
+        e.resume();
+}
+
+void chain_base_t::cancel()
+{
+    for (uint32_t i = 0; i < count_; ++i)
+        ring_.cancel(events_[i]);
+    ring_.submit();
+}
+
+}
@@ -0,0 +1,355 @@
+#include "iouring_connection_table.hpp"
+#include "iouring_impl.hpp"
+#include "iouring_utils_time.hpp"
+
+#include <clock/clock.hpp>
+#include <logging/logging.hpp>
+
+#include <cassert>
+#include <cstdint>
+#include <chrono>
+#include <stdexcept>
+#include <utility>
+
+#include <liburing/io_uring.h>
+#include <liburing.h>
+
+namespace
+{
+
+using zsl::logging::log;
+using namespace zsl::iouring;
+using namespace zsl::iouring::net;
+
+using state_t = connection_table_t::connection_t::state_t;
+
+//  as of the ring's current pass, a thread local load rather than a clock read per message
+uint64_t now_ns()
+{
+    return static_cast < uint64_t >(zsl::clock::coarse_clock_t::now().time_since_epoch().count());
+}
+
+}
+
+namespace zsl::iouring::net
+{
+
+connection_table_t::connection_table_t(ring_t & ring, tcp_socket_t & listener, on_data_t on_data, options_t const & options)
+    : ring_{ring}
+    , listener_{listener}
+    , on_data_{std::move(on_data)}
+    , options_{options}
+    , connections_(options.capacity_)
+    , buffers_{std::make_unique < uint8_t[] >(size_t{options.buffer_size_} * options.buffer_count_)}
+{
+    if (options_.buffer_count_ == 0 || (options_.buffer_count_ & (options_.buffer_count_ - 1)) != 0 || options_.buffer_count_ > 32768)
+        throw std::invalid_argument("buffer count must be a power of two up to 32768");
+
+    for (uint32_t i = 0; i < connections_.size(); ++i)
+    {
+        connections_[i].handler_ = &on_connection;
+        connections_[i].table_ = this;
+        connections_[i].slot_ = i;
+    }
+
+    ring_.register_files_sparse(options_.capacity_);
+    buffer_ring_ = ring_.setup_buffer_ring(options_.buffer_count_, options_.buffer_group_);
+    for (uint16_t i = 0; i < options_.buffer_count_; ++i)
+        io_uring_buf_ring_add(buffer_ring_, buffer(i), options_.buffer_size_, i, io_uring_buf_ring_mask(options_.buffer_count_), i);
+    io_uring_buf_ring_advance(buffer_ring_, static_cast < int >(options_.buffer_count_));
+
+    sweep_ts_ = utils::time::to_timespec(options_.sweep_interval_);
+    logc(this, "Connection table... capacity = {} buffers = {} x {}", options_.capacity_, options_.buffer_count_, options_.buffer_size_);
+}
+
+connection_table_t::~connection_table_t()
+{
+    assert(stopped() || !ring_.reaping());
+    if (!stopped())
+    {
+        if (!stopping_)
+            stop();
+        while (!stopped())
+            ring_.wait_for_events();
+    }
+    ring_.free_buffer_ring(buffer_ring_, options_.buffer_count_, options_.buffer_group_);
+    ring_.unregister_files();
+}
+
+uint8_t * connection_table_t::buffer(uint16_t const id)
+{
+    return buffers_.get() + size_t{id} * options_.buffer_size_;
+}
+
+void connection_table_t::give_back(uint16_t const id)
+{
+    io_uring_buf_ring_add(buffer_ring_, buffer(id), options_.buffer_size_, id, io_uring_buf_ring_mask(options_.buffer_count_), 0);
+    io_uring_buf_ring_advance(buffer_ring_, 1);
+
+    //  one buffer, one waiter
+    if (starved_ != no_connection)
+    {
+        auto & c = connections_[starved_];
+        starved_ = std::exchange(c.next_starved_, no_connection);
+        receive(c);
+    }
+}
+
+void connection_table_t::start()
+{
+    stopping_ = false;
+    accept();
+    ring_.prepare(sweep_event_, &io_uring_prep_timeout, &sweep_ts_, 0U, 0U);
+    sweep_event_.armed_ = true;
+    ring_.submit();
+}
+
+void connection_table_t::stop()
+{
+    stopping_ = true;
+    if (accept_event_.armed_)
+        ring_.cancel(accept_event_);
+    if (sweep_event_.armed_)
+        ring_.cancel(sweep_event_);
+    for (auto & c : connections_)
+        if (c.state_ != state_t::FREE && c.state_ != state_t::CLOSING)
+            close(c);
+    ring_.submit();
+}
+
+bool connection_table_t::stopped() const
+{
+    return stopping_ && stats_.active_ == 0 && !accept_event_.armed_ && !sweep_event_.armed_;
+}
+
+void connection_table_t::accept()
+{
+    ring_.prepare(accept_event_, &io_uring_prep_multishot_accept_direct, std::to_underlying(listener_.fd()), nullptr, nullptr, 0);
+    accept_event_.armed_ = true;
+    ring_.submit();
+}
+
+void connection_table_t::on_accept(io_uring_cqe * cqe, ring_t::event_t & e)
+{
+    auto & te = static_cast < table_event_t & >(e);
+    auto & t = te.table_;
+    if (!(cqe->flags & IORING_CQE_F_MORE))
+        te.armed_ = false;
+
+    if (cqe->res >= 0)
+    {
+        auto & c = t.connections_[static_cast < uint32_t >(cqe->res)];
+        c.state_ = state_t::RECEIVING;
+        c.last_activity_ = now_ns();
+        c.bytes_in_ = 0;
+        c.bytes_out_ = 0;
+        c.leased_ = false;
+        c.cancelled_ = false;
+        ++t.stats_.accepted_;
+        ++t.stats_.active_;
+        logc(&t, "Accepted... slot = {} active = {}", c.slot_, t.stats_.active_);
+        t.receive(c);
+    }
+    else
+    if (cqe->res == -ENFILE)
+    {
+        //  no free slot, accepting resumes when a connection goes away
+        ++t.stats_.rejected_;
+        logc(&t, "Table full... active = {}", t.stats_.active_);
+        return;
+    }
+    else
+    if (cqe->res != -ECANCELED)
+    {
+        logc(&t, "Accept failed... {}", cqe->res);
+    }
+
+    if (!te.armed_ && !t.stopping_ && cqe->res != -ECANCELED)
+        t.accept();
+}
+
+void connection_table_t::on_sweep(io_uring_cqe * cqe, ring_t::event_t & e)
+{
+    auto & te = static_cast < table_event_t & >(e);
+    auto & t = te.table_;
+    te.armed_ = false;
+    if (t.stopping_ || cqe->res == -ECANCELED)
+        return;
+    t.sweep();
+    t.ring_.prepare(te, &io_uring_prep_timeout, &t.sweep_ts_, 0U, 0U);
+    te.armed_ = true;
+    t.ring_.submit();
+}
+
+void connection_table_t::sweep()
+{
+    auto const now = now_ns();
+    auto const idle = static_cast < uint64_t >(std::chrono::duration_cast < std::chrono::nanoseconds >(options_.idle_timeout_).count());
+    for (auto & c : connections_)
+        if ((c.state_ == state_t::RECEIVING || c.state_ == state_t::STARVED) && now - c.last_activity_ > idle)
+        {
+            ++stats_.evicted_;
+            close(c);
+        }
+    ring_.submit();
+}
+
+void connection_table_t::receive(connection_t & c)
+{
+    c.state_ = state_t::RECEIVING;
+    ring_.prepare(c, [this] (io_uring_sqe * sqe, uint32_t const slot)
+    {
+        io_uring_prep_recv(sqe, static_cast < int >(slot), nullptr, options_.buffer_size_, 0);
+        io_uring_sqe_set_flags(sqe, IOSQE_FIXED_FILE | IOSQE_BUFFER_SELECT);
+        sqe->buf_group = options_.buffer_group_;
+    }, c.slot_);
+    ring_.submit();
+}
+
+void connection_table_t::send(connection_t & c)
+{
+    c.state_ = state_t::SENDING;
+    ring_.prepare(c, [] (io_uring_sqe * sqe, uint32_t const slot, uint8_t const * data, uint32_t const size)
+    {
+        io_uring_prep_send(sqe, static_cast < int >(slot), data, size, MSG_NOSIGNAL);
+        io_uring_sqe_set_flags(sqe, IOSQE_FIXED_FILE);
+    }, c.slot_, c.reply_ + c.reply_sent_, c.reply_size_ - c.reply_sent_);
+    ring_.submit();
+}
+
+void connection_table_t::on_connection(io_uring_cqe * cqe, ring_t::event_t & e)
+{
+    auto & c = static_cast < connection_t & >(e);
+    auto & t = *c.table_;
+    switch (c.state_)
+    {
+    case state_t::RECEIVING:
+        t.received(c, cqe);
+        break;
+    case state_t::SENDING:
+        t.sent(c, cqe);
+        break;
+    case state_t::CLOSING:
+        if (cqe->flags & IORING_CQE_F_BUFFER)
+            t.give_back(static_cast < uint16_t >(cqe->flags >> IORING_CQE_BUFFER_SHIFT));
+        t.release(c);
+        break;
+    default:
+        logc(&t, "Unexpected completion... slot = {} state = {} result = {}", c.slot_, std::to_underlying(c.state_), cqe->res);
+        break;
+    }
+}
+
+void connection_table_t::received(connection_t & c, io_uring_cqe const * cqe)
+{
+    if (cqe->res == -ENOBUFS)
+    {
+        ++stats_.starved_;
+        c.state_ = state_t::STARVED;
+        c.next_starved_ = std::exchange(starved_, c.slot_);
+        return;
+    }
+    if (cqe->res <= 0 || !(cqe->flags & IORING_CQE_F_BUFFER))
+    {
+        logc(this, "Connection closed... slot = {} result = {}", c.slot_, cqe->res);
+        c.state_ = state_t::CLOSING;
+        release(c);
+        return;
+    }
+
+    auto const id = static_cast < uint16_t >(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+    auto const size = static_cast < uint32_t >(cqe->res);
+    c.last_activity_ = now_ns();
+    c.bytes_in_ += size;
+
+    c.state_ = state_t::HANDLING;
+    auto const reply = on_data_(c, std::span < uint8_t const >{buffer(id), size});
+    if (c.state_ == state_t::CLOSING)
+    {
+        //  closed from inside the handler
+        give_back(id);
+        release(c);
+        return;
+    }
+    if (reply.empty())
+    {
+        give_back(id);
+        receive(c);
+        return;
+    }
+
+    c.buffer_ = id;
+    c.leased_ = true;
+    c.reply_ = reply.data();
+    c.reply_size_ = static_cast < uint32_t >(reply.size());
+    c.reply_sent_ = 0;
+    send(c);
+}
+
+void connection_table_t::sent(connection_t & c, io_uring_cqe const * cqe)
+{
+    if (cqe->res <= 0)
+    {
+        logc(this, "Send failed... slot = {} result = {}", c.slot_, cqe->res);
+        c.state_ = state_t::CLOSING;
+        release(c);
+        return;
+    }
+
+    c.bytes_out_ += static_cast < uint32_t >(cqe->res);
+    c.reply_sent_ += static_cast < uint32_t >(cqe->res);
+    if (c.reply_sent_ < c.reply_size_)
+    {
+        send(c);
+        return;
+    }
+
+    c.leased_ = false;
+    give_back(c.buffer_);
+    receive(c);
+}
+
+void connection_table_t::close(connection_t & c)
+{
+    switch (c.state_)
+    {
+    case state_t::RECEIVING:
+    case state_t::SENDING:
+        //  the operation in flight comes back cancelled and finishes the close
+        c.state_ = state_t::CLOSING;
+        ring_.prepare_detached(&io_uring_prep_cancel_fd, static_cast < int >(c.slot_), IORING_ASYNC_CANCEL_FD_FIXED | IORING_ASYNC_CANCEL_ALL);
+        ring_.submit();
+        break;
+    case state_t::STARVED:
+        for (auto * link = &starved_; *link != no_connection; link = &connections_[*link].next_starved_)
+            if (*link == c.slot_)
+            {
+                *link = std::exchange(c.next_starved_, no_connection);
+                break;
+            }
+        c.state_ = state_t::CLOSING;
+        release(c);
+        break;
+    default:
+        //  closing from inside on_data, received() finishes it
+        c.state_ = state_t::CLOSING;
+        break;
+    }
+}
+
+void connection_table_t::release(connection_t & c)
+{
+    if (std::exchange(c.leased_, false))
+        give_back(c.buffer_);
+    ring_.prepare_detached(&io_uring_prep_close_direct, c.slot_);
+    ring_.submit();
+    c.state_ = state_t::FREE;
+    ++stats_.closed_;
+    --stats_.active_;
+    logc(this, "Released... slot = {} in = {} out = {} active = {}", c.slot_, c.bytes_in_, c.bytes_out_, stats_.active_);
+
+    if (!accept_event_.armed_ && !stopping_)
+        accept();
+}
+
+}
@@ -0,0 +1,58 @@
+#include "iouring_framing.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <system_error>
+#include <utility>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace zsl::iouring::net::framing
+{
+
+mirrored_buffer_t::mirrored_buffer_t(size_t const capacity)
+{
+    auto const page = static_cast < size_t >(::sysconf(_SC_PAGESIZE));
+    auto const size = (std::max < size_t >(capacity, 1) + page - 1) / page * page;
+
+    auto const fd = ::memfd_create("zsl-mirrored-buffer", MFD_CLOEXEC);
+    if (fd < 0)
+        throw std::system_error(errno, std::generic_category(), "memfd_create");
+    if (::ftruncate(fd, static_cast < off_t >(size)) != 0)
+    {
+        auto const e = errno;
+        ::close(fd);
+        throw std::system_error(e, std::generic_category(), "ftruncate");
+    }
+
+    //  reserve twice the size and map the same pages over both halves
+    auto * const base = static_cast < uint8_t * >(::mmap(nullptr, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (base == MAP_FAILED)
+    {
+        auto const e = errno;
+        ::close(fd);
+        throw std::system_error(e, std::generic_category(), "mmap");
+    }
+    for (auto * half : {base, base + size})
+        if (::mmap(half, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)
+        {
+            auto const e = errno;
+            ::munmap(base, 2 * size);
+            ::close(fd);
+            throw std::system_error(e, std::generic_category(), "mmap");
+        }
+    //  the mappings keep the memory alive
+    ::close(fd);
+
+    data_ = base;
+    capacity_ = size;
+}
+
+mirrored_buffer_t::~mirrored_buffer_t()
+{
+    if (data_)
+        ::munmap(std::exchange(data_, nullptr), 2 * capacity_);
+}
+
+}
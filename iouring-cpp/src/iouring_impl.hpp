@@ -15,4 +15,10 @@ void ring_t::prepare(ring_t::event_t & e, F && f, Args &&... args)
     impl_->prepare(e, std::forward < F >(f), std::forward < Args >(args)...);
 }
 
+template < typename F, typename... Args >
+void ring_t::prepare_detached(F && f, Args &&... args)
+{
+    impl_->prepare_detached(std::forward < F >(f), std::forward < Args >(args)...);
+}
+
 }
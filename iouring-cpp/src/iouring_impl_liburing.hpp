@@ -1,12 +1,29 @@
 #pragma once
 
+#include "iouring_metrics.hpp"
 #include "iouring_service.hpp"
+#include "iouring_utils_mpsc.hpp"
 #include "iouring_utils_time.hpp"
 
+#include <clock/clock.hpp>
+
 #include <liburing/io_uring.h>
 #include <liburing.h>
+#include <sys/eventfd.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cerrno>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
 namespace zsl::iouring::impl::liburing
 {
 
@@ -40,40 +57,316 @@ struct impl_t
 
         uint32_t q_depth_{1024};
         io_uring ring_{liburing_init_ring(q_depth_, params_)};
+
+        data_t() = default;
+        data_t(data_t const &) = delete;
+        data_t & operator = (data_t const &) = delete;
+
+        ~data_t()
+        {
+            io_uring_queue_exit(&ring_);
+        }
+    };
+
+    //  eventfd other threads write to when they post work, the ring keeps one read pending on it
+    struct wakeup_t
+    {
+        int fd_{::eventfd(0, EFD_CLOEXEC)};
+        uint64_t value_{};                          //  read target of the pending read
+        std::atomic < bool > pending_{false};       //  written since the ring last woke up
+
+        wakeup_t()
+        {
+            if (fd_ < 0)
+                throw std::system_error(errno, std::generic_category(), "eventfd");
+        }
+
+        wakeup_t(wakeup_t const &) = delete;
+        wakeup_t & operator = (wakeup_t const &) = delete;
+
+        ~wakeup_t()
+        {
+            ::close(fd_);
+        }
     };
 
     ring_t & ring_;
 
     impl_t(ring_t & ring) : ring_{ring}
     {
+        arm_wakeup();
+        submit();
+    }
+
+    ~impl_t()
+    {
+        //  whatever never got to run still has to be released
+        run_posted(false);
+        ready_ = posted_.take();
+        run_posted(false);
+        run_deferred(false);
+    }
+
+    using event_tag_t = ring_t::event_tag_t;
+    using reap_mode_t = ring_t::reap_mode_t;
+    using run_mode_t = ring_t::run_mode_t;
+
+    inline constexpr static uint32_t reap_batch_size{256};
+    inline constexpr static uint16_t registered_buffer_slots{1024};
+    inline constexpr static uint32_t prefetch_distance{4};
+    inline constexpr static uint32_t spin_clock_interval{64};     //  CQ ring looks per clock read while spinning
+
+    static uint64_t encode(event_tag_t const tag, ring_t::event_t * e)
+    {
+        return std::bit_cast < uintptr_t >(e) | std::to_underlying(tag);
+    }
+
+    //  detached operations have no event, their opcode rides in the pointer bits instead
+    static uint64_t encode_detached(uint8_t const opcode)
+    {
+        return (uint64_t{opcode} << 8) | std::to_underlying(event_tag_t::DETACHED);
+    }
+
+    static uint8_t detached_opcode(uint64_t const user_data)
+    {
+        return static_cast < uint8_t >(user_data >> 8);
+    }
+
+    static uint64_t now_ns()
+    {
+        return static_cast < uint64_t >(clock::tsc_clock_t::now().time_since_epoch().count());
+    }
+
+    static auto decode(uint64_t const user_data)
+    {
+        return std::pair{static_cast < event_tag_t >(user_data & ring_t::event_tag_mask), std::bit_cast < ring_t::event_t * >(static_cast < uintptr_t >(user_data & ~ring_t::event_tag_mask))};
+    }
+
+    io_uring_sqe * get_sqe()
+    {
+        if (auto * sqe = io_uring_get_sqe(&data_.ring_); sqe) [[likely]]
+            return sqe;
+        //  submission queue full, flush it and try again
+        submit();
+        if (auto * sqe = io_uring_get_sqe(&data_.ring_); sqe)
+            return sqe;
+        throw std::runtime_error("io_uring submission queue full");
+    }
+
+    //  count free entries in a row, so operations linked together don't get split across two submissions
+    void reserve(uint32_t const count)
+    {
+        if (count > data_.ring_.sq.ring_entries)
+            throw std::runtime_error("io_uring submission queue too small");
+        if (io_uring_sq_space_left(&data_.ring_) < count)
+            submit();
     }
 
     template < typename F, typename... Args >
     auto prepare(ring_t::event_t & e, F && f, Args &&... args)
     {
-        auto * sqe = io_uring_get_sqe(&data_.ring_);
+        auto * sqe = get_sqe();
         //  log("Preparing... ring = {} sqe = {}", &ring_, sqe);
         std::forward < F >(f)(sqe, std::forward < Args >(args)...);
-        io_uring_sqe_set_data(sqe, &e);
+        io_uring_sqe_set_data64(sqe, encode(event_tag_t::HANDLER, &e));
+        e.opcode_ = sqe->opcode;
+        metrics_.prepared(sqe->opcode);
+        if (track_latency_)
+            e.prepared_at_ = now_ns();
+    }
+
+    template < typename F, typename... Args >
+    auto prepare_detached(F && f, Args &&... args)
+    {
+        auto * sqe = get_sqe();
+        std::forward < F >(f)(sqe, std::forward < Args >(args)...);
+        io_uring_sqe_set_data64(sqe, encode_detached(sqe->opcode));
+        metrics_.prepared(sqe->opcode);
+    }
+
+    void register_files_sparse(uint32_t const count)
+    {
+        if (auto const r = io_uring_register_files_sparse(&data_.ring_, count); r < 0)
+            throw std::system_error(-r, std::generic_category(), "io_uring_register_files_sparse");
+    }
+
+    void unregister_files()
+    {
+        io_uring_unregister_files(&data_.ring_);
+    }
+
+    std::optional < uint16_t > register_buffer(std::span < uint8_t > const buf)
+    {
+        if (!buffers_registered_)
+        {
+            if (io_uring_register_buffers_sparse(&data_.ring_, registered_buffer_slots) < 0)
+                return std::nullopt;
+            buffers_registered_ = true;
+            free_buffers_.resize(registered_buffer_slots);
+            for (uint16_t i = 0; i < registered_buffer_slots; ++i)
+                free_buffers_[i] = registered_buffer_slots - 1 - i;
+        }
+        if (free_buffers_.empty())
+            return std::nullopt;
+
+        auto const index = free_buffers_.back();
+        iovec iov{buf.data(), buf.size()};
+        uint64_t tag{0};
+        if (io_uring_register_buffers_update_tag(&data_.ring_, index, &iov, &tag, 1) < 0)
+            return std::nullopt;
+        free_buffers_.pop_back();
+        return index;
+    }
+
+    void unregister_buffer(uint16_t const index)
+    {
+        iovec iov{nullptr, 0};
+        uint64_t tag{0};
+        io_uring_register_buffers_update_tag(&data_.ring_, index, &iov, &tag, 1);
+        free_buffers_.push_back(index);
+    }
+
+    io_uring_buf_ring * setup_buffer_ring(uint32_t const entries, uint16_t const group)
+    {
+        int r{0};
+        if (auto * br = io_uring_setup_buf_ring(&data_.ring_, entries, group, 0, &r); br)
+            return br;
+        throw std::system_error(-r, std::generic_category(), "io_uring_setup_buf_ring");
+    }
+
+    void free_buffer_ring(io_uring_buf_ring * br, uint32_t const entries, uint16_t const group)
+    {
+        io_uring_free_buf_ring(&data_.ring_, br, entries, group);
+    }
+
+    void cancel(ring_t::event_t & e)
+    {
+        prepare_detached(&io_uring_prep_cancel64, encode(event_tag_t::HANDLER, &e), IORING_ASYNC_CANCEL_ALL);
+    }
+
+    int32_t fd() const
+    {
+        return data_.ring_.ring_fd;
+    }
+
+    void msg_ring(int32_t const target, ring_t::event_t & e, int32_t const res)
+    {
+        prepare_detached(&io_uring_prep_msg_ring, target, static_cast < uint32_t >(res), encode(event_tag_t::HANDLER, &e), 0U);
+        submit();
     }
 
     void submit()
     {
-        if (auto const r = io_uring_submit(&data_.ring_); r <= 0) [[unlikely]]
+        auto const r = io_uring_submit(&data_.ring_);
+        if (r <= 0) [[unlikely]]
             throw std::system_error(r, std::generic_category(), "io_uring_submit");
+        metrics_.submits_.add();
+        metrics_.sq_pending_.set(static_cast < uint64_t >(r));
+    }
+
+    void post(ring_t::posted_t & p)
+    {
+        posted_.push(p);
+        //  one write per wakeup, until the ring has seen it every other post rides along
+        if (!wakeup_.pending_.exchange(true, std::memory_order_seq_cst))
+            if (::eventfd_write(wakeup_.fd_, 1) != 0) [[unlikely]]
+                throw std::system_error(errno, std::generic_category(), "eventfd_write");
+    }
+
+    void arm_wakeup()
+    {
+        auto * sqe = get_sqe();
+        io_uring_prep_read(sqe, wakeup_.fd_, &wakeup_.value_, sizeof(wakeup_.value_), 0);
+        io_uring_sqe_set_data64(sqe, std::to_underlying(event_tag_t::WAKE));
+        metrics_.prepared(sqe->opcode);
     }
-    
+
+    void on_wakeup(io_uring_cqe const * cqe)
+    {
+        metrics_.completed(IORING_OP_READ, cqe->res);
+        metrics_.wakeups_.add();
+        //  cleared before the queue is drained so a post racing with the drain either gets drained or wakes us again
+        wakeup_.pending_.store(false, std::memory_order_seq_cst);
+        arm_wakeup();
+        submit();
+    }
+
+    //  one batch, whatever a handler posts in turn waits for the next pass
+    void run_posted(bool const run = true)
+    {
+        if (ready_ == nullptr)
+            ready_ = posted_.take();
+        while (ready_ != nullptr)
+        {
+            auto * p = std::exchange(ready_, ready_->next_);
+            if (run)
+                metrics_.posted_.add();
+            p->handler_(*p, run);
+        }
+    }
+
+    void defer(ring_t::posted_t & p)
+    {
+        p.next_ = std::exchange(deferred_, &p);
+    }
+
+    void undefer(ring_t::posted_t & p)
+    {
+        for (auto ** link = &deferred_; *link != nullptr; link = &(*link)->next_)
+            if (*link == &p)
+            {
+                *link = std::exchange(p.next_, nullptr);
+                return;
+            }
+    }
+
+    //  whatever a deferred handler defers in turn runs at the end of the next pass
+    void run_deferred(bool const run = true)
+    {
+        auto * p = std::exchange(deferred_, nullptr);
+        while (p != nullptr)
+            std::exchange(p, p->next_)->handler_(*p, run);
+    }
+
     void wait_for_events(size_t const count, std::chrono::nanoseconds const wait_timeout)
     {
         //  logc(&ring_, "Waiting for events...");
+        if (reaping_) [[unlikely]]
+            throw std::logic_error("wait_for_events from inside a completion handler");
+        metrics_.waits_.add();
+        auto timeout = wait_timeout;
+        if (run_mode_ != run_mode_t::BLOCK)
+        {
+            auto const spin_for = run_mode_ == run_mode_t::SPIN ? wait_timeout : std::min(spin_for_, wait_timeout);
+            if (spin(count, spin_for))
+            {
+                metrics_.spin_hits_.add();
+                reap();
+                return;
+            }
+            metrics_.spin_misses_.add();
+            if (run_mode_ == run_mode_t::SPIN)
+            {
+                clock::coarse_clock_t::tick();
+                run_deferred();
+                return;
+            }
+            timeout -= spin_for;
+        }
+
         io_uring_cqe * cqe = nullptr;
-        auto ts = zsl::iouring::utils::time::to_timespec(wait_timeout);
-        if (auto const r = io_uring_wait_cqes(&data_.ring_, &cqe, count, &ts, nullptr); r != 0) [[unlikely]]
+        auto ts = zsl::iouring::utils::time::to_timespec(timeout);
+        auto const slept_at = now_ns();
+        auto const r = io_uring_wait_cqes(&data_.ring_, &cqe, count, &ts, nullptr);
+        metrics_.idle_ns_.add(now_ns() - slept_at);
+        if (r != 0) [[unlikely]]
         {
             switch (r)
             {
             case -ETIME:
                 //  logc(&ring_, "Wait timed out...");
+                clock::coarse_clock_t::tick();
+                run_deferred();
                 return;
             default:
                 throw std::system_error(r, std::generic_category(), "io_uring_wait_cqes");
@@ -81,30 +374,200 @@ struct impl_t
         }
 
         //  logc(&ring_, "Wait over...");
+        reap();
+    }
+
+    void reap()
+    {
+        //  the one clock read of the pass, handlers after a timestamp take coarse_clock_t::now()
+        clock::coarse_clock_t::tick();
+        metrics_.cq_backlog_.set(io_uring_cq_ready(&data_.ring_));
+        if (io_uring_cq_has_overflow(&data_.ring_)) [[unlikely]]
+            metrics_.cq_overflow_events_.add();
+        metrics_.cq_overflow_.set(*data_.ring_.cq.koverflow);
+
+        reaping_ = true;
+        if (reap_mode_ == reap_mode_t::BATCH)
+            reap_batch();
+        else
+            reap_each();
+        reaping_ = false;
+
+        //  also picks up posts that arrived while a wakeup was already in flight, before its completion shows up
+        if (ready_ != nullptr || !posted_.empty())
+            run_posted();
+        run_deferred();
+    }
+
+    static void cpu_relax()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+
+    //  true once count completions are in the CQ ring, false when spin_for is up first.  the kernel posts them
+    //  there from whichever context completes the operation, so looking costs a load of the ring's tail
+    bool spin(size_t const count, std::chrono::nanoseconds const spin_for)
+    {
+        auto const spun_at = now_ns();
+        auto const until = spun_at + static_cast < uint64_t >(spin_for.count());
+        bool ready{false};
+        for (uint32_t i = 0; ; ++i)
+        {
+            if (io_uring_cq_ready(&data_.ring_) >= count)
+            {
+                ready = true;
+                break;
+            }
+            //  completions that overflowed only make it to the ring by entering the kernel
+            if (io_uring_cq_has_overflow(&data_.ring_)) [[unlikely]]
+                io_uring_get_events(&data_.ring_);
+            if (i % spin_clock_interval == 0 && now_ns() >= until)
+                break;
+            cpu_relax();
+        }
+        metrics_.spin_ns_.add(now_ns() - spun_at);
+        return ready;
+    }
+
+    void run_mode(run_mode_t const mode, std::chrono::nanoseconds const spin_for)
+    {
+        run_mode_ = mode;
+        spin_for_ = spin_for;
+    }
+
+    run_mode_t run_mode() const
+    {
+        return run_mode_;
+    }
+
+    bool busy_poll(std::chrono::microseconds const timeout, bool const prefer)
+    {
+        io_uring_napi napi{};
+        napi.busy_poll_to = static_cast < uint32_t >(timeout.count());
+        napi.prefer_busy_poll = prefer ? 1 : 0;
+        return io_uring_register_napi(&data_.ring_, &napi) == 0;
+    }
+
+    void no_busy_poll()
+    {
+        io_uring_unregister_napi(&data_.ring_, nullptr);
+    }
+
+    void reap_each()
+    {
+        io_uring_cqe * cqe = nullptr;
         uint32_t head{0};
         uint32_t completions{0};
         io_uring_for_each_cqe(&data_.ring_, head, cqe)
         {
-            if (auto * p = io_uring_cqe_get_data(cqe); p)
+            dispatch(cqe);
+            completions++;
+        }
+        if (completions != 0)
+            io_uring_cq_advance(&data_.ring_, completions);
+    }
+
+    void reap_batch()
+    {
+        std::array < io_uring_cqe *, reap_batch_size > cqes;
+        while (true)
+        {
+            auto const n = io_uring_peek_batch_cqe(&data_.ring_, cqes.data(), cqes.size());
+            if (n == 0)
+                return;
+
+            //  the handler and coroutine pointers live in the event, pull the next few in while dispatching the current one
+            for (uint32_t i = 0; i < std::min(n, prefetch_distance); ++i)
+                prefetch(cqes[i]);
+            for (uint32_t i = 0; i < n; ++i)
+            {
+                if (i + prefetch_distance < n)
+                    prefetch(cqes[i + prefetch_distance]);
+                dispatch(cqes[i]);
+            }
+            io_uring_cq_advance(&data_.ring_, n);
+
+            if (n < cqes.size())
+                return;
+        }
+    }
+
+    static void prefetch(io_uring_cqe const * cqe)
+    {
+        if (auto const [tag, e] = decode(cqe->user_data); tag == event_tag_t::HANDLER)
+            __builtin_prefetch(e, 0, 3);
+    }
+
+    void dispatch(io_uring_cqe * cqe)
+    {
+        metrics_.completions_.add();
+        auto const [tag, e] = decode(cqe->user_data);
+        switch (tag)
+        {
+        case event_tag_t::HANDLER:
+            if (e) [[likely]]
             {
-                //  log("Event... event = {}", p);
-                if (p)
+                metrics_.completed(e->opcode_, cqe->res);
+                if (track_latency_) [[unlikely]]
                 {
-                    auto & e = *reinterpret_cast < ring_t::event_t * >(p);
-                    //  log("Calling handler... handler_ = {} event = {}", e.handler_, &e);
-                    e.handler_(cqe, e);
+                    //  the handler may well destroy the event
+                    auto const opcode = e->opcode_;
+                    auto const prepared_at = e->prepared_at_;
+                    auto const t0 = now_ns();
+                    e->handler_(cqe, *e);
+                    if (prepared_at != 0 && prepared_at <= t0)
+                        metrics_.ops_[opcode % metrics::op_count].latency_.record(t0 - prepared_at);
+                    metrics_.handler_ns_.add(now_ns() - t0);
+                }
+                else
+                {
+                    //  log("Calling handler... handler_ = {} event = {}", e->handler_, e);
+                    e->handler_(cqe, *e);
                 }
             }
             else
             {
-                log("No event... {}", p);
+                log("No event... {}", (void *)e);
             }
-            completions++;
+            break;
+        case event_tag_t::DETACHED:
+            metrics_.completed(detached_opcode(cqe->user_data), cqe->res);
+            break;
+        case event_tag_t::WAKE:
+            on_wakeup(cqe);
+            break;
+        default:
+            log("Unknown event tag... {} event = {}", std::to_underlying(tag), (void *)e);
+            break;
         }
-        if (completions != 0)
-            io_uring_cq_advance(&data_.ring_, completions);
     }
 
+    void reap_mode(reap_mode_t const mode)
+    {
+        reap_mode_ = mode;
+    }
+
+    reap_mode_t reap_mode() const
+    {
+        return reap_mode_;
+    }
+
+    reap_mode_t reap_mode_{reap_mode_t::BATCH};
+    bool reaping_{false};
+    run_mode_t run_mode_{run_mode_t::BLOCK};
+    std::chrono::nanoseconds spin_for_{ring_t::default_spin_interval};
+    bool track_latency_{false};
+    metrics::ring_metrics_t metrics_{};
+    utils::mpsc::queue_t < ring_t::posted_t > posted_{};
+    ring_t::posted_t * ready_{nullptr};             //  taken off posted_ but not run yet
+    ring_t::posted_t * deferred_{nullptr};          //  to run at the end of this pass, see defer()
+    std::vector < uint16_t > free_buffers_{};       //  registered buffer slots
+    bool buffers_registered_{false};
+    wakeup_t wakeup_{};                             //  outlives the ring, the kernel may still write value_ until then
     data_t data_{};
 };
 
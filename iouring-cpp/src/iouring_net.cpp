@@ -11,9 +11,11 @@
 #include <iostream>
 #include <utility>
 #include <stdexcept>
+#include <system_error>
 
 #include <liburing/io_uring.h>
 #include <liburing.h>
+#include <fcntl.h>
 #include <unistd.h>
 
 import zsl.types.bitset;
@@ -42,11 +44,80 @@ auto to_sockaddr(ipaddressv4_t const & ip, ipport_t const & port)
     return sockaddr_in{ .sin_family = AF_INET, .sin_port = to_native(port), .sin_addr = to_native(ip), .sin_zero = 0 };
 }
 
+void send_file_step(socket_t::send_file_event_t & sfe)
+{
+    using stage_t = socket_t::send_file_event_t::stage_t;
+
+    auto & c = sfe.context_;
+    auto & r = sfe.request_;
+    auto & ring = c.self_.ring();
+
+    //  never resume from here, this may run inside await_suspend
+    auto const now = steady_clock_t::now();
+    if (now >= r.deadline_)
+    {
+        c.stage_ = stage_t::EXPIRED;
+        ring.prepare(sfe, &io_uring_prep_nop);
+        ring.submit();
+        return;
+    }
+
+    auto const link = r.deadline_ != deadline_t::max();
+    auto const flags = link ? IOSQE_IO_LINK : 0;
+    auto const splice = [] (io_uring_sqe * sqe, int32_t const in, int64_t const off_in, int32_t const out, uint32_t const len, uint8_t const flags)
+    {
+        io_uring_prep_splice(sqe, in, off_in, out, -1, len, SPLICE_F_MOVE | SPLICE_F_MORE);
+        io_uring_sqe_set_flags(sqe, flags);
+    };
+
+    if (c.stage_ == stage_t::FILL)
+    {
+        auto const len = static_cast < uint32_t >(std::min < uint64_t >(c.pipe_.capacity(), r.length_ - c.filled_));
+        ring.prepare(sfe, splice, std::to_underlying(r.file_), static_cast < int64_t >(r.offset_ + c.filled_), std::to_underlying(c.pipe_.write_fd()), len, flags);
+    }
+    else
+    {
+        ring.prepare(sfe, splice, std::to_underlying(c.pipe_.read_fd()), int64_t{-1}, std::to_underlying(c.self_.fd()), c.pending_, flags);
+    }
+
+    if (link)
+    {
+        c.timeout_ = zsl::iouring::utils::time::to_timespec(r.deadline_ - now);
+        ring.prepare_detached(&io_uring_prep_link_timeout, &c.timeout_, 0U);
+    }
+    ring.submit();
+}
+
 }
 
 namespace zsl::iouring::net
 {
 
+pipe_t::pipe_t(size_t const capacity)
+{
+    int fds[2]{-1, -1};
+    if (::pipe2(fds, O_CLOEXEC) != 0)
+        throw std::system_error(errno, std::generic_category(), "pipe2");
+    read_fd_ = fd_t{fds[0]};
+    write_fd_ = fd_t{fds[1]};
+    //  the kernel rounds the size up to a power of two pages, read back what we actually got
+    if (auto const r = ::fcntl(fds[1], F_SETPIPE_SZ, static_cast < int >(capacity)); r > 0)
+        capacity_ = static_cast < size_t >(r);
+    else
+    if (auto const r = ::fcntl(fds[1], F_GETPIPE_SZ); r > 0)
+        capacity_ = static_cast < size_t >(r);
+    else
+        capacity_ = default_capacity;
+}
+
+pipe_t::~pipe_t()
+{
+    if (read_fd_ != invalid_fd)
+        ::close(std::to_underlying(std::exchange(read_fd_, invalid_fd)));
+    if (write_fd_ != invalid_fd)
+        ::close(std::to_underlying(std::exchange(write_fd_, invalid_fd)));
+}
+
 socket_t::~socket_t()
 {
     logc(*this, "Destructor...");
@@ -55,14 +126,10 @@ socket_t::~socket_t()
 
 bool socket_t::close()
 {
-    struct close_event_t : ring_t::event_t
-    {
-    };
-    static close_event_t ce{ { +[] (io_uring_cqe *, ring_t::event_t &) {} } };
-
     if (fd_ == invalid_socket_fd)
         return false;
-    ring_->prepare(ce, &io_uring_prep_cancel_fd, std::to_underlying(fd_), IORING_ASYNC_CANCEL_ALL);
+    //  everything still in flight on the socket completes with -ECANCELED and resumes whoever is waiting for it
+    ring_->prepare_detached(&io_uring_prep_cancel_fd, std::to_underlying(fd_), IORING_ASYNC_CANCEL_ALL);
     ring_->submit();
     logc(*this, "Closing...");
     return 0 != ::close(std::to_underlying(std::exchange(fd_, invalid_socket_fd)));
@@ -74,6 +141,20 @@ bool socket_t::bind(ipaddressv4_t const ip, ipport_t const port)
     return 0 == ::bind(std::to_underlying(fd_), std::bit_cast < sockaddr * >(&sa), sizeof(sa));
 }
 
+bool socket_t::reuse_address(bool const on)
+{
+    int const value = on ? 1 : 0;
+    return 0 == ::setsockopt(std::to_underlying(fd_), SOL_SOCKET, SO_REUSEADDR, &value, sizeof(value));
+}
+
+bool socket_t::busy_poll(duration_t const timeout, bool const prefer)
+{
+    int const usecs = static_cast < int >(timeout.count());
+    int const on = prefer ? 1 : 0;
+    return 0 == ::setsockopt(std::to_underlying(fd_), SOL_SOCKET, SO_BUSY_POLL, &usecs, sizeof(usecs))
+        && 0 == ::setsockopt(std::to_underlying(fd_), SOL_SOCKET, SO_PREFER_BUSY_POLL, &on, sizeof(on));
+}
+
 socket_t::send_awaitable_t socket_t::send(std::span < uint8_t const > const buf)
 {
     logc(*this, "Send starting... this = {} ", this);
@@ -91,14 +172,51 @@ socket_t::send_awaitable_t socket_t::send(std::span < uint8_t const > const buf)
 
 void socket_t::on_send(io_uring_cqe * cqe, ring_t::event_t & e)
 {
-    if (cqe->res > 0)
+    trace::scope_t const span{"on_send", &e};
+    auto & se = static_cast < send_event_t & >(e);
+    if (cqe->res >= 0)
     {
-        auto & se = static_cast < send_event_t & >(e);
         logc(se.context_.self_, "Sent {} bytes...", cqe->res);
-        auto h = e.coroutine_;
         std::exchange(se.response_.result_, send_result_t{std::move(cqe->res)});
-        h.resume();
     }
+    else
+    {
+        logc(se.context_.self_, "Send failed... {}", cqe->res);
+        std::exchange(se.response_.result_, send_result_t{std::unexpected(std::move(cqe->res))});
+    }
+    e.resume();
+}
+
+socket_t::sendv_awaitable_t socket_t::sendv(std::span < iovec const > const iov)
+{
+    logc(*this, "Send vector starting... this = {} buffers = {}", this, iov.size());
+    return sendv_awaitable_t {
+            ring(),
+            sendv_event_t
+            {
+                {&on_sendv},
+                {.self_ = *this},
+                { iov },
+                {}
+            }
+           };
+}
+
+void socket_t::on_sendv(io_uring_cqe * cqe, ring_t::event_t & e)
+{
+    trace::scope_t const span{"on_sendv", &e};
+    auto & se = static_cast < sendv_event_t & >(e);
+    if (cqe->res >= 0)
+    {
+        logc(se.context_.self_, "Sent {} bytes...", cqe->res);
+        std::exchange(se.response_.result_, send_result_t{std::move(cqe->res)});
+    }
+    else
+    {
+        logc(se.context_.self_, "Send vector failed... {}", cqe->res);
+        std::exchange(se.response_.result_, send_result_t{std::unexpected(std::move(cqe->res))});
+    }
+    e.resume();
 }
 
 socket_t::recv_awaitable_t socket_t::recv(std::span < uint8_t > buf)
@@ -118,6 +236,7 @@ socket_t::recv_awaitable_t socket_t::recv(std::span < uint8_t > buf)
 
 void socket_t::on_recv(io_uring_cqe * cqe, ring_t::event_t & e)
 {
+    trace::scope_t const span{"on_recv", &e};
     recv_event_t & re = static_cast < recv_event_t & >(e);
     log("fd[{}]: On receive.. event = {} self_ = {} coroutine = {}", re.context_.self_, &re, &re.context_.self_, re.coroutine_);
     if (cqe->res > 0)
@@ -136,13 +255,103 @@ void socket_t::on_recv(io_uring_cqe * cqe, ring_t::event_t & e)
         log("fd[{}]: Failed with... {}", re.context_.self_, cqe->res);
         std::exchange(re.response_.result_, recv_result_t{std::unexpected(std::move(cqe->res))});
     }
-    e.coroutine_.resume();
+    e.resume();
     // h.destroy();
 }
 
-bool tcp_socket_t::listen()
+socket_t::send_file_awaitable_t socket_t::send_file(fd_t const file, uint64_t const offset, uint64_t const length, deadline_t const deadline, send_file_progress_t progress, size_t const chunk_size)
+{
+    logc(*this, "Send file starting... file = {} offset = {} length = {}", std::to_underlying(file), offset, length);
+    return send_file_awaitable_t {
+            ring(),
+            send_file_event_t
+            {
+                {&on_send_file},
+                {.self_ = *this, .pipe_ = pipe_t{chunk_size}},
+                {.file_ = file, .offset_ = offset, .length_ = length, .deadline_ = deadline, .progress_ = std::move(progress)},
+                {}
+            }
+           };
+}
+
+void socket_t::on_send_file(io_uring_cqe * cqe, ring_t::event_t & e)
+{
+    trace::scope_t const span{"on_send_file", &e};
+    using stage_t = send_file_event_t::stage_t;
+
+    auto & sfe = static_cast < send_file_event_t & >(e);
+    auto & c = sfe.context_;
+    auto & r = sfe.request_;
+    auto & sent = sfe.response_.sent_;
+
+    if (c.stage_ == stage_t::EXPIRED)
+    {
+        logc(c.self_, "Send file deadline passed... sent = {}", sent);
+        std::exchange(sfe.response_.result_, std::unexpected(-ETIME));
+        e.resume();
+        return;
+    }
+
+    if (cqe->res < 0)
+    {
+        //  a chunk cancelled by its linked timeout means the deadline has passed
+        auto const err = cqe->res == -ECANCELED && steady_clock_t::now() >= r.deadline_ ? -ETIME : cqe->res;
+        logc(c.self_, "Send file failed... sent = {} error = {}", sent, err);
+        std::exchange(sfe.response_.result_, std::unexpected(err));
+        e.resume();
+        return;
+    }
+
+    if (c.stage_ == stage_t::FILL)
+    {
+        if (cqe->res == 0)
+        {
+            logc(c.self_, "Send file reached EOF... sent = {}", sent);
+            std::exchange(sfe.response_.result_, send_file_result_t{sent});
+            e.resume();
+            return;
+        }
+        c.filled_ += cqe->res;
+        c.pending_ = static_cast < uint32_t >(cqe->res);
+        c.stage_ = stage_t::DRAIN;
+    }
+    else
+    {
+        if (cqe->res == 0)
+        {
+            std::exchange(sfe.response_.result_, std::unexpected(-EPIPE));
+            e.resume();
+            return;
+        }
+        sent += cqe->res;
+        c.pending_ -= static_cast < uint32_t >(cqe->res);
+        if (c.pending_ == 0)
+        {
+            if (r.progress_)
+                r.progress_(sent, r.length_);
+            if (c.filled_ == r.length_)
+            {
+                logc(c.self_, "Send file complete... sent = {}", sent);
+                std::exchange(sfe.response_.result_, send_file_result_t{sent});
+                e.resume();
+                return;
+            }
+            c.stage_ = stage_t::FILL;
+        }
+    }
+    if (e.cancelled_)
+    {
+        logc(c.self_, "Send file cancelled... sent = {}", sent);
+        std::exchange(sfe.response_.result_, std::unexpected(-ECANCELED));
+        e.resume();
+        return;
+    }
+    send_file_step(sfe);
+}
+
+bool tcp_socket_t::listen(int32_t const backlog)
 {
-    return 0 == ::listen(std::to_underlying(fd_), 8);
+    return 0 == ::listen(std::to_underlying(fd_), backlog);
 }
 
 tcp_socket_t::acceptor_t::accept_awaitable_t tcp_socket_t::acceptor_t::accept()
@@ -162,6 +371,7 @@ tcp_socket_t::acceptor_t::accept_awaitable_t tcp_socket_t::acceptor_t::accept()
 
 void tcp_socket_t::acceptor_t::on_accept(io_uring_cqe * cqe, ring_t::event_t & e)
 {
+    trace::scope_t const span{"on_accept", &e};
     auto & ae = static_cast < accept_event_t & >(e);
     logc(ae.context_.self_, "Accept complete... this = {} event = {} handler = {} coroutine = {} result = {}", ae.context_.self_, &ae, ae.handler_, ae.coroutine_, cqe->res);
     if (cqe->res > 0)
@@ -169,8 +379,12 @@ void tcp_socket_t::acceptor_t::on_accept(io_uring_cqe * cqe, ring_t::event_t & e
         socket_fd_t fd{cqe->res};
         tcp_socket_t cs{ae.context_.self_.ring_, fd};
         std::exchange(ae.response_.result_, accept_result_t{std::move(cs)});
-        e.coroutine_.resume();
     }
+    else
+    {
+        std::exchange(ae.response_.result_, accept_result_t{std::unexpected(cqe->res)});
+    }
+    e.resume();
 }
 
 socket_t::connect_awaitable_t socket_t::connect(ipaddressv4_t const & ip, ipport_t const & port)
@@ -190,6 +404,7 @@ socket_t::connect_awaitable_t socket_t::connect(ipaddressv4_t const & ip, ipport
 
 void socket_t::on_connect(io_uring_cqe * cqe, ring_t::event_t & e)
 {
+    trace::scope_t const span{"on_connect", &e};
     auto & ce = static_cast < connect_event_t & >(e);
     log("On connect... connect return = {} event = {} coroutine = {} this = {}", cqe->res, &ce, ce.coroutine_, &ce.context_.self_);
     if (cqe->res == 0)
@@ -203,7 +418,7 @@ void socket_t::on_connect(io_uring_cqe * cqe, ring_t::event_t & e)
         std::exchange(ce.response_.result_, connect_status_t::FAILED);
 
     }
-    e.coroutine_.resume();
+    e.resume();
 }
 
 }
@@ -229,6 +444,17 @@ void socket_t::send_awaitable_t::submit()
     ring_.submit();
 }
 
+template <>
+void socket_t::sendv_awaitable_t::submit()
+{
+    auto & msg = e_.context_.msg_;
+    msg = msghdr{};
+    msg.msg_iov = const_cast < iovec * >(e_.request_.iov_.data());
+    msg.msg_iovlen = e_.request_.iov_.size();
+    ring_.prepare(e_, &io_uring_prep_sendmsg, std::to_underlying(e_.context_.self_.fd()), &msg, 0U);
+    ring_.submit();
+}
+
 template <>
 void socket_t::recv_awaitable_t::submit()
 {
@@ -236,10 +462,22 @@ void socket_t::recv_awaitable_t::submit()
     ring_.submit();
 }
 
+template <>
+void socket_t::send_file_awaitable_t::submit()
+{
+    e_.context_.stage_ = send_file_event_t::stage_t::FILL;
+    if (e_.request_.length_ == 0)
+        ring_.prepare(e_, &io_uring_prep_nop);      //  completes as an immediate EOF
+    else
+        return send_file_step(e_);
+    ring_.submit();
+}
+
 template <>
 void tcp_socket_t::acceptor_t::accept_awaitable_t::submit()
 {
-    ring_.prepare(e_, &io_uring_prep_multishot_accept, std::to_underlying(e_.context_.self_.socket().fd()), (sockaddr *)nullptr, (uint32_t *)nullptr, 0);
+    //  single shot, every accept() is its own awaitable and event so a multishot accept would keep completing on an event that's gone
+    ring_.prepare(e_, &io_uring_prep_accept, std::to_underlying(e_.context_.self_.socket().fd()), (sockaddr *)nullptr, (socklen_t *)nullptr, 0);
     ring_.submit();
 }
 
@@ -0,0 +1,145 @@
+#include "iouring_pool.hpp"
+
+#include <logging/logging.hpp>
+
+#include <format>
+#include <utility>
+
+#include <pthread.h>
+
+namespace
+{
+
+using zsl::logging::log;
+using namespace zsl::iouring::pool;
+
+//  the pool and worker the current thread belongs to, if any
+thread_local void const * current_pool{nullptr};
+thread_local uint32_t current_index{0};
+
+//  rounds of stealing before a worker goes to sleep
+constexpr uint32_t const idle_spins{64};
+
+}
+
+namespace zsl::iouring::pool
+{
+
+pool_t::pool_t(uint32_t const workers)
+{
+    workers_.reserve(workers);
+    for (uint32_t i = 0; i < workers; ++i)
+        workers_.push_back(std::make_unique < worker_t >(*this, i));
+    //  all workers exist before any of them starts stealing
+    for (auto & w : workers_)
+        w->thread_ = std::jthread{[this, &w = *w] { run(w); }};
+    logc(this, "Pool started... workers = {}", workers);
+}
+
+pool_t::~pool_t()
+{
+    stopping_.store(true, std::memory_order_seq_cst);
+    epoch_.fetch_add(1, std::memory_order_seq_cst);
+    epoch_.notify_all();
+    for (auto & w : workers_)
+        w->thread_.join();
+    logc(this, "Pool stopped... steals = {}", steals());
+}
+
+void pool_t::submit(task_t & t)
+{
+    if (current_pool != this || !workers_[current_index]->deque_.push(&t))
+        inbox_.push(t);
+    wake();
+}
+
+void pool_t::wake()
+{
+    //  pairs with the sleeper's increment and has_work() check in run()
+    if (sleepers_.load(std::memory_order_seq_cst) != 0)
+    {
+        epoch_.fetch_add(1, std::memory_order_seq_cst);
+        epoch_.notify_one();
+    }
+}
+
+bool pool_t::has_work() const
+{
+    //  only what any worker can take, a sleeper that can't get at the work would spin rather than sleep
+    if (!inbox_.empty())
+        return true;
+    for (auto const & w : workers_)
+        if (!w->deque_.empty())
+            return true;
+    return false;
+}
+
+pool_t::task_t * pool_t::next(worker_t & w)
+{
+    if (auto * t = w.deque_.pop())
+        return t;
+
+    //  oldest first into the deque, so thieves get the oldest and this worker the newest.  whatever doesn't fit goes
+    //  back to the inbox for the others
+    if (auto * t = inbox_.take())
+    {
+        if (t->next_ != nullptr)
+        {
+            for (auto * n = std::exchange(t->next_, nullptr); n != nullptr; )
+            {
+                auto * next = std::exchange(n->next_, nullptr);
+                if (!w.deque_.push(n))
+                    inbox_.push(*n);
+                n = next;
+            }
+            //  a sleeper can steal some of the batch
+            wake();
+        }
+        return t;
+    }
+
+    auto const count = static_cast < uint32_t >(workers_.size());
+    for (uint32_t i = 1; i < count; ++i)
+    {
+        auto & victim = *workers_[(w.index_ + i) % count];
+        if (auto * t = victim.deque_.steal())
+        {
+            steals_.fetch_add(1, std::memory_order_relaxed);
+            return t;
+        }
+    }
+    return nullptr;
+}
+
+void pool_t::run(worker_t & w)
+{
+    current_pool = this;
+    current_index = w.index_;
+    auto const name = std::format("iouring-pool-{}", w.index_);
+    ::pthread_setname_np(::pthread_self(), name.substr(0, 15).c_str());
+
+    uint32_t idle{0};
+    while (!stopping_.load(std::memory_order_relaxed))
+    {
+        if (auto * t = next(w))
+        {
+            idle = 0;
+            t->coroutine_.resume();
+            continue;
+        }
+        if (++idle < idle_spins)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        auto const epoch = epoch_.load(std::memory_order_seq_cst);
+        sleepers_.fetch_add(1, std::memory_order_seq_cst);
+        if (!has_work() && !stopping_.load(std::memory_order_seq_cst))
+            epoch_.wait(epoch, std::memory_order_seq_cst);
+        sleepers_.fetch_sub(1, std::memory_order_seq_cst);
+        idle = 0;
+    }
+}
+
+}
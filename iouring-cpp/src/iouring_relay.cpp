@@ -0,0 +1,192 @@
+#include "iouring_relay.hpp"
+#include "iouring_impl.hpp"
+
+#include <logging/logging.hpp>
+
+#include <cstdint>
+#include <expected>
+#include <format>
+#include <utility>
+#include <stdexcept>
+
+#include <liburing/io_uring.h>
+#include <liburing.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace
+{
+
+using zsl::logging::log;
+using namespace zsl::iouring;
+using namespace zsl::iouring::net;
+
+using stage_t = relay_event_t::stage_t;
+
+constexpr uint32_t const splice_flags{SPLICE_F_MOVE | SPLICE_F_MORE};
+
+template < typename FD1, typename FD2 >
+void prepare_splice(ring_t & ring, relay_event_t & re, FD1 const in, FD2 const out, uint32_t const len)
+{
+    ring.prepare(re, &io_uring_prep_splice, std::to_underlying(in), int64_t{-1}, std::to_underlying(out), int64_t{-1}, len, splice_flags);
+    ring.submit();
+}
+
+//  issues the operation for the current stage
+void step(relay_event_t & re)
+{
+    auto & c = re.context_;
+    auto & ring = c.from_.ring();
+    switch (c.stage_)
+    {
+    case stage_t::SPLICE_IN:
+        prepare_splice(ring, re, c.from_.fd(), c.pipe_.write_fd(), re.request_.chunk_size_);
+        break;
+    case stage_t::TEE:
+    {
+        auto & t = c.to_[c.target_];
+        ring.prepare(re, &io_uring_prep_tee, std::to_underlying(c.pipe_.read_fd()), std::to_underlying(t.pipe_.write_fd()), c.pending_, 0U);
+        ring.submit();
+        break;
+    }
+    case stage_t::SPLICE_OUT:
+    {
+        auto & t = c.to_[c.target_];
+        prepare_splice(ring, re, t.pipe_.read_fd(), t.socket_->fd(), t.pending_);
+        break;
+    }
+    case stage_t::DRAIN:
+        prepare_splice(ring, re, c.pipe_.read_fd(), c.to_.front().socket_->fd(), c.pending_);
+        break;
+    }
+}
+
+void finish(relay_event_t & re, relay_result_t && r)
+{
+    std::exchange(re.response_.result_, std::move(r));
+    re.resume();
+}
+
+}
+
+namespace zsl::iouring::net
+{
+
+relay_awaitable_t relay(socket_t & from, socket_t & to, size_t const chunk_size)
+{
+    socket_t * const targets[]{&to};
+    return relay(from, std::span < socket_t * const >{targets}, chunk_size);
+}
+
+relay_awaitable_t relay(socket_t & from, std::span < socket_t * const > to, size_t const chunk_size)
+{
+    if (to.empty())
+        throw std::invalid_argument("relay needs at least one destination");
+
+    logc(from, "Relay starting... destinations = {} chunk size = {}", to.size(), chunk_size);
+    pipe_t pipe{chunk_size};
+    auto const chunk = static_cast < uint32_t >(std::min(chunk_size, pipe.capacity()));
+
+    std::vector < relay_event_t::target_t > targets;
+    targets.reserve(to.size());
+    for (auto * s : to)
+        targets.push_back({.socket_ = s, .pipe_ = targets.empty() ? pipe_t{} : pipe_t{pipe.capacity()}, .pending_ = 0});
+
+    return relay_awaitable_t {
+            from.ring(),
+            relay_event_t
+            {
+                {&on_relay},
+                {.from_ = from, .to_ = std::move(targets), .pipe_ = std::move(pipe)},
+                {.chunk_size_ = chunk},
+                {}
+            }
+           };
+}
+
+void on_relay(io_uring_cqe * cqe, ring_t::event_t & e)
+{
+    trace::scope_t const span{"on_relay", &e};
+    auto & re = static_cast < relay_event_t & >(e);
+    auto & c = re.context_;
+    auto & s = re.response_.stats_;
+    auto const res = cqe->res;
+
+    if (res < 0)
+    {
+        logc(c.from_, "Relay failed... stage = {} target = {} error = {}", std::to_underlying(c.stage_), c.target_, res);
+        return finish(re, std::unexpected(res));
+    }
+
+    switch (c.stage_)
+    {
+    case stage_t::SPLICE_IN:
+        if (res == 0)
+        {
+            logc(c.from_, "Relay source closed... {}", s);
+            return finish(re, relay_result_t{s});
+        }
+        ++s.splices_;
+        ++s.rounds_;
+        s.bytes_in_ += res;
+        c.pending_ = static_cast < uint32_t >(res);
+        c.target_ = 1;
+        c.stage_ = c.to_.size() > 1 ? stage_t::TEE : stage_t::DRAIN;
+        break;
+
+    case stage_t::TEE:
+        ++s.tees_;
+        //  tee always duplicates from the head of the source pipe, a short tee can't be continued without duplicating bytes twice
+        if (static_cast < uint32_t >(res) != c.pending_)
+        {
+            logc(c.from_, "Relay short tee... target = {} teed = {} pending = {}", c.target_, res, c.pending_);
+            return finish(re, std::unexpected(-EIO));
+        }
+        c.to_[c.target_].pending_ = c.pending_;
+        c.stage_ = stage_t::SPLICE_OUT;
+        break;
+
+    case stage_t::SPLICE_OUT:
+    {
+        if (res == 0)
+            return finish(re, std::unexpected(-EPIPE));
+        ++s.splices_;
+        s.bytes_out_ += res;
+        auto & t = c.to_[c.target_];
+        t.pending_ -= static_cast < uint32_t >(res);
+        if (t.pending_ == 0)
+            c.stage_ = ++c.target_ < c.to_.size() ? stage_t::TEE : stage_t::DRAIN;
+        break;
+    }
+
+    case stage_t::DRAIN:
+        if (res == 0)
+            return finish(re, std::unexpected(-EPIPE));
+        ++s.splices_;
+        s.bytes_out_ += res;
+        c.pending_ -= static_cast < uint32_t >(res);
+        if (c.pending_ == 0)
+            c.stage_ = stage_t::SPLICE_IN;
+        break;
+    }
+
+    if (re.cancelled_)
+        return finish(re, std::unexpected(-ECANCELED));
+    step(re);
+}
+
+}
+
+namespace zsl::iouring
+{
+
+using namespace net;
+
+template <>
+void relay_awaitable_t::submit()
+{
+    e_.context_.stage_ = relay_event_t::stage_t::SPLICE_IN;
+    step(e_);
+}
+
+}
@@ -44,6 +44,130 @@ void ring_t::submit()
     return impl_->submit();
 }
 
+void ring_t::reserve(uint32_t const count)
+{
+    impl_->reserve(count);
+}
+
+void ring_t::nop(event_t & e)
+{
+    impl_->prepare(e, &io_uring_prep_nop);
+}
+
+void ring_t::register_files_sparse(uint32_t const count)
+{
+    impl_->register_files_sparse(count);
+}
+
+void ring_t::unregister_files()
+{
+    impl_->unregister_files();
+}
+
+std::optional < uint16_t > ring_t::register_buffer(std::span < uint8_t > const buf)
+{
+    return impl_->register_buffer(buf);
+}
+
+void ring_t::unregister_buffer(uint16_t const index)
+{
+    impl_->unregister_buffer(index);
+}
+
+io_uring_buf_ring * ring_t::setup_buffer_ring(uint32_t const entries, uint16_t const group)
+{
+    return impl_->setup_buffer_ring(entries, group);
+}
+
+void ring_t::free_buffer_ring(io_uring_buf_ring * br, uint32_t const entries, uint16_t const group)
+{
+    impl_->free_buffer_ring(br, entries, group);
+}
+
+void ring_t::cancel(event_t & e)
+{
+    e.cancelled_ = true;
+    impl_->cancel(e);
+}
+
+void ring_t::msg_ring(ring_t & target, event_t & e, int32_t const res)
+{
+    impl_->msg_ring(target.impl_->fd(), e, res);
+}
+
+void ring_t::defer(posted_t & p)
+{
+    impl_->defer(p);
+}
+
+void ring_t::undefer(posted_t & p)
+{
+    impl_->undefer(p);
+}
+
+void ring_t::post(posted_t & p)
+{
+    impl_->post(p);
+}
+
+ring_t::schedule_awaitable_t ring_t::schedule()
+{
+    return schedule_awaitable_t{{+[] (posted_t & p, bool const run) {
+        if (run)
+            static_cast < schedule_awaitable_t & >(p).coroutine_.resume();
+    }}, *this};
+}
+
+void ring_t::reap_mode(reap_mode_t const mode)
+{
+    impl_->reap_mode(mode);
+}
+
+ring_t::reap_mode_t ring_t::reap_mode() const
+{
+    return impl_->reap_mode();
+}
+
+bool ring_t::reaping() const
+{
+    return impl_->reaping_;
+}
+
+void ring_t::run_mode(run_mode_t const mode, duration_t const spin_for)
+{
+    impl_->run_mode(mode, spin_for);
+}
+
+ring_t::run_mode_t ring_t::run_mode() const
+{
+    return impl_->run_mode();
+}
+
+bool ring_t::busy_poll(duration_t const timeout, bool const prefer)
+{
+    return impl_->busy_poll(timeout, prefer);
+}
+
+void ring_t::no_busy_poll()
+{
+    impl_->no_busy_poll();
+}
+
+metrics::snapshot_t ring_t::metrics() const
+{
+    return impl_->metrics_.snapshot();
+}
+
+void ring_t::latencies(metrics::latencies_t & l) const
+{
+    impl_->metrics_.latencies(l);
+}
+
+void ring_t::track_latency(bool const on)
+{
+    impl_->track_latency_ = on;
+}
+
 void ring_t::wait_for_events(size_t const count, duration_t const wait_timeout)
 {
     return impl_->wait_for_events(count, wait_timeout);
@@ -0,0 +1,235 @@
+#include "iouring_shm.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+
+void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+std::atomic_ref < uint32_t > record_length(uint8_t * record)
+{
+    return std::atomic_ref < uint32_t >{*reinterpret_cast < uint32_t * >(record)};
+}
+
+}
+
+namespace zsl::iouring::shm
+{
+
+queue_t queue_t::create(size_t const capacity)
+{
+    auto const page = static_cast < size_t >(::sysconf(_SC_PAGESIZE));
+    auto const size = (std::max < size_t >(capacity, 1) + page - 1) / page * page;
+
+    auto const fd = ::memfd_create("zsl-shm-queue", MFD_CLOEXEC);
+    if (fd < 0)
+        throw std::system_error(errno, std::generic_category(), "memfd_create");
+    //  header page then the ring, all zeroes, i.e. no message anywhere
+    if (::ftruncate(fd, static_cast < off_t >(page + size)) != 0)
+    {
+        auto const e = errno;
+        ::close(fd);
+        throw std::system_error(e, std::generic_category(), "ftruncate");
+    }
+    return queue_t{fd, size, true};
+}
+
+queue_t queue_t::open(int32_t const fd)
+{
+    struct stat st{};
+    if (::fstat(fd, &st) != 0)
+        throw std::system_error(errno, std::generic_category(), "fstat");
+    auto const page = static_cast < size_t >(::sysconf(_SC_PAGESIZE));
+    if (static_cast < size_t >(st.st_size) <= page)
+        throw std::runtime_error("not a shm queue");
+
+    auto const own = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (own < 0)
+        throw std::system_error(errno, std::generic_category(), "fcntl");
+    return queue_t{own, static_cast < size_t >(st.st_size) - page, false};
+}
+
+queue_t::queue_t(int32_t const fd, size_t const capacity, bool const initialise) : fd_{fd}, capacity_{capacity}, page_{static_cast < size_t >(::sysconf(_SC_PAGESIZE))}
+{
+    auto const fail = [&] (char const * what)
+    {
+        auto const e = errno;
+        if (base_)
+            ::munmap(base_, page_ + 2 * capacity_);
+        ::close(fd_);
+        throw std::system_error(e, std::generic_category(), what);
+    };
+
+    //  header page, then the ring twice over, same pages
+    auto * const base = ::mmap(nullptr, page_ + 2 * capacity_, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+        fail("mmap");
+    base_ = static_cast < uint8_t * >(base);
+    if (::mmap(base_, page_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd_, 0) == MAP_FAILED)
+        fail("mmap");
+    for (auto * half : {base_ + page_, base_ + page_ + capacity_})
+        if (::mmap(half, capacity_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd_, static_cast < off_t >(page_)) == MAP_FAILED)
+            fail("mmap");
+    data_ = base_ + page_;
+
+    if (initialise)
+        header_ = std::construct_at(reinterpret_cast < header_t * >(base_), uint64_t{capacity_});
+    else
+    {
+        header_ = std::launder(reinterpret_cast < header_t * >(base_));
+        if (header_->magic_ != header_t::magic || header_->capacity_ != capacity_)
+        {
+            errno = EINVAL;
+            fail("shm queue header");
+        }
+    }
+}
+
+queue_t::queue_t(queue_t && rhs) noexcept
+    : fd_{std::exchange(rhs.fd_, -1)}
+    , capacity_{rhs.capacity_}
+    , page_{rhs.page_}
+    , base_{std::exchange(rhs.base_, nullptr)}
+    , header_{std::exchange(rhs.header_, nullptr)}
+    , data_{std::exchange(rhs.data_, nullptr)}
+{
+}
+
+queue_t::~queue_t()
+{
+    if (base_)
+        ::munmap(base_, page_ + 2 * capacity_);
+    if (fd_ >= 0)
+        ::close(fd_);
+}
+
+bool writer_t::push(std::span < uint8_t const > const payload)
+{
+    auto & header = *queue_.header_;
+    auto const size = queue_t::record_size(payload.size());
+    if (size > queue_.capacity_)
+        return false;
+
+    auto at = header.reserved_.load(std::memory_order_relaxed);
+    do
+    {
+        //  acquire, the reader zeroed what it released before moving head_
+        if (at + size - header.head_.load(std::memory_order_acquire) > queue_.capacity_)
+            return false;
+    }
+    while (!header.reserved_.compare_exchange_weak(at, at + size, std::memory_order_relaxed));
+
+    auto * const record = queue_.data_ + at % queue_.capacity_;
+    std::memcpy(record + queue_t::record_header_size, payload.data(), payload.size());
+    //  the length is the commit, 0 means nothing there yet
+    record_length(record).store(static_cast < uint32_t >(payload.size()) + 1, std::memory_order_release);
+    return true;
+}
+
+bool writer_t::reader_asleep()
+{
+    auto & signal = queue_.header_->signal_;
+    //  pairs with the fence in the reader's ready(), either it sees what was pushed or we see it waiting
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (signal.waiters_.load(std::memory_order_relaxed) == 0)
+        return false;
+    signal.value_.fetch_add(1, std::memory_order_seq_cst);
+    return true;
+}
+
+void writer_t::flush(ring_t & ring)
+{
+    if (reader_asleep())
+        queue_.header_->signal_.wake(ring, 1);
+}
+
+void writer_t::flush()
+{
+    if (reader_asleep())
+        queue_.header_->signal_.wake(1);
+}
+
+reader_t::frame_result_t reader_t::try_next()
+{
+    auto & header = *queue_.header_;
+    if (consumed_ > 0)
+    {
+        //  zeroed before it's handed back so a length left over from this message never looks like a new one
+        std::memset(queue_.data_ + head_ % queue_.capacity_, 0, consumed_);
+        head_ += std::exchange(consumed_, 0);
+        header.head_.store(head_, std::memory_order_release);
+    }
+    auto * const record = queue_.data_ + head_ % queue_.capacity_;
+    auto const length = record_length(record).load(std::memory_order_acquire);
+    if (length == 0)
+        return std::unexpected(-EAGAIN);
+    consumed_ = queue_t::record_size(length - 1);
+    return std::span < uint8_t const >{record + queue_t::record_header_size, length - 1};
+}
+
+bool reader_t::next_awaitable_t::await_ready()
+{
+    auto & reader = reader_;
+    for (uint32_t i = 0; i < reader.spin_ || reader.spin_ == spin_forever; ++i)
+    {
+        if (auto f = reader.try_next(); f.has_value())
+        {
+            result_.emplace(std::move(f));
+            return true;
+        }
+        cpu_relax();
+    }
+    return ready_(*this);
+}
+
+bool reader_t::next_awaitable_t::ready(sync::detail::wait_t & w)
+{
+    auto & a = static_cast < next_awaitable_t & >(w);
+    auto & signal = w.futex_;
+    if (auto f = a.reader_.try_next(); f.has_value())
+    {
+        if (std::exchange(w.waiting_, false))
+            signal.waiters_.fetch_sub(1, std::memory_order_relaxed);
+        a.result_.emplace(std::move(f));
+        return true;
+    }
+    if (!w.waiting_)
+    {
+        w.waiting_ = true;
+        signal.waiters_.fetch_add(1, std::memory_order_seq_cst);
+    }
+    //  sleep on the value from before the last look, a flush after it moves the word and the wait fails
+    w.expected_ = signal.value_.load(std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (auto f = a.reader_.try_next(); f.has_value())
+    {
+        w.waiting_ = false;
+        signal.waiters_.fetch_sub(1, std::memory_order_relaxed);
+        a.result_.emplace(std::move(f));
+        return true;
+    }
+    return false;
+}
+
+}
@@ -0,0 +1,135 @@
+#include "iouring_sync.hpp"
+#include "iouring_impl.hpp"
+#include "iouring_utils_time.hpp"
+
+#include <chrono>
+#include <cstdint>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <liburing.h>
+
+namespace zsl::iouring::sync
+{
+
+namespace detail
+{
+
+namespace
+{
+
+uint32_t futex_flags(futex_t const & f)
+{
+    return f.shared_ ? FUTEX2_SIZE_U32 : FUTEX2_SIZE_U32 | FUTEX2_PRIVATE;
+}
+
+//  how soon a waiter the kernel can't put to sleep on the futex looks again, read by the kernel at submission
+__kernel_timespec retry_interval{utils::time::to_timespec(std::chrono::microseconds(50))};
+
+}
+
+void futex_t::wake(ring_t & ring, uint32_t const count)
+{
+    ring.prepare_detached(&io_uring_prep_futex_wake, word(), uint64_t{count}, uint64_t{FUTEX_BITSET_MATCH_ANY}, futex_flags(*this), 0U);
+    ring.submit();
+}
+
+void futex_t::wake(uint32_t const count)
+{
+    ::syscall(SYS_futex, word(), shared_ ? FUTEX_WAKE : FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+}
+
+void wait_t::suspend(std::coroutine_handle<> coroutine)
+{
+    coroutine_ = coroutine;
+    handler_ = &on_wait;
+    wait();
+}
+
+void wait_t::wait()
+{
+    //  the kernel only sleeps if the word still holds expected_, a change in between completes with -EAGAIN
+    ring_.prepare(*this, &io_uring_prep_futex_wait, futex_.word(), uint64_t{expected_}, uint64_t{FUTEX_BITSET_MATCH_ANY}, futex_flags(futex_), 0U);
+    ring_.submit();
+}
+
+void wait_t::retry()
+{
+    ring_.prepare(*this, &io_uring_prep_timeout, &retry_interval, 0U, 0U);
+    ring_.submit();
+}
+
+void wait_t::on_wait(io_uring_cqe * cqe, ring_t::event_t & e)
+{
+    auto & w = static_cast < wait_t & >(e);
+    if (w.ready_(w))
+    {
+        w.resume();
+        return;
+    }
+    //  0 woken, -EAGAIN changed before we slept, anything else (e.g. -EINVAL before 6.7, or -ETIME from a retry)
+    //  leaves us checking again every retry_interval until ready, slower but still correct
+    if (cqe->res == 0 || cqe->res == -EAGAIN || cqe->res == -EINTR)
+        w.wait();
+    else
+        w.retry();
+}
+
+}
+
+bool async_mutex_t::acquire(detail::wait_t & w)
+{
+    auto & value = w.futex_.value_;
+    //  first try only, once anyone has waited the mutex has to stay CONTENDED until it's released or the waiters
+    //  still asleep would never be woken
+    if (w.expected_ == UNLOCKED)
+    {
+        uint32_t expected{UNLOCKED};
+        if (value.compare_exchange_strong(expected, LOCKED, std::memory_order_acquire, std::memory_order_relaxed))
+            return true;
+        w.expected_ = CONTENDED;
+    }
+    return value.exchange(CONTENDED, std::memory_order_acquire) == UNLOCKED;
+}
+
+bool async_semaphore_t::take(detail::wait_t & w)
+{
+    auto & value = w.futex_.value_;
+    auto count = value.load(std::memory_order_relaxed);
+    while (count > 0)
+        if (value.compare_exchange_weak(count, count - 1, std::memory_order_acquire, std::memory_order_relaxed))
+        {
+            if (w.waiting_)
+                w.futex_.waiters_.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    //  counted before sleeping on 0, a release that didn't see us has already moved the word and the wait fails
+    if (!w.waiting_)
+    {
+        w.waiting_ = true;
+        w.futex_.waiters_.fetch_add(1, std::memory_order_seq_cst);
+    }
+    w.expected_ = 0;
+    return false;
+}
+
+bool async_event_t::signalled(detail::wait_t & w)
+{
+    if (w.futex_.value_.load(std::memory_order_acquire) != 0)
+    {
+        if (w.waiting_)
+            w.futex_.waiters_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    if (!w.waiting_)
+    {
+        w.waiting_ = true;
+        w.futex_.waiters_.fetch_add(1, std::memory_order_seq_cst);
+    }
+    w.expected_ = 0;
+    return false;
+}
+
+}
@@ -38,9 +38,10 @@ namespace zsl::iouring::scheduler
 
 void scheduler_t::on_timeout(io_uring_cqe *, ring_t::event_t & e)
 {
+    trace::scope_t const span{"on_timeout", &e};
     auto & te = static_cast < timer_event_t & >(e);
     log("Timed out... event = {} handler = {} self = {}", &te, te.handler_, &te.context_.self_);
-    e.coroutine_.resume();
+    e.resume();
 }
 
 [[nodiscard]] scheduler_t::timer_awaitable_t scheduler_t::create_timer(duration_t const & interval)
@@ -0,0 +1,381 @@
+#include "iouring_tls.hpp"
+
+#include <logging/logging.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/kdf.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+#include <linux/tls.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+
+namespace
+{
+
+using zsl::logging::log;
+using namespace zsl::iouring;
+using namespace zsl::iouring::net;
+using namespace zsl::iouring::net::tls;
+
+//  record header, then at most 2^14 bytes of plaintext plus 256 of expansion
+inline constexpr size_t const record_header_size{5};
+inline constexpr size_t const max_record_size{16384 + 256};
+
+template < typename T, auto F >
+struct deleter_t
+{
+    void operator () (T * p) const
+    {
+        F(p);
+    }
+};
+
+using ssl_ptr_t = std::unique_ptr < SSL, deleter_t < SSL, &SSL_free > >;
+using bio_ptr_t = std::unique_ptr < BIO, deleter_t < BIO, &BIO_free > >;
+using x509_ptr_t = std::unique_ptr < X509, deleter_t < X509, &X509_free > >;
+using pkey_ptr_t = std::unique_ptr < EVP_PKEY, deleter_t < EVP_PKEY, &EVP_PKEY_free > >;
+using pkey_ctx_ptr_t = std::unique_ptr < EVP_PKEY_CTX, deleter_t < EVP_PKEY_CTX, &EVP_PKEY_CTX_free > >;
+
+std::string openssl_errors()
+{
+    std::string errors;
+    while (auto const e = ERR_get_error())
+    {
+        std::array < char, 256 > buffer;
+        ERR_error_string_n(e, buffer.data(), buffer.size());
+        if (!errors.empty())
+            errors += "; ";
+        errors += buffer.data();
+    }
+    return errors;
+}
+
+[[noreturn]] void fail(std::string_view what)
+{
+    throw std::runtime_error(std::string{what} + ": " + openssl_errors());
+}
+
+bio_ptr_t pem_bio(std::string const & pem)
+{
+    return bio_ptr_t{BIO_new_mem_buf(pem.data(), static_cast < int >(pem.size()))};
+}
+
+//  the application traffic secrets, caught from the key log as the handshake derives them
+struct secrets_t
+{
+    std::array < uint8_t, EVP_MAX_MD_SIZE > client_{};
+    std::array < uint8_t, EVP_MAX_MD_SIZE > server_{};
+    size_t client_size_{};
+    size_t server_size_{};
+};
+
+int secrets_index()
+{
+    static int const index{SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr)};
+    return index;
+}
+
+size_t from_hex(std::string_view hex, std::span < uint8_t > out)
+{
+    auto const nibble = [] (char const c) -> uint8_t
+    {
+        return static_cast < uint8_t >(c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+    };
+    auto const size = std::min(hex.size() / 2, out.size());
+    for (size_t i = 0; i < size; ++i)
+        out[i] = static_cast < uint8_t >(nibble(hex[2 * i]) << 4 | nibble(hex[2 * i + 1]));
+    return size;
+}
+
+//  "<label> <client random> <secret>"
+void on_key_log(SSL const * ssl, char const * line)
+{
+    auto * secrets = static_cast < secrets_t * >(SSL_get_ex_data(ssl, secrets_index()));
+    if (secrets == nullptr)
+        return;
+    std::string_view const l{line};
+    auto const label = l.substr(0, l.find(' '));
+    auto const secret = l.substr(l.rfind(' ') + 1);
+    if (label == "CLIENT_TRAFFIC_SECRET_0")
+        secrets->client_size_ = from_hex(secret, secrets->client_);
+    else
+    if (label == "SERVER_TRAFFIC_SECRET_0")
+        secrets->server_size_ = from_hex(secret, secrets->server_);
+}
+
+//  HKDF-Expand-Label from RFC 8446 7.1, with an empty context
+bool expand_label(EVP_MD const * md, std::span < uint8_t const > secret, std::string_view label, std::span < uint8_t > out)
+{
+    std::vector < uint8_t > info;
+    info.push_back(static_cast < uint8_t >(out.size() >> 8));
+    info.push_back(static_cast < uint8_t >(out.size()));
+    info.push_back(static_cast < uint8_t >(6 + label.size()));
+    info.insert(info.end(), {'t', 'l', 's', '1', '3', ' '});
+    info.insert(info.end(), label.begin(), label.end());
+    info.push_back(0);
+
+    pkey_ctx_ptr_t ctx{EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, nullptr)};
+    auto size = out.size();
+    return ctx
+        && EVP_PKEY_derive_init(ctx.get()) > 0
+        && EVP_PKEY_CTX_set_hkdf_mode(ctx.get(), EVP_PKEY_HKDEF_MODE_EXPAND_ONLY) > 0
+        && EVP_PKEY_CTX_set_hkdf_md(ctx.get(), md) > 0
+        && EVP_PKEY_CTX_set1_hkdf_key(ctx.get(), secret.data(), static_cast < int >(secret.size())) > 0
+        && EVP_PKEY_CTX_add1_hkdf_info(ctx.get(), info.data(), static_cast < int >(info.size())) > 0
+        && EVP_PKEY_derive(ctx.get(), out.data(), &size) > 0
+        && size == out.size();
+}
+
+//  the key and the 12 byte IV of one direction into the kernel's layout, the IV's first 4 bytes being the salt
+template < typename I >
+bool crypto_info(I & info, uint16_t const cipher, EVP_MD const * md, std::span < uint8_t const > secret)
+{
+    std::array < uint8_t, 12 > iv;
+    info.info.version = TLS_1_3_VERSION;
+    info.info.cipher_type = cipher;
+    if (!expand_label(md, secret, "key", info.key) || !expand_label(md, secret, "iv", iv))
+        return false;
+    std::memcpy(info.salt, iv.data(), sizeof(info.salt));
+    std::memcpy(info.iv, iv.data() + sizeof(info.salt), sizeof(info.iv));
+    std::memset(info.rec_seq, 0, sizeof(info.rec_seq));
+    return true;
+}
+
+template < typename I >
+int32_t install(int const fd, int const direction, I const & info)
+{
+    return ::setsockopt(fd, SOL_TLS, direction, &info, sizeof(info)) == 0 ? 0 : -errno;
+}
+
+//  both directions, the keys are zeroed on the way out
+template < typename I >
+int32_t install(int const fd, uint16_t const cipher, EVP_MD const * md, std::span < uint8_t const > tx, std::span < uint8_t const > rx)
+{
+    I tx_info{};
+    I rx_info{};
+    int32_t r{-EPROTO};
+    if (crypto_info(tx_info, cipher, md, tx) && crypto_info(rx_info, cipher, md, rx))
+        if (r = install(fd, TLS_TX, tx_info); r == 0)
+            r = install(fd, TLS_RX, rx_info);
+    OPENSSL_cleanse(&tx_info, sizeof(tx_info));
+    OPENSSL_cleanse(&rx_info, sizeof(rx_info));
+    return r;
+}
+
+int32_t enable_ktls(socket_t & socket, SSL * ssl, role_t const role, secrets_t const & secrets)
+{
+    if (secrets.client_size_ == 0 || secrets.server_size_ == 0)
+        return -EPROTO;
+
+    auto const fd = std::to_underlying(socket.fd());
+    if (::setsockopt(fd, SOL_TCP, TCP_ULP, "tls", sizeof("tls")) != 0)
+        return -errno;
+
+    std::span < uint8_t const > const client{secrets.client_.data(), secrets.client_size_};
+    std::span < uint8_t const > const server{secrets.server_.data(), secrets.server_size_};
+    auto const tx = role == role_t::CLIENT ? client : server;
+    auto const rx = role == role_t::CLIENT ? server : client;
+
+    switch (SSL_CIPHER_get_id(SSL_get_current_cipher(ssl)))
+    {
+    case TLS1_3_CK_AES_128_GCM_SHA256:
+        return install < tls12_crypto_info_aes_gcm_128 >(fd, TLS_CIPHER_AES_GCM_128, EVP_sha256(), tx, rx);
+    case TLS1_3_CK_AES_256_GCM_SHA384:
+        return install < tls12_crypto_info_aes_gcm_256 >(fd, TLS_CIPHER_AES_GCM_256, EVP_sha384(), tx, rx);
+    default:
+        return -EPROTO;
+    }
+}
+
+coroutine::awaitable_t < int32_t > send_all(socket_t & socket, std::span < uint8_t const > data)
+{
+    while (!data.empty())
+    {
+        auto sr = co_await socket.send(data);
+        if (!sr.has_value())
+            co_return int32_t{sr.error()};
+        data = data.subspan(static_cast < size_t >(sr.value()));
+    }
+    co_return int32_t{0};
+}
+
+//  0 once data is full, -ECONNRESET when the peer closed
+coroutine::awaitable_t < int32_t > recv_all(socket_t & socket, std::span < uint8_t > data)
+{
+    while (!data.empty())
+    {
+        auto rr = co_await socket.recv(data);
+        if (!rr.has_value())
+            co_return rr.error() == 0 ? -ECONNRESET : rr.error();
+        data = data.subspan(static_cast < size_t >(rr.value()));
+    }
+    co_return int32_t{0};
+}
+
+}
+
+namespace zsl::iouring::net::tls
+{
+
+context_t::context_t(role_t const role, options_t const & options) : role_{role}, options_{options}
+{
+    ctx_ = SSL_CTX_new(role_ == role_t::CLIENT ? TLS_client_method() : TLS_server_method());
+    if (ctx_ == nullptr)
+        fail("SSL_CTX_new");
+    std::unique_ptr < SSL_CTX, deleter_t < SSL_CTX, &SSL_CTX_free > > guard{ctx_};
+
+    SSL_CTX_set_min_proto_version(ctx_, TLS1_3_VERSION);
+    if (SSL_CTX_set_ciphersuites(ctx_, "TLS_AES_128_GCM_SHA256:TLS_AES_256_GCM_SHA384") != 1)
+        fail("SSL_CTX_set_ciphersuites");
+    SSL_CTX_set_num_tickets(ctx_, 0);
+    SSL_CTX_set_options(ctx_, SSL_OP_NO_TICKET);
+    SSL_CTX_set_keylog_callback(ctx_, &on_key_log);
+
+    if (!options_.certificate_.empty())
+    {
+        auto bio = pem_bio(options_.certificate_);
+        x509_ptr_t cert{PEM_read_bio_X509(bio.get(), nullptr, nullptr, nullptr)};
+        if (!cert || SSL_CTX_use_certificate(ctx_, cert.get()) != 1)
+            fail("certificate");
+        //  whatever follows is the chain
+        while (X509 * extra = PEM_read_bio_X509(bio.get(), nullptr, nullptr, nullptr))
+            if (SSL_CTX_add_extra_chain_cert(ctx_, extra) != 1)
+            {
+                X509_free(extra);
+                fail("certificate chain");
+            }
+        ERR_clear_error();
+    }
+    if (!options_.private_key_.empty())
+    {
+        auto bio = pem_bio(options_.private_key_);
+        pkey_ptr_t key{PEM_read_bio_PrivateKey(bio.get(), nullptr, nullptr, nullptr)};
+        if (!key || SSL_CTX_use_PrivateKey(ctx_, key.get()) != 1 || SSL_CTX_check_private_key(ctx_) != 1)
+            fail("private key");
+    }
+    if (role_ == role_t::SERVER && options_.certificate_.empty())
+        throw std::runtime_error("a TLS server needs a certificate");
+
+    if (!options_.ca_.empty())
+    {
+        auto bio = pem_bio(options_.ca_);
+        auto * store = SSL_CTX_get_cert_store(ctx_);
+        uint32_t loaded{0};
+        while (X509 * ca = PEM_read_bio_X509(bio.get(), nullptr, nullptr, nullptr))
+        {
+            x509_ptr_t guard_ca{ca};
+            if (X509_STORE_add_cert(store, ca) != 1)
+                fail("CA");
+            ++loaded;
+        }
+        ERR_clear_error();
+        if (loaded == 0)
+            throw std::runtime_error("CA: no certificate");
+        SSL_CTX_set_verify(ctx_, role_ == role_t::SERVER ? SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT : SSL_VERIFY_PEER, nullptr);
+    }
+    guard.release();
+}
+
+context_t::~context_t()
+{
+    SSL_CTX_free(ctx_);
+}
+
+coroutine::awaitable_t < handshake_result_t > handshake(socket_t & socket, context_t const & context)
+{
+    logc(socket, "TLS handshake starting... role = {}", context.role() == role_t::CLIENT ? "client" : "server");
+    ssl_ptr_t ssl{SSL_new(context.native())};
+    auto * rbio = BIO_new(BIO_s_mem());
+    auto * wbio = BIO_new(BIO_s_mem());
+    if (!ssl || rbio == nullptr || wbio == nullptr)
+    {
+        BIO_free(rbio);
+        BIO_free(wbio);
+        co_return std::unexpected(-ENOMEM);
+    }
+    SSL_set_bio(ssl.get(), rbio, wbio);
+
+    secrets_t secrets;
+    SSL_set_ex_data(ssl.get(), secrets_index(), &secrets);
+    if (context.role() == role_t::CLIENT)
+    {
+        SSL_set_connect_state(ssl.get());
+        if (auto const & name = context.options().server_name_; !name.empty())
+        {
+            SSL_set_tlsext_host_name(ssl.get(), name.c_str());
+            SSL_set1_host(ssl.get(), name.c_str());
+        }
+    }
+    else
+    {
+        SSL_set_accept_state(ssl.get());
+    }
+
+    std::vector < uint8_t > record(record_header_size + max_record_size);
+    while (true)
+    {
+        auto const r = SSL_do_handshake(ssl.get());
+
+        //  whatever the handshake wrote goes out first, even on failure it may be an alert for the peer
+        while (auto const pending = BIO_ctrl_pending(wbio))
+        {
+            auto const n = BIO_read(wbio, record.data(), static_cast < int >(std::min(pending, record.size())));
+            if (n <= 0)
+                break;
+            if (auto const e = co_await send_all(socket, std::span < uint8_t const >{record.data(), static_cast < size_t >(n)}); e != 0)
+                co_return std::unexpected(e);
+        }
+
+        if (r == 1)
+            break;
+        if (SSL_get_error(ssl.get(), r) != SSL_ERROR_WANT_READ)
+        {
+            logc(socket, "TLS handshake failed... {}", openssl_errors());
+            co_return std::unexpected(-EPROTO);
+        }
+
+        //  exactly one record, anything past the handshake has to stay in the socket for the kernel
+        if (auto const e = co_await recv_all(socket, std::span < uint8_t >{record.data(), record_header_size}); e != 0)
+            co_return std::unexpected(e);
+        auto const length = static_cast < size_t >(record[3]) << 8 | record[4];
+        if (length > max_record_size)
+            co_return std::unexpected(-EPROTO);
+        if (auto const e = co_await recv_all(socket, std::span < uint8_t >{record.data() + record_header_size, length}); e != 0)
+            co_return std::unexpected(e);
+        BIO_write(rbio, record.data(), static_cast < int >(record_header_size + length));
+    }
+
+    //  the kernel only gets the keys, application data must not have been read into OpenSSL
+    if (SSL_pending(ssl.get()) != 0 || BIO_ctrl_pending(rbio) != 0)
+        co_return std::unexpected(-EPROTO);
+
+    auto const e = enable_ktls(socket, ssl.get(), context.role(), secrets);
+    OPENSSL_cleanse(&secrets, sizeof(secrets));
+    if (e != 0)
+    {
+        logc(socket, "kTLS setup failed... {}", e);
+        co_return std::unexpected(e);
+    }
+    logc(socket, "TLS handshake complete... cipher = {}", SSL_get_cipher_name(ssl.get()));
+    co_return handshake_result_t{};
+}
+
+}
@@ -0,0 +1,115 @@
+#include "iouring_trace.hpp"
+
+#include <logging/logging.hpp>
+
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+
+using namespace zsl::iouring::trace;
+
+//  buffers outlive their threads so a dump still sees threads that have finished
+struct registry_t
+{
+    std::mutex mutex_{};
+    std::vector < std::unique_ptr < buffer_t > > buffers_{};
+};
+
+registry_t & registry()
+{
+    static registry_t r;
+    return r;
+}
+
+std::string_view type_of(std::string_view const name)
+{
+    if (auto const b = name.find("T = "); b != std::string_view::npos)
+    {
+        auto const t = name.substr(b + 4);
+        return t.substr(0, t.find_first_of(";]"));
+    }
+    return name;
+}
+
+char const * chrome_phase(phase_t const phase)
+{
+    switch (phase)
+    {
+    case phase_t::ASYNC_BEGIN:
+        return "b";
+    case phase_t::ASYNC_END:
+        return "e";
+    case phase_t::BEGIN:
+        return "B";
+    case phase_t::END:
+        return "E";
+    }
+    return "i";
+}
+
+}
+
+namespace zsl::iouring::trace
+{
+
+buffer_t & attach()
+{
+    auto & r = registry();
+    auto b = std::make_unique < buffer_t >();
+    b->tid_ = static_cast < uint32_t >(::syscall(SYS_gettid));
+    std::lock_guard lock{r.mutex_};
+    tls_buffer = r.buffers_.emplace_back(std::move(b)).get();
+    return *tls_buffer;
+}
+
+bool dump(std::string const & path)
+{
+    std::ofstream out{path};
+    if (!out)
+        return false;
+
+    auto & r = registry();
+    std::lock_guard lock{r.mutex_};
+    auto const pid = ::getpid();
+    out << "{\"traceEvents\":[\n";
+    bool first{true};
+    for (auto const & b : r.buffers_)
+    {
+        auto const end = b->next_;
+        auto const begin = end > buffer_t::capacity ? end - buffer_t::capacity : 0;
+        for (auto i = begin; i < end; ++i)
+        {
+            auto const & rec = b->records_[i & (buffer_t::capacity - 1)];
+            auto const async = rec.phase_ == phase_t::ASYNC_BEGIN || rec.phase_ == phase_t::ASYNC_END;
+            out << std::format("{}{{\"name\":\"{}\",\"cat\":\"iouring\",\"ph\":\"{}\",\"ts\":{:.3f},\"pid\":{},\"tid\":{}",
+                first ? "" : ",\n", type_of(rec.name_), chrome_phase(rec.phase_), static_cast < double >(rec.ts_ns_) / 1e3, pid, b->tid_);
+            if (async)
+                out << std::format(",\"id\":\"{}\"", rec.id_);
+            out << std::format(",\"args\":{{\"id\":\"{}\",\"coroutine\":\"{}\"}}}}", rec.id_, rec.coroutine_);
+            first = false;
+        }
+    }
+    out << "\n]}\n";
+    zsl::logging::log("Trace written... path = {} threads = {}", path, r.buffers_.size());
+    return static_cast < bool >(out);
+}
+
+void clear()
+{
+    auto & r = registry();
+    std::lock_guard lock{r.mutex_};
+    for (auto & b : r.buffers_)
+        b->next_ = 0;
+}
+
+}
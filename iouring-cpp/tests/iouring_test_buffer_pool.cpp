@@ -0,0 +1,97 @@
+#include <iouring.hpp>
+
+#include <catch2/catch_all.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <optional>
+#include <set>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace zsl::iouring;
+using namespace zsl::iouring::coroutine;
+
+namespace
+{
+
+awaitable_t < void > run(chain::chain_base_t & c, std::optional < chain::result_t > & result)
+{
+    result.emplace(co_await c);
+}
+
+}
+
+TEST_CASE("iouring buffer pool tests", "iouring buffer pool tests")
+{
+    ring_t ring;
+    SECTION("buffer pool/acquire and release")
+    {
+        //  rounded up to a whole page of 1KB buffers
+        buffers::pool_t pool{ring, {.buffer_size_ = 1024, .buffer_count_ = 100}};
+        REQUIRE(pool.stats().pages_ == 1);
+        REQUIRE(pool.stats().capacity_ == 2048);
+
+        std::vector < buffers::pool_t::lease_t > leases;
+        std::set < uint8_t * > seen;
+        while (auto lease = pool.acquire())
+        {
+            auto const b = lease->buffer();
+            REQUIRE(b.size() == 1024);
+            REQUIRE(reinterpret_cast < uintptr_t >(b.data()) % 1024 == 0);
+            seen.insert(b.data());
+            leases.push_back(std::move(*lease));
+        }
+        REQUIRE(seen.size() == 2048);
+        REQUIRE(pool.stats().in_use_ == 2048);
+        REQUIRE(pool.stats().exhausted_ == 1);
+        REQUIRE(pool.stats().utilization() == 1.0);
+
+        //  what's given back is what's handed out next
+        auto * const freed = leases[700].buffer().data();
+        leases[700].release();
+        REQUIRE(pool.stats().in_use_ == 2047);
+        auto again = pool.acquire();
+        REQUIRE(again.has_value());
+        REQUIRE(again->buffer().data() == freed);
+
+        leases.clear();
+        again.reset();
+        REQUIRE(pool.stats().in_use_ == 0);
+        REQUIRE(pool.stats().in_use_max_ == 2048);
+    }
+    SECTION("buffer pool/fixed read into a lease")
+    {
+        buffers::pool_t pool{ring, {.buffer_size_ = 4096, .buffer_count_ = 1024}};
+        REQUIRE(pool.stats().pages_ == 2);
+        auto lease = pool.acquire();
+        REQUIRE(lease.has_value());
+        if (!lease->index())
+            SKIP("the ring wouldn't pin the pool's pages, RLIMIT_MEMLOCK");
+
+        char path[] = "/tmp/iouring_test_buffer_pool_XXXXXX";
+        auto const fd = ::mkstemp(path);
+        ::unlink(path);
+        REQUIRE(::write(fd, "registered", 10) == 10);
+
+        auto const b = lease->buffer();
+        chain::chain_t < 1 > c{ring};
+        c.read_fixed(fd, b.first(10), 0, *lease->index());
+        std::optional < chain::result_t > result;
+        run(c, result);
+        while (!result)
+            ring.wait_for_events();
+        REQUIRE(result->has_value());
+        REQUIRE(result->value() == 10);
+        REQUIRE(std::equal(b.begin(), b.begin() + 10, "registered"));
+        ::close(fd);
+    }
+    SECTION("buffer pool/sizes")
+    {
+        REQUIRE_THROWS_AS((buffers::pool_t{ring, {.buffer_size_ = 3000}}), std::invalid_argument);
+        REQUIRE_THROWS_AS((buffers::pool_t{ring, {.buffer_size_ = 512}}), std::invalid_argument);
+        buffers::pool_t whole{ring, {.buffer_size_ = buffers::pool_t::page_size, .buffer_count_ = 1}};
+        REQUIRE(whole.stats().capacity_ == 1);
+    }
+}
@@ -0,0 +1,152 @@
+#include <iouring.hpp>
+
+#include <catch2/catch_all.hpp>
+
+#include "iouring_test_helpers.hpp"
+
+#include <array>
+#include <format>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace zsl::iouring;
+using namespace zsl::iouring::coroutine;
+using namespace zsl::iouring::net;
+using namespace zsl::iouring::tests;
+
+namespace
+{
+
+constexpr ipport_t const port{56798};
+
+awaitable_t < void > write_lines(socket_t & s, uint32_t const count, bool & done)
+{
+    buffered_writer_t writer{s, 4096};
+    for (uint32_t i = 0; i < count; ++i)
+        co_await writer.write(std::format("line {}\n", i));
+    auto fr = co_await writer.flush();
+    done = fr.has_value();
+}
+
+awaitable_t < void > read_lines(socket_t & s, uint32_t const count, uint32_t & good)
+{
+    buffered_reader_t reader{s, 4096};
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        auto rr = co_await reader.read_until('\n');
+        if (!rr.has_value())
+            break;
+        auto const line = std::string_view{reinterpret_cast < char const * >(rr.value().data()), rr.value().size()};
+        if (line == std::format("line {}\n", i))
+            ++good;
+    }
+}
+
+//  sends the ring hasn't seen come back yet
+uint64_t sends_in_flight(ring_t const & ring)
+{
+    auto const m = ring.metrics();
+    auto const & write_fixed = m.ops_[IORING_OP_WRITE_FIXED];
+    auto const & send = m.ops_[IORING_OP_SEND];
+    return write_fixed.submitted_ - write_fixed.completed_ + send.submitted_ - send.completed_;
+}
+
+}
+
+TEST_CASE("iouring buffered tests", "iouring buffered tests")
+{
+    ring_t ring;
+    SECTION("buffered/small writes coalesce")
+    {
+        loopback_t c{ring, port};
+        auto const before = ring.metrics();
+
+        constexpr uint32_t const count{10000};
+        bool written{false};
+        uint32_t good{0};
+        read_lines(*c.accepted_, count, good);
+        write_lines(c.client_, count, written);
+        while (!written || good < count)
+            ring.wait_for_events();
+        REQUIRE(good == count);
+
+        auto const after = ring.metrics();
+        auto const sends = [] (auto const & m) { return m.ops_[IORING_OP_WRITE_FIXED].submitted_ + m.ops_[IORING_OP_SEND].submitted_; };
+        //  ~100K bytes through 4K buffers
+        REQUIRE(sends(after) - sends(before) < count / 100);
+    }
+    SECTION("buffered/read exactly and some")
+    {
+        loopback_t c{ring, port};
+        bool written{false};
+        [] (socket_t & s, bool & done) -> awaitable_t < void >
+        {
+            buffered_writer_t writer{s};
+            co_await writer.write(std::string_view{"0123456789abcdef"});
+            co_await writer.flush();
+            done = true;
+        }(c.client_, written);
+
+        std::string first;
+        std::string rest;
+        [] (socket_t & s, std::string & first, std::string & rest) -> awaitable_t < void >
+        {
+            buffered_reader_t reader{s};
+            if (auto rr = co_await reader.read_exactly(10); rr.has_value())
+                first.assign(reinterpret_cast < char const * >(rr.value().data()), rr.value().size());
+            while (rest.size() < 6)
+                if (auto rr = co_await reader.read_some(); rr.has_value())
+                    rest.append(reinterpret_cast < char const * >(rr.value().data()), rr.value().size());
+                else
+                    break;
+        }(*c.accepted_, first, rest);
+
+        while (!written || rest.size() < 6)
+            ring.wait_for_events();
+        REQUIRE(first == "0123456789");
+        REQUIRE(rest == "abcdef");
+    }
+    SECTION("buffered/destroyed with a send on its way")
+    {
+        loopback_t c{ring, port};
+        //  more than the socket buffers take, with nobody reading the send can't complete
+        std::vector < uint8_t > const big(16 * 1024 * 1024, 'x');
+        bool sending{false};
+        {
+            buffered_writer_t writer{c.client_, big.size()};
+            [] (buffered_writer_t & writer, std::span < uint8_t const > data, bool & sending) -> awaitable_t < void >
+            {
+                co_await writer.write(data);
+                sending = writer.buffered() != 0;
+            }(writer, big, sending);
+        }
+        REQUIRE(sending);
+        //  the abandoned send comes back cancelled and frees what it kept
+        while (sends_in_flight(ring) != 0)
+            ring.wait_for_events();
+    }
+    SECTION("buffered/destroyed inside a completion")
+    {
+        loopback_t c{ring, port};
+        std::vector < uint8_t > const big(16 * 1024 * 1024, 'x');
+        bool sending{false};
+        bool done{false};
+        //  the writer is on the frame, which ends in the recv's completion with the send still on its way
+        [] (socket_t & out, socket_t & in, std::span < uint8_t const > data, bool & sending, bool & done) -> awaitable_t < void >
+        {
+            buffered_writer_t writer{out, data.size()};
+            co_await writer.write(data);
+            std::array < uint8_t, 64 > buffer{};
+            co_await in.recv(buffer);
+            sending = writer.buffered() != 0;
+            done = true;
+        }(c.client_, *c.accepted_, big, sending, done);
+        while (!done)
+            ring.wait_for_events();
+        REQUIRE(sending);
+        while (sends_in_flight(ring) != 0)
+            ring.wait_for_events();
+    }
+}
@@ -0,0 +1,101 @@
+#include <iouring.hpp>
+
+#include <catch2/catch_all.hpp>
+
+#include "iouring_test_helpers.hpp"
+
+#include <stop_token>
+
+using namespace zsl::iouring;
+using namespace zsl::iouring::coroutine;
+using namespace zsl::iouring::net;
+using namespace zsl::iouring::scheduler;
+using namespace zsl::iouring::tests;
+
+namespace
+{
+
+constexpr ipport_t const port{56795};
+
+using steady_clock_t = std::chrono::steady_clock;
+
+awaitable_t < void > sleep_long(scheduler_t & scheduler, std::stop_token, uint32_t & done)
+{
+    co_await scheduler.create_timer(std::chrono::hours(1));
+    ++done;
+}
+
+awaitable_t < void > receive(socket_t & s, std::stop_token, int32_t & error, bool & stopped)
+{
+    std::array < uint8_t, 64 > buffer;
+    auto rr = co_await s.recv(buffer);
+    error = rr.has_value() ? 0 : rr.error();
+    stopped = true;
+}
+
+}
+
+TEST_CASE("iouring cancel tests", "iouring cancel tests")
+{
+    ring_t ring;
+    SECTION("cancel/stop token")
+    {
+        constexpr uint32_t const tasks{10000};
+        scheduler_t scheduler{ring};
+        std::stop_source stop;
+        uint32_t done{0};
+        for (uint32_t i = 0; i < tasks; ++i)
+            sleep_long(scheduler, stop.get_token(), done);
+        ring.wait_for_events(1, std::chrono::milliseconds(10));
+
+        auto const start = steady_clock_t::now();
+        stop.request_stop();
+        while (done < tasks)
+            ring.wait_for_events();
+        REQUIRE(done == tasks);
+        REQUIRE(steady_clock_t::now() - start < std::chrono::seconds(1));
+    }
+    SECTION("cancel/already stopped")
+    {
+        scheduler_t scheduler{ring};
+        std::stop_source stop;
+        stop.request_stop();
+        uint32_t done{0};
+        //  never submitted, completes right away
+        sleep_long(scheduler, stop.get_token(), done);
+        REQUIRE(done == 1);
+    }
+    SECTION("cancel/cancel without a stop token")
+    {
+        scheduler_t scheduler{ring};
+        uint32_t done{0};
+        auto task = [] (scheduler_t & scheduler, uint32_t & done) -> awaitable_t < void >
+        {
+            co_await scheduler.create_timer(std::chrono::hours(1));
+            ++done;
+        }(scheduler, done);
+        //  nothing could stop it so far, the source only comes into being with cancel()
+        REQUIRE(!task.coroutine_.promise().stop_source_.stop_possible());
+        ring.wait_for_events(1, std::chrono::milliseconds(10));
+        REQUIRE(done == 0);
+
+        task.cancel();
+        while (done == 0)
+            ring.wait_for_events();
+        REQUIRE(done == 1);
+    }
+    SECTION("cancel/recv")
+    {
+        loopback_t c{ring, port};
+
+        std::stop_source stop;
+        int32_t error{0};
+        bool stopped{false};
+        receive(*c.accepted_, stop.get_token(), error, stopped);
+        ring.wait_for_events(1, std::chrono::milliseconds(10));
+        REQUIRE(!stopped);
+        stop.request_stop();
+        ring.run(stopped);
+        REQUIRE(error == -ECANCELED);
+    }
+}
@@ -0,0 +1,178 @@
+#include <iouring.hpp>
+
+#include <catch2/catch_all.hpp>
+
+#include "iouring_test_helpers.hpp"
+
+#include <array>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace zsl::iouring;
+using namespace zsl::iouring::coroutine;
+using namespace zsl::iouring::net;
+using namespace zsl::iouring::tests;
+
+namespace
+{
+
+constexpr ipport_t const port{56800};
+
+awaitable_t < void > run(chain::chain_base_t & c, std::optional < chain::result_t > & result)
+{
+    result.emplace(co_await c);
+}
+
+struct temp_file_t
+{
+    int32_t fd_{-1};
+
+    temp_file_t()
+    {
+        char path[] = "/tmp/iouring_test_chain_XXXXXX";
+        fd_ = ::mkstemp(path);
+        ::unlink(path);
+    }
+
+    ~temp_file_t()
+    {
+        ::close(fd_);
+    }
+
+    size_t size() const
+    {
+        struct stat st{};
+        ::fstat(fd_, &st);
+        return static_cast < size_t >(st.st_size);
+    }
+};
+
+}
+
+TEST_CASE("iouring chain tests", "iouring chain tests")
+{
+    ring_t ring;
+    SECTION("chain/recv then send echoes")
+    {
+        loopback_t c{ring, port};
+
+        //  one round trip, the kernel sends back what it received without the ring's thread in between
+        std::array < uint8_t, 64 > buffer{};
+        chain::chain_t < 2 > echo{ring};
+        echo.recv(std::to_underlying(c.accepted_->fd()), buffer, MSG_WAITALL).send(std::to_underlying(c.accepted_->fd()), buffer);
+        std::optional < chain::result_t > result;
+        run(echo, result);
+
+        std::array < uint8_t, 64 > message{};
+        for (size_t i = 0; i < message.size(); ++i)
+            message[i] = static_cast < uint8_t >(i);
+        std::array < uint8_t, 64 > reply{};
+        size_t received{0};
+        [] (socket_t & s, std::span < uint8_t const > message, std::span < uint8_t > reply, size_t & received) -> awaitable_t < void >
+        {
+            co_await s.send(message);
+            while (received < reply.size())
+                if (auto rr = co_await s.recv(reply.subspan(received)); rr.has_value() && rr.value() > 0)
+                    received += static_cast < size_t >(rr.value());
+                else
+                    break;
+        }(c.client_, message, reply, received);
+
+        while (!result || received < reply.size())
+            ring.wait_for_events();
+        REQUIRE(result->has_value());
+        REQUIRE(result->value() == 64);
+        REQUIRE(reply == message);
+    }
+    SECTION("chain/short recv breaks the chain")
+    {
+        loopback_t c{ring, port};
+
+        std::array < uint8_t, 64 > buffer{};
+        chain::chain_t < 2 > echo{ring};
+        echo.recv(std::to_underlying(c.accepted_->fd()), buffer, MSG_WAITALL).send(std::to_underlying(c.accepted_->fd()), buffer);
+        std::optional < chain::result_t > result;
+        run(echo, result);
+
+        bool sent{false};
+        [] (socket_t & s, bool & sent) -> awaitable_t < void >
+        {
+            co_await s.send(std::string_view{"0123456789"});
+            sent = true;
+        }(c.client_, sent);
+        while (!sent)
+            ring.wait_for_events();
+        c.client_.close();
+
+        while (!result)
+            ring.wait_for_events();
+        REQUIRE(!result->has_value());
+        REQUIRE(result->error().index_ == 0);
+        REQUIRE(result->error().error_ == 10);
+    }
+    SECTION("chain/write then fsync")
+    {
+        temp_file_t file;
+        std::array < uint8_t, 4096 > data;
+        data.fill('x');
+
+        chain::chain_t < 3 > c{ring};
+        c.write(file.fd_, data, 0).write(file.fd_, data, data.size()).fsync(file.fd_);
+        std::optional < chain::result_t > result;
+        run(c, result);
+        while (!result)
+            ring.wait_for_events();
+        REQUIRE(result->has_value());
+        REQUIRE(result->value() == 0);
+        REQUIRE(file.size() == 2 * data.size());
+    }
+    SECTION("chain/failed link cancels the rest")
+    {
+        temp_file_t file;
+        std::array < uint8_t, 16 > data{};
+
+        chain::chain_t < 3 > c{ring};
+        c.read(-1, data, 0).write(file.fd_, data, 0).fsync(file.fd_);
+        std::optional < chain::result_t > result;
+        run(c, result);
+        while (!result)
+            ring.wait_for_events();
+        REQUIRE(!result->has_value());
+        REQUIRE(result->error().index_ == 0);
+        REQUIRE(result->error().error_ == -EBADF);
+        REQUIRE(file.size() == 0);
+
+        //  nothing else turns up for the chain
+        ring.wait_for_events(1, std::chrono::milliseconds(50));
+    }
+    SECTION("chain/hard link goes past a failure")
+    {
+        temp_file_t file;
+        std::array < uint8_t, 16 > data{};
+
+        chain::chain_t < 2 > c{ring};
+        c.read(-1, data, 0).hard().write(file.fd_, data, 0);
+        std::optional < chain::result_t > result;
+        run(c, result);
+        while (!result)
+            ring.wait_for_events();
+        REQUIRE(!result->has_value());
+        REQUIRE(result->error().index_ == 0);
+        REQUIRE(result->error().error_ == -EBADF);
+        REQUIRE(file.size() == 16);
+
+        //  and the chain can go again
+        c.clear();
+        c.write(file.fd_, data, 16).fsync(file.fd_);
+        result.reset();
+        run(c, result);
+        while (!result)
+            ring.wait_for_events();
+        REQUIRE(result->has_value());
+        REQUIRE(file.size() == 32);
+    }
+}
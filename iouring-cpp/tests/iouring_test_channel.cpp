@@ -0,0 +1,134 @@
+#include <iouring.hpp>
+
+#include <catch2/catch_all.hpp>
+
+#include <array>
+#include <atomic>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+using namespace zsl::iouring;
+using namespace zsl::iouring::coroutine;
+
+namespace
+{
+
+template < typename C >
+awaitable_t < void > produce(ring_t & ring, C & channel, uint64_t const first, uint64_t const count, std::atomic < uint32_t > & producers)
+{
+    for (uint64_t i = first; i < first + count; ++i)
+        co_await channel.push(ring, uint64_t{i});
+    //  the last one out closes
+    if (producers.fetch_sub(1) == 1)
+        channel.close(ring);
+}
+
+template < typename C >
+awaitable_t < void > consume(ring_t & ring, C & channel, std::atomic < uint64_t > & sum, std::atomic < uint64_t > & received, std::atomic < uint32_t > & consumers)
+{
+    while (auto value = co_await channel.pop(ring))
+    {
+        sum += *value;
+        ++received;
+    }
+    --consumers;
+}
+
+}
+
+TEST_CASE("iouring channel tests", "iouring channel tests")
+{
+    SECTION("channel/same ring")
+    {
+        ring_t ring;
+        channel_t < uint64_t, 16 > channel;
+        constexpr uint64_t const count{10000};
+        std::atomic < uint32_t > producers{1};
+        std::atomic < uint32_t > consumers{2};
+        std::atomic < uint64_t > sum{0};
+        std::atomic < uint64_t > received{0};
+        consume(ring, channel, sum, received, consumers);
+        consume(ring, channel, sum, received, consumers);
+        produce(ring, channel, 0, count, producers);
+        //  waiters are resumed by a no-op through the ring, not from inside the push or pop that lets them through
+        REQUIRE(consumers == 2);
+        while (consumers > 0)
+            ring.wait_for_events();
+        REQUIRE(received == count);
+        REQUIRE(sum == count * (count - 1) / 2);
+        REQUIRE(channel.empty());
+    }
+    SECTION("channel/batches")
+    {
+        ring_t ring;
+        channel_t < uint32_t, 8 > channel;
+        std::array < uint32_t, 12 > in{};
+        std::iota(in.begin(), in.end(), 1U);
+        REQUIRE(channel.try_push(ring, std::span < uint32_t >{in}) == 8);
+        REQUIRE(!channel.try_push(ring, 13U));
+
+        std::array < uint32_t, 5 > out{};
+        REQUIRE(channel.try_pop(ring, std::span < uint32_t >{out}) == 5);
+        REQUIRE(out == std::array < uint32_t, 5 >{1, 2, 3, 4, 5});
+
+        //  the 4 left over all fit
+        size_t pushed{0};
+        [] (ring_t & ring, channel_t < uint32_t, 8 > & channel, std::span < uint32_t > values, size_t & pushed) -> awaitable_t < void >
+        {
+            pushed = co_await channel.push(ring, values);
+        }(ring, channel, std::span < uint32_t >{in}.subspan(8), pushed);
+        REQUIRE(pushed == 4);
+        REQUIRE(channel.size() == 7);
+
+        size_t popped{0};
+        std::array < uint32_t, 16 > all{};
+        [] (ring_t & ring, channel_t < uint32_t, 8 > & channel, std::span < uint32_t > out, size_t & popped) -> awaitable_t < void >
+        {
+            popped = co_await channel.pop(ring, out);
+            popped += co_await channel.pop(ring, out.subspan(popped));
+        }(ring, channel, all, popped);
+        //  the second pop waits on the empty channel until it's closed
+        REQUIRE(popped == 7);
+        channel.close(ring);
+        //  and is woken by the no-op close() leaves on the ring
+        ring.wait_for_events();
+        REQUIRE(popped == 7);
+        REQUIRE(all[0] == 6);
+        REQUIRE(all[6] == 12);
+        REQUIRE(!channel.try_push(ring, 1U));
+    }
+    SECTION("channel/across rings")
+    {
+        constexpr uint32_t const producer_count{2};
+        constexpr uint32_t const consumer_count{2};
+        constexpr uint64_t const count{20000};
+        channel_t < uint64_t, 64, channel_mode_t::CROSS_RING > channel;
+        std::atomic < uint32_t > producers{producer_count};
+        std::atomic < uint32_t > consumers{consumer_count};
+        std::atomic < uint64_t > sum{0};
+        std::atomic < uint64_t > received{0};
+
+        std::vector < std::thread > threads;
+        for (uint32_t c = 0; c < consumer_count; ++c)
+            threads.emplace_back([&] {
+                ring_t ring;
+                consume(ring, channel, sum, received, consumers);
+                while (consumers > 0)
+                    ring.wait_for_events(1, std::chrono::milliseconds(10));
+            });
+        for (uint32_t p = 0; p < producer_count; ++p)
+            threads.emplace_back([&, p] {
+                ring_t ring;
+                produce(ring, channel, p * count, count, producers);
+                while (producers > 0 || consumers > 0)
+                    ring.wait_for_events(1, std::chrono::milliseconds(10));
+            });
+        for (auto & t : threads)
+            t.join();
+
+        auto const total = producer_count * count;
+        REQUIRE(received == total);
+        REQUIRE(sum == total * (total - 1) / 2);
+    }
+}
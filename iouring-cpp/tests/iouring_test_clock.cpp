@@ -0,0 +1,40 @@
+#include <iouring.hpp>
+
+#include <catch2/catch_all.hpp>
+
+#include <chrono>
+#include <thread>
+
+#include <clock/clock.hpp>
+
+using zsl::iouring::ring_t;
+using namespace zsl::clock;
+
+TEST_CASE("iouring clock tests", "iouring clock tests")
+{
+    SECTION("clock/tsc")
+    {
+        //  same epoch and rate as steady_clock, give or take the reads in between
+        auto const t0 = tsc_clock_t::now();
+        auto const s0 = std::chrono::steady_clock::now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        auto const t1 = tsc_clock_t::now();
+        auto const s1 = std::chrono::steady_clock::now();
+        REQUIRE(t1 > t0);
+        REQUIRE(std::chrono::abs((t1 - t0) - (s1 - s0)) < std::chrono::microseconds(100));
+        REQUIRE(std::chrono::abs(t1.time_since_epoch() - s1.time_since_epoch()) < std::chrono::milliseconds(1));
+    }
+    SECTION("clock/coarse ticks once per pass")
+    {
+        ring_t ring;
+        auto const before = coarse_clock_t::tick();
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        REQUIRE(coarse_clock_t::now() == before);
+
+        ring_t::event_t e{+[] (io_uring_cqe *, ring_t::event_t &) {}};
+        ring.nop(e);
+        ring.submit();
+        ring.wait_for_events(1, std::chrono::seconds(1));
+        REQUIRE(coarse_clock_t::now() - before >= std::chrono::milliseconds(2));
+    }
+}
@@ -0,0 +1,84 @@
+#include <iouring.hpp>
+
+#include <catch2/catch_all.hpp>
+
+using namespace zsl::iouring;
+using namespace zsl::iouring::coroutine;
+using namespace zsl::iouring::scheduler;
+
+namespace
+{
+
+using steady_clock_t = std::chrono::steady_clock;
+
+awaitable_t < int32_t > sleep_then(scheduler_t & scheduler, std::chrono::milliseconds const interval, int32_t const v)
+{
+    co_await scheduler.create_timer(interval);
+    co_return int32_t{v};
+}
+
+awaitable_t < void > all(scheduler_t & scheduler, steady_clock_t::duration & elapsed, int32_t & sum, bool & stopped)
+{
+    auto const start = steady_clock_t::now();
+    auto [a, b, c] = co_await when_all(
+            scheduler.create_timer(std::chrono::milliseconds(10)),
+            sleep_then(scheduler, std::chrono::milliseconds(20), 2),
+            sleep_then(scheduler, std::chrono::milliseconds(5), 3));
+    elapsed = steady_clock_t::now() - start;
+    sum = b + c;
+    stopped = true;
+}
+
+awaitable_t < void > any(scheduler_t & scheduler, steady_clock_t::duration & elapsed, uint32_t & index, bool & stopped)
+{
+    auto const start = steady_clock_t::now();
+    auto r = co_await when_any(
+            scheduler.create_timer(std::chrono::seconds(5)),
+            scheduler.create_timer(std::chrono::milliseconds(10)));
+    elapsed = steady_clock_t::now() - start;
+    index = r.index_;
+    stopped = true;
+}
+
+awaitable_t < void > await_tasks(scheduler_t & scheduler, int32_t & sum, bool & stopped)
+{
+    auto slow = sleep_then(scheduler, std::chrono::milliseconds(20), 20);
+    auto fast = sleep_then(scheduler, std::chrono::milliseconds(1), 1);
+    //  fast has long finished by the time it's awaited
+    sum = co_await slow + co_await fast;
+    stopped = true;
+}
+
+}
+
+TEST_CASE("iouring combinator tests", "iouring combinator tests")
+{
+    ring_t ring;
+    scheduler_t scheduler{ring};
+    bool stopped{false};
+    SECTION("when_all")
+    {
+        steady_clock_t::duration elapsed{};
+        int32_t sum{0};
+        all(scheduler, elapsed, sum, stopped);
+        ring.run(stopped);
+        REQUIRE(sum == 5);
+        REQUIRE(elapsed >= std::chrono::milliseconds(20));
+    }
+    SECTION("when_any cancels the losers")
+    {
+        steady_clock_t::duration elapsed{};
+        uint32_t index{};
+        any(scheduler, elapsed, index, stopped);
+        ring.run(stopped);
+        REQUIRE(index == 1);
+        REQUIRE(elapsed < std::chrono::seconds(1));
+    }
+    SECTION("tasks")
+    {
+        int32_t sum{0};
+        await_tasks(scheduler, sum, stopped);
+        ring.run(stopped);
+        REQUIRE(sum == 21);
+    }
+}
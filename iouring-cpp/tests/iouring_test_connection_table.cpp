@@ -0,0 +1,125 @@
+#include <iouring.hpp>
+
+#include <catch2/catch_all.hpp>
+
+#include "iouring_test_helpers.hpp"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace zsl::iouring;
+using namespace zsl::iouring::coroutine;
+using namespace zsl::iouring::net;
+using namespace zsl::iouring::tests;
+
+namespace
+{
+
+constexpr ipport_t const port{56796};
+
+awaitable_t < void > round_trip(tcp_socket_t & s, std::string_view request, std::string & reply, bool & done)
+{
+    co_await s.send(std::span(reinterpret_cast < uint8_t const * >(request.data()), request.size()));
+    std::array < uint8_t, 64 > buffer;
+    while (reply.size() < request.size())
+    {
+        auto rr = co_await s.recv(buffer);
+        if (!rr.has_value() || rr.value() == 0)
+            break;
+        reply.append(reinterpret_cast < char const * >(buffer.data()), rr.value());
+    }
+    done = true;
+}
+
+awaitable_t < void > wait_closed(tcp_socket_t & s, bool & closed)
+{
+    std::array < uint8_t, 64 > buffer;
+    auto rr = co_await s.recv(buffer);
+    closed = !rr.has_value() || rr.value() == 0;
+}
+
+auto echo()
+{
+    return [] (connection_table_t::connection_t &, std::span < uint8_t const > data) { return data; };
+}
+
+}
+
+TEST_CASE("iouring connection table tests", "iouring connection table tests")
+{
+    ring_t ring;
+    auto server = tcp_server(ring, IPADDRV4_LOOPBACK, port);
+    SECTION("connection table/echo")
+    {
+        connection_table_t table{ring, server, echo(), {.capacity_ = 16, .buffer_size_ = 256, .buffer_count_ = 16}};
+        table.start();
+
+        std::vector < tcp_socket_t > clients;
+        for (uint32_t i = 0; i < 4; ++i)
+            clients.emplace_back(ring);
+        std::array < bool, 4 > connected{};
+        for (uint32_t i = 0; i < clients.size(); ++i)
+            connect_one(clients[i], port, connected[i]);
+        while (!std::ranges::all_of(connected, std::identity{}))
+            ring.wait_for_events();
+
+        std::array < std::string, 4 > replies;
+        std::array < bool, 4 > done{};
+        for (uint32_t i = 0; i < clients.size(); ++i)
+            round_trip(clients[i], "hello connection table", replies[i], done[i]);
+        while (!std::ranges::all_of(done, std::identity{}))
+            ring.wait_for_events();
+
+        for (auto const & r : replies)
+            REQUIRE(r == "hello connection table");
+        REQUIRE(table.stats().accepted_ == 4);
+        REQUIRE(table.stats().active_ == 4);
+
+        table.stop();
+        while (!table.stopped())
+            ring.wait_for_events();
+        REQUIRE(table.stats().closed_ == 4);
+    }
+    SECTION("connection table/idle eviction")
+    {
+        connection_table_t table{ring, server, echo(),
+                {.capacity_ = 4, .idle_timeout_ = std::chrono::milliseconds(50), .sweep_interval_ = std::chrono::milliseconds(10)}};
+        table.start();
+
+        tcp_socket_t client{ring};
+        bool connected{false};
+        connect_one(client, port, connected);
+        ring.run(connected);
+
+        bool closed{false};
+        wait_closed(client, closed);
+        ring.run(closed);
+        REQUIRE(table.stats().evicted_ == 1);
+        REQUIRE(table.stats().active_ == 0);
+
+        table.stop();
+        while (!table.stopped())
+            ring.wait_for_events();
+    }
+    SECTION("connection table/full")
+    {
+        connection_table_t table{ring, server, echo(), {.capacity_ = 1}};
+        table.start();
+
+        tcp_socket_t first{ring};
+        tcp_socket_t second{ring};
+        bool connected_first{false};
+        bool connected_second{false};
+        connect_one(first, port, connected_first);
+        ring.run(connected_first);
+        connect_one(second, port, connected_second);
+        while (table.stats().rejected_ == 0)
+            ring.wait_for_events();
+        REQUIRE(table.stats().active_ == 1);
+
+        table.stop();
+        while (!table.stopped())
+            ring.wait_for_events();
+    }
+}
@@ -0,0 +1,122 @@
+#include <iouring.hpp>
+
+#include <catch2/catch_all.hpp>
+
+#include "iouring_test_helpers.hpp"
+
+#include <algorithm>
+#include <array>
+#include <optional>
+#include <vector>
+
+using namespace zsl::iouring;
+using namespace zsl::iouring::coroutine;
+using namespace zsl::iouring::net;
+using namespace zsl::iouring::net::framing;
+using namespace zsl::iouring::tests;
+
+namespace
+{
+
+constexpr ipport_t const port{56797};
+
+//  frame i is i % 1000 bytes, each one filled with its index
+template < Header H >
+awaitable_t < void > write_frames(socket_t & s, uint32_t const count, std::vector < uint8_t > const & payload, bool & done)
+{
+    framed_writer_t < H > writer{s};
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        writer.push(std::span(payload.data() + i % 256 * 1000, i % 1000));
+        if (writer.pending() == 64)
+            co_await writer.flush();
+    }
+    co_await writer.flush();
+    done = true;
+}
+
+template < Header H >
+awaitable_t < void > read_frames(socket_t & s, uint32_t const count, uint32_t & good)
+{
+    framed_reader_t < H > reader{s, 4096};
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        auto f = co_await reader.next();
+        if (!f.has_value())
+            break;
+        auto const & frame = f.value();
+        if (frame.size() == i % 1000 && std::ranges::all_of(frame, [i] (uint8_t const b) { return b == static_cast < uint8_t >(i % 256); }))
+            ++good;
+    }
+}
+
+template < Header H >
+void round_trip(ring_t & ring)
+{
+    loopback_t c{ring, port};
+
+    std::vector < uint8_t > payload(256 * 1000);
+    for (uint32_t i = 0; i < 256; ++i)
+        std::fill_n(payload.begin() + i * 1000, 1000, static_cast < uint8_t >(i));
+
+    //  a 4K reader and frames up to 999 bytes, plenty of them straddle the wrap
+    constexpr uint32_t const count{5000};
+    bool written{false};
+    uint32_t good{0};
+    read_frames < H >(*c.accepted_, count, good);
+    write_frames < H >(c.client_, count, payload, written);
+    while (!written || good < count)
+        ring.wait_for_events();
+    REQUIRE(good == count);
+}
+
+}
+
+TEST_CASE("iouring framing tests", "iouring framing tests")
+{
+    ring_t ring;
+    SECTION("framing/u16")
+    {
+        round_trip < u16_header_t >(ring);
+    }
+    SECTION("framing/u32")
+    {
+        round_trip < u32_header_t >(ring);
+    }
+    SECTION("framing/varint")
+    {
+        round_trip < varint_header_t >(ring);
+    }
+    SECTION("framing/varint codec")
+    {
+        std::array < uint8_t, varint_header_t::max_size > b;
+        for (uint32_t const v : {0U, 127U, 128U, 16384U, 0xfffffffeU})
+        {
+            auto const size = varint_header_t::encode(v, b.data());
+            auto const d = varint_header_t::decode(std::span(b.data(), size));
+            REQUIRE(d.has_value());
+            REQUIRE(d->length_ == v);
+            REQUIRE(d->size_ == size);
+            REQUIRE(!varint_header_t::decode(std::span(b.data(), size - 1)).has_value());
+        }
+    }
+    SECTION("framing/too large")
+    {
+        loopback_t c{ring, port};
+
+        std::vector < uint8_t > payload(8192);
+        framed_writer_t < u32_header_t > writer{c.client_};
+        writer.push(payload);
+        writer.flush();
+
+        framed_reader_t < u32_header_t > reader{*c.accepted_, 4096};
+        std::optional < framed_reader_t < u32_header_t >::frame_result_t > r;
+        [] (auto & reader, auto & r) -> awaitable_t < void >
+        {
+            r.emplace(co_await reader.next());
+        }(reader, r);
+        while (!r)
+            ring.wait_for_events();
+        REQUIRE(r->error() == -EMSGSIZE);
+    }
+}
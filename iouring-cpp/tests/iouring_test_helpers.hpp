@@ -0,0 +1,41 @@
+#pragma once
+
+#include <iouring.hpp>
+
+#include <optional>
+
+//  loopback plumbing for the socket tests.  each test file listens on a port of its own so a socket one of them
+//  leaves behind can't get in another's way
+
+namespace zsl::iouring::tests
+{
+
+inline coroutine::awaitable_t < void > accept_one(net::tcp_socket_t & server, std::optional < net::tcp_socket_t > & client)
+{
+    if (auto ar = co_await server.acceptor().accept(); ar.has_value())
+        client.emplace(std::move(ar.value()));
+}
+
+inline coroutine::awaitable_t < void > connect_one(net::tcp_socket_t & s, net::ipport_t const port, bool & connected)
+{
+    connected = co_await s.connect(net::IPADDRV4_LOOPBACK, port) == net::socket_t::connect_status_t::SUCCEEDED;
+}
+
+//  a connection over loopback, accepted_ is the server's end of client_
+struct loopback_t
+{
+    net::tcp_socket_t server_;
+    std::optional < net::tcp_socket_t > accepted_{};
+    net::tcp_socket_t client_;
+
+    loopback_t(ring_t & ring, net::ipport_t const port) : server_{net::tcp_server(ring, net::IPADDRV4_LOOPBACK, port)}, client_{ring}
+    {
+        bool connected{false};
+        accept_one(server_, accepted_);
+        connect_one(client_, port, connected);
+        while (!connected || !accepted_)
+            ring.wait_for_events();
+    }
+};
+
+}
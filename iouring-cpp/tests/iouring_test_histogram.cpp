@@ -0,0 +1,47 @@
+#include <iouring_utils_histogram.hpp>
+
+#include <catch2/catch_all.hpp>
+
+using zsl::iouring::utils::histogram::histogram_t;
+
+namespace
+{
+
+using test_histogram_t = histogram_t < 7 >;
+
+static_assert(test_histogram_t::index_of(0) == 0);
+static_assert(test_histogram_t::index_of(127) == 127);
+static_assert(test_histogram_t::index_of(128) == 128);
+static_assert(test_histogram_t::index_of(129) == 128);
+static_assert(test_histogram_t::index_of(130) == 129);
+static_assert(test_histogram_t::index_of(~0ULL) == test_histogram_t::bucket_count - 1);
+static_assert(test_histogram_t::highest_equivalent(test_histogram_t::bucket_count - 1) == ~0ULL);
+
+}
+
+TEST_CASE("iouring histogram tests", "iouring histogram tests")
+{
+    SECTION("histogram/buckets")
+    {
+        for (uint64_t v : {1ULL, 100ULL, 1000ULL, 123456ULL, 1ULL << 40, (1ULL << 40) + 12345})
+        {
+            auto const i = test_histogram_t::index_of(v);
+            REQUIRE(test_histogram_t::lowest_equivalent(i) <= v);
+            REQUIRE(v <= test_histogram_t::highest_equivalent(i));
+            REQUIRE(test_histogram_t::highest_equivalent(i) - test_histogram_t::lowest_equivalent(i) <= v / 64);
+        }
+    }
+    SECTION("histogram/percentiles")
+    {
+        auto h = std::make_unique < test_histogram_t >();
+        for (uint64_t v = 1; v <= 1000; ++v)
+            h->record(v);
+        REQUIRE(h->count() == 1000);
+        REQUIRE(h->min() == 1);
+        REQUIRE(h->max() == 1000);
+        REQUIRE(h->mean() == Catch::Approx(500.5));
+        REQUIRE(h->value_at_percentile(50.0) == Catch::Approx(500).epsilon(0.01));
+        REQUIRE(h->value_at_percentile(99.0) == Catch::Approx(990).epsilon(0.01));
+        REQUIRE(h->value_at_percentile(100.0) == 1000);
+    }
+}
@@ -0,0 +1,77 @@
+#include <iouring.hpp>
+
+#include <catch2/catch_all.hpp>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+using zsl::iouring::ring_t;
+
+namespace
+{
+
+uint32_t nops_completed{0};
+
+void run_nops(ring_t & ring, uint32_t const n)
+{
+    ring_t::event_t e{+[] (io_uring_cqe *, ring_t::event_t &) { ++nops_completed; }};
+    nops_completed = 0;
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        ring.nop(e);
+        ring.submit();
+        while (nops_completed == i)
+            ring.wait_for_events(1, std::chrono::seconds(1));
+    }
+}
+
+}
+
+TEST_CASE("iouring metrics tests", "iouring metrics tests")
+{
+    ring_t ring;
+    SECTION("metrics/counters")
+    {
+        run_nops(ring, 100);
+        auto const m = ring.metrics();
+        auto const & nop = m.ops_[IORING_OP_NOP];
+        REQUIRE(nop.submitted_ == 100);
+        REQUIRE(nop.completed_ == 100);
+        REQUIRE(nop.errors_ == 0);
+        REQUIRE(m.submits_ == 100 + 1);        //  plus arming the wakeup read when the ring was created
+        REQUIRE(m.completions_ >= 100);
+        REQUIRE(m.sq_pending_max_ >= 1);
+        REQUIRE(m.cq_overflow_ == 0);
+    }
+    SECTION("metrics/latency")
+    {
+        ring.track_latency(true);
+        run_nops(ring, 100);
+        auto const l = std::make_unique < zsl::iouring::metrics::latencies_t >();
+        ring.latencies(*l);
+        REQUIRE(l->ops_[IORING_OP_NOP].count() == 100);
+        REQUIRE(ring.metrics().handler_ns_ > 0);
+    }
+    SECTION("metrics/snapshot from another thread")
+    {
+        std::atomic < bool > done{false};
+        bool monotonic{true};
+        std::thread reader{[&] {
+            uint64_t last_seen{0};
+            while (!done.load())
+            {
+                auto const m = ring.metrics();
+                //  single writer, counters never go backwards
+                monotonic = monotonic && m.ops_[IORING_OP_NOP].completed_ >= last_seen;
+                last_seen = m.ops_[IORING_OP_NOP].completed_;
+            }
+        }};
+        run_nops(ring, 1000);
+        done = true;
+        reader.join();
+        REQUIRE(monotonic);
+        auto const m = ring.metrics();
+        REQUIRE(m.ops_[IORING_OP_NOP].completed_ == 1000);
+    }
+}
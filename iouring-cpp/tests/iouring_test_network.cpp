@@ -107,11 +107,8 @@ awaitable_t < void > run_server(ring_t & ring, ipaddressv4_t const & ip, ipport_
 awaitable_t < void > test_run_server_and_client(ring_t & ring, ipaddressv4_t const & ip, ipport_t const & port, bool & stopped)
 {
     log("-------------------------------------------");
-    auto s = run_server(ring, ip, port);
+    co_await when_all(run_server(ring, ip, port), run_client(ring, ip, port));
     log("-------------------------------------------");
-    auto c = run_client(ring, ip, port);
-    co_await c;
-    co_await s;
     stopped = true;
 }
 
@@ -0,0 +1,130 @@
+#include <iouring.hpp>
+
+#include <catch2/catch_all.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace zsl::iouring;
+using namespace zsl::iouring::coroutine;
+using zsl::iouring::pool::pool_t;
+
+namespace
+{
+
+struct hops_t
+{
+    uint32_t done_{0};                  //  ring thread only
+    bool back_on_ring_{true};           //  ring thread only
+    std::atomic < uint32_t > off_ring_{0};
+};
+
+awaitable_t < void > compute(ring_t & ring, pool_t & pool, hops_t & hops, std::thread::id const ring_thread)
+{
+    co_await pool.schedule();
+    if (std::this_thread::get_id() != ring_thread)
+        hops.off_ring_.fetch_add(1);
+    uint64_t sum{0};
+    for (uint64_t i = 0; i < 100000; ++i)
+        sum += i * i;
+    co_await ring.schedule();
+    hops.back_on_ring_ = hops.back_on_ring_ && std::this_thread::get_id() == ring_thread && sum != 0;
+    ++hops.done_;
+}
+
+}
+
+TEST_CASE("iouring pool tests", "iouring pool tests")
+{
+    SECTION("pool/deque")
+    {
+        utils::work_stealing::deque_t < uint32_t, 4 > d;
+        uint32_t v[5]{0, 1, 2, 3, 4};
+        REQUIRE(d.empty());
+        REQUIRE(d.push(&v[0]));
+        REQUIRE(d.push(&v[1]));
+        REQUIRE(d.push(&v[2]));
+        REQUIRE(d.push(&v[3]));
+        REQUIRE(!d.push(&v[4]));
+        REQUIRE(d.steal() == &v[0]);
+        REQUIRE(d.pop() == &v[3]);
+        REQUIRE(d.pop() == &v[2]);
+        REQUIRE(d.steal() == &v[1]);
+        REQUIRE(d.pop() == nullptr);
+        REQUIRE(d.steal() == nullptr);
+        REQUIRE(d.empty());
+    }
+    SECTION("pool/deque steal race")
+    {
+        constexpr uint32_t const count{100000};
+        utils::work_stealing::deque_t < uint32_t > d;
+        std::vector < uint32_t > items(count);
+        std::vector < std::atomic < uint32_t > > taken(count);
+        std::atomic < bool > done{false};
+        std::vector < std::thread > thieves;
+        for (uint32_t t = 0; t < 3; ++t)
+            thieves.emplace_back([&] {
+                while (!done.load())
+                    if (auto * i = d.steal())
+                        taken[i - items.data()].fetch_add(1);
+            });
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            while (!d.push(&items[i]))
+                if (auto * p = d.pop())
+                    taken[p - items.data()].fetch_add(1);
+        }
+        while (auto * p = d.pop())
+            taken[p - items.data()].fetch_add(1);
+        done = true;
+        for (auto & t : thieves)
+            t.join();
+        bool exactly_once{true};
+        for (auto & t : taken)
+            exactly_once = exactly_once && t.load() == 1;
+        REQUIRE(exactly_once);
+    }
+    SECTION("pool/hop off and back onto the ring")
+    {
+        constexpr uint32_t const tasks{1000};
+        ring_t ring;
+        pool_t pool{4};
+        hops_t hops;
+        for (uint32_t i = 0; i < tasks; ++i)
+            compute(ring, pool, hops, std::this_thread::get_id());
+        while (hops.done_ < tasks)
+            ring.wait_for_events();
+        REQUIRE(hops.off_ring_.load() == tasks);
+        REQUIRE(hops.back_on_ring_);
+    }
+    SECTION("pool/work from outside doesn't wait behind a busy worker")
+    {
+        pool_t pool{2};
+        std::atomic < uint32_t > ran{0};
+        std::atomic < bool > started{false};
+        std::atomic < bool > timed_out{false};
+        //  holds whichever worker it lands on until the others, scheduled once it's running, have run
+        [] (pool_t & pool, std::atomic < uint32_t > & ran, std::atomic < bool > & started, std::atomic < bool > & timed_out) -> awaitable_t < void >
+        {
+            co_await pool.schedule();
+            started = true;
+            auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            while (ran.load() < 2 && !timed_out.load())
+                timed_out = std::chrono::steady_clock::now() > deadline;
+            ++ran;
+        }(pool, ran, started, timed_out);
+        while (!started.load())
+            std::this_thread::yield();
+        for (uint32_t i = 0; i < 2; ++i)
+            [] (pool_t & pool, std::atomic < uint32_t > & ran) -> awaitable_t < void >
+            {
+                co_await pool.schedule();
+                ++ran;
+            }(pool, ran);
+        while (ran.load() < 3)
+            std::this_thread::yield();
+        REQUIRE(!timed_out.load());
+    }
+}
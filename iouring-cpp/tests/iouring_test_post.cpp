@@ -0,0 +1,77 @@
+#include <iouring.hpp>
+
+#include <catch2/catch_all.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace zsl::iouring;
+using namespace zsl::iouring::coroutine;
+
+namespace
+{
+
+awaitable_t < void > hop(ring_t & ring, std::thread::id & resumed_on, bool & stopped)
+{
+    co_await ring.schedule();
+    resumed_on = std::this_thread::get_id();
+    stopped = true;
+}
+
+}
+
+TEST_CASE("iouring post tests", "iouring post tests")
+{
+    ring_t ring;
+    SECTION("post/from other threads")
+    {
+        constexpr uint32_t const threads{4};
+        constexpr uint32_t const posts{10000};
+        uint32_t ran{0};
+        bool same_thread{true};
+        auto const ring_thread = std::this_thread::get_id();
+        std::vector < std::thread > posters;
+        for (uint32_t t = 0; t < threads; ++t)
+            posters.emplace_back([&] {
+                for (uint32_t i = 0; i < posts; ++i)
+                    ring.post([&] {
+                        same_thread = same_thread && std::this_thread::get_id() == ring_thread;
+                        ++ran;
+                    });
+            });
+        while (ran < threads * posts)
+            ring.wait_for_events();
+        for (auto & p : posters)
+            p.join();
+        REQUIRE(ran == threads * posts);
+        REQUIRE(same_thread);
+        auto const m = ring.metrics();
+        REQUIRE(m.posted_ == threads * posts);
+        //  posts made while a wakeup is in flight don't write the eventfd again
+        REQUIRE(m.wakeups_ < threads * posts);
+    }
+    SECTION("post/wakes a blocked wait")
+    {
+        bool ran{false};
+        std::thread poster{[&] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            ring.post([&] { ran = true; });
+        }};
+        auto const start = std::chrono::steady_clock::now();
+        ring.wait_for_events(1, std::chrono::seconds(10));
+        auto const elapsed = std::chrono::steady_clock::now() - start;
+        poster.join();
+        REQUIRE(ran);
+        REQUIRE(elapsed < std::chrono::seconds(1));
+    }
+    SECTION("post/schedule")
+    {
+        std::thread::id resumed_on{};
+        bool stopped{false};
+        std::thread other{[&] { hop(ring, resumed_on, stopped); }};
+        ring.run(stopped);
+        other.join();
+        REQUIRE(resumed_on == std::this_thread::get_id());
+    }
+}
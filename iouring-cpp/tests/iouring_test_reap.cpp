@@ -0,0 +1,75 @@
+#include <iouring.hpp>
+
+#include <catch2/catch_all.hpp>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using zsl::iouring::ring_t;
+
+namespace
+{
+
+uint32_t completed{0};
+
+//  one event per operation, scattered in memory so every completion lands on a cold event the way real connections do
+struct nop_storm_t
+{
+    ring_t & ring_;
+    std::vector < std::unique_ptr < ring_t::event_t > > events_{};
+
+    nop_storm_t(ring_t & ring, uint32_t const n) : ring_{ring}
+    {
+        for (uint32_t i = 0; i < n; ++i)
+            events_.push_back(std::make_unique < ring_t::event_t >(+[] (io_uring_cqe *, ring_t::event_t &) { ++completed; }));
+        std::ranges::shuffle(events_, std::mt19937{42});
+    }
+
+    auto operator () ()
+    {
+        completed = 0;
+        for (auto & e : events_)
+            ring_.nop(*e);
+        ring_.submit();
+        while (completed < events_.size())
+            ring_.wait_for_events(events_.size() - completed, std::chrono::seconds(1));
+        return completed;
+    }
+};
+
+}
+
+TEST_CASE("iouring reap tests", "iouring reap tests")
+{
+    ring_t ring;
+    nop_storm_t storm{ring, 1000};
+    SECTION("reap/each")
+    {
+        ring.reap_mode(ring_t::reap_mode_t::EACH);
+        REQUIRE(storm() == 1000);
+    }
+    SECTION("reap/batch")
+    {
+        ring.reap_mode(ring_t::reap_mode_t::BATCH);
+        REQUIRE(storm() == 1000);
+    }
+}
+
+TEST_CASE("iouring reap benchmarks", "[!benchmark]")
+{
+    ring_t ring;
+    nop_storm_t storm{ring, 1000};
+
+    ring.reap_mode(ring_t::reap_mode_t::EACH);
+    BENCHMARK("nop storm/each/1000")
+    {
+        return storm();
+    };
+
+    ring.reap_mode(ring_t::reap_mode_t::BATCH);
+    BENCHMARK("nop storm/batch/1000")
+    {
+        return storm();
+    };
+}
@@ -0,0 +1,131 @@
+#include <iouring.hpp>
+
+#include <catch2/catch_all.hpp>
+
+#include <array>
+#include <span>
+#include <string>
+#include <string_view>
+
+using namespace zsl::iouring;
+using namespace zsl::iouring::coroutine;
+using namespace zsl::iouring::net;
+
+using namespace zsl::logging;
+
+namespace
+{
+
+awaitable_t < void > run_sink(ring_t & ring, ipport_t const port, std::string & received, bool & stopped)
+{
+    auto s = tcp_server(ring, IPADDRV4_LOOPBACK, port);
+    auto && ar = co_await s.acceptor().accept();
+    if (ar.has_value())
+    {
+        auto cs = std::move(ar.value());
+        std::array < char, 256 > buf;
+        while (true)
+        {
+            auto rr = co_await cs.recv(buf);
+            if (!rr.has_value())
+                break;
+            received.append(buf.data(), rr.value());
+        }
+    }
+    logc(s, "<<<<<<<sink>>>>>>> Done... {}", received);
+    stopped = true;
+}
+
+awaitable_t < void > run_relay(ring_t & ring, ipport_t const port, ipport_t const sink_port, relay_result_t & result)
+{
+    auto s = tcp_server(ring, IPADDRV4_LOOPBACK, port);
+    auto && ar = co_await s.acceptor().accept();
+    if (!ar.has_value())
+        co_return;
+    auto cs = std::move(ar.value());
+    tcp_socket_t out{ring};
+    if (co_await out.connect(IPADDRV4_LOOPBACK, sink_port) != socket_t::connect_status_t::SUCCEEDED)
+        co_return;
+    result = co_await relay(cs, out);
+    logc(s, "<<<<<<<relay>>>>>>> Done... {}", result.has_value() ? result.value() : relay_stats_t{});
+    out.close();
+}
+
+//  one source, every sink port gets the whole stream, the source pipe is tee'd for all but the first
+awaitable_t < void > run_fan_out(ring_t & ring, ipport_t const port, std::array < ipport_t, 2 > const sink_ports, relay_result_t & result)
+{
+    auto s = tcp_server(ring, IPADDRV4_LOOPBACK, port);
+    auto && ar = co_await s.acceptor().accept();
+    if (!ar.has_value())
+        co_return;
+    auto cs = std::move(ar.value());
+    std::array < tcp_socket_t, 2 > out{tcp_socket_t{ring}, tcp_socket_t{ring}};
+    for (size_t i = 0; i < out.size(); ++i)
+        if (co_await out[i].connect(IPADDRV4_LOOPBACK, sink_ports[i]) != socket_t::connect_status_t::SUCCEEDED)
+            co_return;
+    std::array < socket_t *, 2 > const to{&out[0], &out[1]};
+    result = co_await relay(cs, std::span < socket_t * const >{to});
+    logc(s, "<<<<<<<fan out>>>>>>> Done... {}", result.has_value() ? result.value() : relay_stats_t{});
+    for (auto & o : out)
+        o.close();
+}
+
+awaitable_t < void > run_producer(ring_t & ring, ipport_t const port, std::string_view payload)
+{
+    tcp_socket_t ss{ring};
+    if (co_await ss.connect(IPADDRV4_LOOPBACK, port) != socket_t::connect_status_t::SUCCEEDED)
+        co_return;
+    while (!payload.empty())
+    {
+        auto sr = co_await ss.send(payload);
+        if (!sr.has_value())
+            break;
+        payload.remove_prefix(static_cast < size_t >(sr.value()));
+    }
+    ss.close();
+}
+
+}
+
+TEST_CASE("iouring relay tests", "iouring relay tests")
+{
+    ring_t ring;
+    SECTION("net/relay/splice")
+    {
+        log("Running test...  net/relay/splice");
+        bool stopped{false};
+        std::string received;
+        relay_result_t result{std::unexpected(-1)};
+        std::string_view const payload{"spliced through the kernel"};
+        run_sink(ring, ipport_t{56791}, received, stopped);
+        run_relay(ring, ipport_t{56792}, ipport_t{56791}, result);
+        run_producer(ring, ipport_t{56792}, payload);
+        ring.run(stopped);
+        REQUIRE(received == payload);
+        REQUIRE(result.has_value());
+        REQUIRE(result.value().bytes_in_ == payload.size());
+        REQUIRE(result.value().bytes_out_ == payload.size());
+    }    SECTION("net/relay/tee")
+    {
+        log("Running test...  net/relay/tee");
+        std::array < bool, 2 > stopped{};
+        std::array < std::string, 2 > received;
+        relay_result_t result{std::unexpected(-1)};
+        //  several pipe loads, so the tee and both splices go round more than once
+        std::string payload;
+        for (uint32_t i = 0; payload.size() < 3 * pipe_t::default_capacity; ++i)
+            payload += std::to_string(i) + ',';
+        run_sink(ring, ipport_t{56802}, received[0], stopped[0]);
+        run_sink(ring, ipport_t{56803}, received[1], stopped[1]);
+        run_fan_out(ring, ipport_t{56801}, {ipport_t{56802}, ipport_t{56803}}, result);
+        run_producer(ring, ipport_t{56801}, payload);
+        while (!stopped[0] || !stopped[1])
+            ring.wait_for_events();
+        REQUIRE(received[0] == payload);
+        REQUIRE(received[1] == payload);
+        REQUIRE(result.has_value());
+        REQUIRE(result.value().bytes_in_ == payload.size());
+        REQUIRE(result.value().bytes_out_ == 2 * payload.size());
+        REQUIRE(result.value().tees_ > 0);
+    }
+}
@@ -0,0 +1,80 @@
+#include <iouring.hpp>
+
+#include <catch2/catch_all.hpp>
+
+#include <cstdio>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace zsl::iouring;
+using namespace zsl::iouring::coroutine;
+using namespace zsl::iouring::net;
+
+using namespace zsl::logging;
+
+namespace
+{
+
+awaitable_t < void > serve_file(ring_t & ring, ipport_t const port, fd_t const file, uint64_t const length, socket_t::send_file_result_t & result, uint32_t & chunks)
+{
+    auto s = tcp_server(ring, IPADDRV4_LOOPBACK, port);
+    auto && ar = co_await s.acceptor().accept();
+    if (!ar.has_value())
+        co_return;
+    auto cs = std::move(ar.value());
+    result = co_await cs.send_file(file, 0, length, steady_clock_t::now() + 5s, [&chunks] (uint64_t, uint64_t) { ++chunks; }, 4096);
+    cs.close();
+}
+
+awaitable_t < void > fetch_file(ring_t & ring, ipport_t const port, std::string & received, bool & stopped)
+{
+    tcp_socket_t ss{ring};
+    if (co_await ss.connect(IPADDRV4_LOOPBACK, port) == socket_t::connect_status_t::SUCCEEDED)
+    {
+        std::array < char, 8192 > buf;
+        while (true)
+        {
+            auto rr = co_await ss.recv(buf);
+            if (!rr.has_value())
+                break;
+            received.append(buf.data(), rr.value());
+        }
+    }
+    stopped = true;
+}
+
+}
+
+TEST_CASE("iouring send file tests", "iouring send file tests")
+{
+    ring_t ring;
+    SECTION("net/send_file/loopback")
+    {
+        log("Running test...  net/send_file/loopback");
+        char path[] = "/tmp/iouring_test_send_file_XXXXXX";
+        auto const fd = ::mkstemp(path);
+        REQUIRE(fd >= 0);
+        ::unlink(path);
+
+        std::string content;
+        for (auto i = 0; i < 10000; ++i)
+            content += std::format("{:08}\n", i);
+        REQUIRE(::write(fd, content.data(), content.size()) == ssize_t(content.size()));
+
+        bool stopped{false};
+        std::string received;
+        socket_t::send_file_result_t result{std::unexpected(-1)};
+        uint32_t chunks{};
+        serve_file(ring, ipport_t{56793}, fd_t{fd}, content.size(), result, chunks);
+        fetch_file(ring, ipport_t{56793}, received, stopped);
+        ring.run(stopped);
+        ::close(fd);
+
+        REQUIRE(result.has_value());
+        REQUIRE(result.value() == content.size());
+        REQUIRE(received == content);
+        REQUIRE(chunks > 1);
+    }
+}
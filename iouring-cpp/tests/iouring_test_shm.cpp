@@ -0,0 +1,145 @@
+#include <iouring.hpp>
+
+#include <catch2/catch_all.hpp>
+
+#include <array>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace zsl::iouring;
+using namespace zsl::iouring::coroutine;
+
+namespace
+{
+
+std::string as_string(std::span < uint8_t const > const m)
+{
+    return std::string{reinterpret_cast < char const * >(m.data()), m.size()};
+}
+
+//  message i is i as text padded out to a length that varies, so records straddle the end of the ring
+std::string message(uint32_t const i)
+{
+    auto m = std::to_string(i);
+    m.resize(m.size() + i % 61, '.');
+    return m;
+}
+
+awaitable_t < void > read_all(ring_t & ring, shm::reader_t & reader, uint32_t const count, uint32_t & good)
+{
+    for (uint32_t i = 0; i < count; ++i)
+        if (auto m = co_await reader.next(ring); m.has_value() && as_string(m.value()) == message(i))
+            ++good;
+}
+
+}
+
+TEST_CASE("iouring shm tests", "iouring shm tests")
+{
+    SECTION("shm/push and next")
+    {
+        auto q = shm::queue_t::create(4096);
+        shm::writer_t writer{q};
+        shm::reader_t reader{q};
+        REQUIRE(reader.try_next().error() == -EAGAIN);
+
+        //  many times round the ring
+        uint32_t good{0};
+        for (uint32_t i = 0; i < 10000; ++i)
+        {
+            REQUIRE(writer.push(message(i)));
+            if (auto m = reader.try_next(); m.has_value() && as_string(m.value()) == message(i))
+                ++good;
+        }
+        REQUIRE(good == 10000);
+
+        //  full, then room again once the reader moves on
+        REQUIRE(reader.try_next().error() == -EAGAIN);
+        std::array < uint8_t, 1000 > big{};
+        uint32_t pushed{0};
+        while (writer.push(big))
+            ++pushed;
+        REQUIRE(pushed == 4);
+        REQUIRE(reader.try_next().has_value());
+        REQUIRE(!writer.push(big));
+        REQUIRE(reader.try_next().has_value());
+        REQUIRE(writer.push(big));
+
+        std::array < uint8_t, 8192 > huge{};
+        REQUIRE(!writer.push(huge));
+    }
+    SECTION("shm/reader sleeps on its ring")
+    {
+        ring_t ring;
+        auto q = shm::queue_t::create(64 * 1024);
+        shm::reader_t reader{q};
+        uint32_t good{0};
+        read_all(ring, reader, 3, good);
+        ring.wait_for_events(1, std::chrono::milliseconds(10));
+        REQUIRE(good == 0);
+
+        std::thread other{[&] {
+            auto mapped = shm::queue_t::open(q.fd());
+            shm::writer_t writer{mapped};
+            for (uint32_t i = 0; i < 3; ++i)
+            {
+                writer.push(message(i));
+                writer.flush();
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+        }};
+        while (good < 3)
+            ring.wait_for_events(1, std::chrono::milliseconds(10));
+        other.join();
+        REQUIRE(good == 3);
+        auto const m = ring.metrics();
+        REQUIRE(m.ops_[IORING_OP_FUTEX_WAIT].submitted_ > 0);
+    }
+    SECTION("shm/across processes")
+    {
+        constexpr uint32_t const count{100000};
+        ring_t ring;
+        auto q = shm::queue_t::create(64 * 1024);
+        shm::reader_t reader{q, 1000};
+
+        auto const child = ::fork();
+        REQUIRE(child >= 0);
+        if (child == 0)
+        {
+            //  nothing of the parent's ring is touched here
+            auto mapped = shm::queue_t::open(q.fd());
+            shm::writer_t writer{mapped};
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                while (!writer.push(message(i)))
+                {
+                    writer.flush();
+                    std::this_thread::yield();
+                }
+                if (i % 64 == 63)
+                    writer.flush();
+            }
+            writer.flush();
+            ::_exit(0);
+        }
+
+        uint32_t good{0};
+        bool done{false};
+        [] (ring_t & ring, shm::reader_t & reader, uint32_t const count, uint32_t & good, bool & done) -> awaitable_t < void >
+        {
+            co_await read_all(ring, reader, count, good);
+            done = true;
+        }(ring, reader, count, good, done);
+        while (!done)
+            ring.wait_for_events(1, std::chrono::milliseconds(10));
+
+        int status{};
+        ::waitpid(child, &status, 0);
+        REQUIRE(WIFEXITED(status));
+        REQUIRE(good == count);
+    }
+}
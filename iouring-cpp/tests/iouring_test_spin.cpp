@@ -0,0 +1,94 @@
+#include <iouring.hpp>
+
+#include <catch2/catch_all.hpp>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using zsl::iouring::ring_t;
+namespace metrics = zsl::iouring::metrics;
+
+namespace
+{
+
+uint32_t completed{0};
+
+uint32_t nops(ring_t & ring, uint32_t const n)
+{
+    completed = 0;
+    std::vector < std::unique_ptr < ring_t::event_t > > events;
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        events.push_back(std::make_unique < ring_t::event_t >(+[] (io_uring_cqe *, ring_t::event_t &) { ++completed; }));
+        ring.nop(*events.back());
+    }
+    ring.submit();
+    while (completed < n)
+        ring.wait_for_events(n - completed, std::chrono::seconds(1));
+    return completed;
+}
+
+}
+
+TEST_CASE("iouring spin tests", "iouring spin tests")
+{
+    ring_t ring;
+    SECTION("spin/block")
+    {
+        REQUIRE(ring.run_mode() == ring_t::run_mode_t::BLOCK);
+        ring.wait_for_events(1, std::chrono::milliseconds(5));
+        auto const m = ring.metrics();
+        REQUIRE(m.idle_ns_ >= 5'000'000);
+        REQUIRE(m.spin_ns_ == 0);
+    }
+    SECTION("spin/spin")
+    {
+        ring.run_mode(ring_t::run_mode_t::SPIN);
+        REQUIRE(nops(ring, 100) == 100);
+
+        //  nothing coming, spins out the whole wait
+        ring.wait_for_events(1, std::chrono::milliseconds(5));
+        auto const m = ring.metrics();
+        REQUIRE(m.spin_hits_ > 0);
+        REQUIRE(m.spin_misses_ == 1);
+        REQUIRE(m.spin_ns_ >= 5'000'000);
+        REQUIRE(m.idle_ns_ == 0);
+    }
+    SECTION("spin/spin sees posts")
+    {
+        ring.run_mode(ring_t::run_mode_t::SPIN);
+        std::atomic < bool > ran{false};
+        std::thread other{[&] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            ring.post([&] { ran = true; });
+        }};
+        while (!ran)
+            ring.wait_for_events(1, std::chrono::milliseconds(10));
+        other.join();
+        auto const m = ring.metrics();
+        REQUIRE(m.wakeups_ == 1);
+        REQUIRE(m.idle_ns_ == 0);
+    }
+    SECTION("spin/hybrid")
+    {
+        ring.run_mode(ring_t::run_mode_t::HYBRID, std::chrono::microseconds(200));
+        REQUIRE(nops(ring, 100) == 100);
+
+        //  spins a little then sleeps for the rest
+        ring.wait_for_events(1, std::chrono::milliseconds(5));
+        auto const m = ring.metrics();
+        REQUIRE(m.spin_misses_ >= 1);
+        REQUIRE(m.spin_ns_ >= 200'000);
+        REQUIRE(m.spin_ns_ < 5'000'000);
+        REQUIRE(m.idle_ns_ > 0);
+    }
+    SECTION("spin/busy poll")
+    {
+        //  depends on the kernel, either way the ring carries on
+        if (ring.busy_poll(std::chrono::microseconds(50)))
+            ring.no_busy_poll();
+        REQUIRE(nops(ring, 10) == 10);
+    }
+}
@@ -0,0 +1,134 @@
+#include <iouring.hpp>
+
+#include <catch2/catch_all.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace zsl::iouring;
+using namespace zsl::iouring::coroutine;
+using namespace zsl::iouring::sync;
+
+namespace
+{
+
+//  the increment is split around a trip through the ring so the critical section is held across a suspension
+awaitable_t < void > increment(ring_t & ring, async_mutex_t & m, uint64_t & counter, uint32_t const times, std::atomic < uint32_t > & done)
+{
+    for (uint32_t i = 0; i < times; ++i)
+    {
+        co_await m.lock(ring);
+        auto const value = counter;
+        co_await ring.schedule();
+        counter = value + 1;
+        m.unlock(ring);
+    }
+    ++done;
+}
+
+awaitable_t < void > take(ring_t & ring, async_semaphore_t & s, std::atomic < uint32_t > & taken)
+{
+    co_await s.acquire(ring);
+    ++taken;
+}
+
+awaitable_t < void > wait(ring_t & ring, async_event_t & e, std::atomic < uint32_t > & woken)
+{
+    co_await e.wait(ring);
+    ++woken;
+}
+
+}
+
+TEST_CASE("iouring sync tests", "iouring sync tests")
+{
+    SECTION("sync/mutex uncontended")
+    {
+        ring_t ring;
+        async_mutex_t m;
+        uint64_t counter{0};
+        std::atomic < uint32_t > done{0};
+        auto const before = ring.metrics();
+        [] (ring_t & ring, async_mutex_t & m, uint64_t & counter, std::atomic < uint32_t > & done) -> awaitable_t < void >
+        {
+            for (uint32_t i = 0; i < 100; ++i)
+            {
+                co_await m.lock(ring);
+                ++counter;
+                m.unlock(ring);
+            }
+            ++done;
+        }(ring, m, counter, done);
+        REQUIRE(done == 1);
+        REQUIRE(counter == 100);
+        REQUIRE(m.try_lock());
+        REQUIRE(!m.try_lock());
+        m.unlock();
+        //  no operation was needed
+        auto const after = ring.metrics();
+        REQUIRE(after.ops_[IORING_OP_FUTEX_WAIT].submitted_ == before.ops_[IORING_OP_FUTEX_WAIT].submitted_);
+        REQUIRE(after.ops_[IORING_OP_FUTEX_WAKE].submitted_ == before.ops_[IORING_OP_FUTEX_WAKE].submitted_);
+    }
+    SECTION("sync/mutex across rings")
+    {
+        constexpr uint32_t const rings{2};
+        constexpr uint32_t const coroutines{4};
+        constexpr uint32_t const times{500};
+        async_mutex_t m;
+        uint64_t counter{0};
+        std::atomic < uint32_t > done{0};
+        std::vector < std::thread > threads;
+        for (uint32_t r = 0; r < rings; ++r)
+            threads.emplace_back([&] {
+                ring_t ring;
+                for (uint32_t c = 0; c < coroutines; ++c)
+                    increment(ring, m, counter, times, done);
+                while (done < rings * coroutines)
+                    ring.wait_for_events(1, std::chrono::milliseconds(10));
+            });
+        for (auto & t : threads)
+            t.join();
+        REQUIRE(counter == uint64_t{rings} * coroutines * times);
+    }
+    SECTION("sync/semaphore released by another thread")
+    {
+        ring_t ring;
+        async_semaphore_t s{2};
+        std::atomic < uint32_t > taken{0};
+        for (uint32_t i = 0; i < 4; ++i)
+            take(ring, s, taken);
+        REQUIRE(taken == 2);
+        REQUIRE(s.available() == 0);
+        REQUIRE(!s.try_acquire());
+
+        std::thread releaser{[&] { s.release(2); }};
+        while (taken < 4)
+            ring.wait_for_events(1, std::chrono::milliseconds(10));
+        releaser.join();
+        REQUIRE(taken == 4);
+        REQUIRE(s.available() == 0);
+    }
+    SECTION("sync/event wakes every waiter")
+    {
+        ring_t ring;
+        async_event_t e;
+        std::atomic < uint32_t > woken{0};
+        for (uint32_t i = 0; i < 8; ++i)
+            wait(ring, e, woken);
+        ring.wait_for_events(1, std::chrono::milliseconds(10));
+        REQUIRE(woken == 0);
+
+        std::thread setter{[&] { e.set(); }};
+        while (woken < 8)
+            ring.wait_for_events(1, std::chrono::milliseconds(10));
+        setter.join();
+        REQUIRE(e.is_set());
+
+        //  set stays set until reset
+        wait(ring, e, woken);
+        REQUIRE(woken == 9);
+        e.reset();
+        REQUIRE(!e.is_set());
+    }
+}
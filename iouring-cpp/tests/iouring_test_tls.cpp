@@ -0,0 +1,157 @@
+#ifdef ZSL_IOURING_TLS
+
+#include <iouring.hpp>
+
+#include <catch2/catch_all.hpp>
+
+#include "iouring_test_helpers.hpp"
+
+#include <array>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#include <openssl/x509v3.h>
+
+using namespace zsl::iouring;
+using namespace zsl::iouring::coroutine;
+using namespace zsl::iouring::net;
+using namespace zsl::iouring::tests;
+
+namespace
+{
+
+constexpr ipport_t const port{56799};
+
+//  a throwaway CA and a localhost certificate it signed, all PEM
+struct test_pki_t
+{
+    std::string ca_;
+    std::string certificate_;
+    std::string private_key_;
+};
+
+template < typename T, typename W >
+std::string to_pem(T * object, W const write)
+{
+    std::unique_ptr < BIO, decltype(&BIO_free) > bio{BIO_new(BIO_s_mem()), &BIO_free};
+    write(bio.get(), object);
+    char * data{};
+    auto const size = BIO_get_mem_data(bio.get(), &data);
+    return std::string{data, static_cast < size_t >(size)};
+}
+
+X509 * make_certificate(char const * name, EVP_PKEY * key, X509 * issuer, EVP_PKEY * issuer_key, bool const ca)
+{
+    auto * x = X509_new();
+    X509_set_version(x, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(x), ca ? 1 : 2);
+    X509_gmtime_adj(X509_getm_notBefore(x), -60);
+    X509_gmtime_adj(X509_getm_notAfter(x), 3600);
+    X509_set_pubkey(x, key);
+    X509_NAME_add_entry_by_txt(X509_get_subject_name(x), "CN", MBSTRING_ASC, reinterpret_cast < unsigned char const * >(name), -1, -1, 0);
+    X509_set_issuer_name(x, X509_get_subject_name(issuer ? issuer : x));
+
+    X509V3_CTX v3;
+    X509V3_set_ctx(&v3, issuer ? issuer : x, x, nullptr, nullptr, 0);
+    auto const add = [&] (int const nid, char const * value)
+    {
+        if (auto * ext = X509V3_EXT_conf_nid(nullptr, &v3, nid, value); ext)
+        {
+            X509_add_ext(x, ext, -1);
+            X509_EXTENSION_free(ext);
+        }
+    };
+    add(NID_basic_constraints, ca ? "critical,CA:TRUE" : "critical,CA:FALSE");
+    if (!ca)
+        add(NID_subject_alt_name, "DNS:localhost");
+
+    X509_sign(x, issuer_key, EVP_sha256());
+    return x;
+}
+
+test_pki_t make_pki()
+{
+    std::unique_ptr < EVP_PKEY, decltype(&EVP_PKEY_free) > ca_key{EVP_PKEY_Q_keygen(nullptr, nullptr, "EC", "P-256"), &EVP_PKEY_free};
+    std::unique_ptr < EVP_PKEY, decltype(&EVP_PKEY_free) > key{EVP_PKEY_Q_keygen(nullptr, nullptr, "EC", "P-256"), &EVP_PKEY_free};
+    std::unique_ptr < X509, decltype(&X509_free) > ca{make_certificate("zsl test CA", ca_key.get(), nullptr, ca_key.get(), true), &X509_free};
+    std::unique_ptr < X509, decltype(&X509_free) > cert{make_certificate("localhost", key.get(), ca.get(), ca_key.get(), false), &X509_free};
+    return {
+        .ca_ = to_pem(ca.get(), &PEM_write_bio_X509),
+        .certificate_ = to_pem(cert.get(), &PEM_write_bio_X509),
+        .private_key_ = to_pem(key.get(), [] (BIO * b, EVP_PKEY * k) { return PEM_write_bio_PrivateKey(b, k, nullptr, nullptr, 0, nullptr, nullptr); }),
+    };
+}
+
+awaitable_t < void > handshake(socket_t & s, tls::context_t const & ctx, std::optional < tls::handshake_result_t > & result)
+{
+    result.emplace(co_await tls::handshake(s, ctx));
+}
+
+}
+
+TEST_CASE("iouring tls tests", "iouring tls tests")
+{
+    ring_t ring;
+    auto const pki = make_pki();
+    loopback_t c{ring, port};
+
+    SECTION("tls/handshake and echo")
+    {
+        tls::context_t server_ctx{tls::role_t::SERVER, {.certificate_ = pki.certificate_, .private_key_ = pki.private_key_}};
+        tls::context_t client_ctx{tls::role_t::CLIENT, {.ca_ = pki.ca_, .server_name_ = "localhost"}};
+
+        std::optional < tls::handshake_result_t > server_result;
+        std::optional < tls::handshake_result_t > client_result;
+        handshake(*c.accepted_, server_ctx, server_result);
+        handshake(c.client_, client_ctx, client_result);
+        while (!server_result || !client_result)
+            ring.wait_for_events();
+
+        if (!client_result->has_value() && client_result->error() == -ENOENT)
+            SKIP("no kernel TLS (tls module not loaded)");
+        REQUIRE(server_result->has_value());
+        REQUIRE(client_result->has_value());
+
+        //  plaintext in, plaintext out, the kernel does the records
+        std::string const hello{"hello over kTLS"};
+        std::array < uint8_t, 64 > buffer{};
+        std::optional < socket_t::recv_result_t > received;
+        [] (socket_t & s, std::span < uint8_t > buffer, std::optional < socket_t::recv_result_t > & received) -> awaitable_t < void >
+        {
+            received.emplace(co_await s.recv(buffer));
+        }(*c.accepted_, buffer, received);
+        [] (socket_t & s, std::string const & data) -> awaitable_t < void >
+        {
+            co_await s.send(data);
+        }(c.client_, hello);
+        while (!received)
+            ring.wait_for_events();
+        REQUIRE(received->has_value());
+        REQUIRE(std::string{reinterpret_cast < char const * >(buffer.data()), static_cast < size_t >(received->value())} == hello);
+    }
+    SECTION("tls/untrusted server")
+    {
+        auto const other = make_pki();
+        tls::context_t server_ctx{tls::role_t::SERVER, {.certificate_ = pki.certificate_, .private_key_ = pki.private_key_}};
+        tls::context_t client_ctx{tls::role_t::CLIENT, {.ca_ = other.ca_, .server_name_ = "localhost"}};
+
+        std::optional < tls::handshake_result_t > server_result;
+        std::optional < tls::handshake_result_t > client_result;
+        handshake(*c.accepted_, server_ctx, server_result);
+        handshake(c.client_, client_ctx, client_result);
+        while (!client_result)
+            ring.wait_for_events();
+        REQUIRE(client_result->error() == -EPROTO);
+        c.client_.close();
+        while (!server_result)
+            ring.wait_for_events();
+        REQUIRE(!server_result->has_value());
+    }
+}
+
+#endif
@@ -0,0 +1,89 @@
+#include <iouring.hpp>
+
+#include <catch2/catch_all.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stop_token>
+
+using namespace zsl::iouring;
+using namespace zsl::iouring::coroutine;
+using namespace zsl::iouring::scheduler;
+
+namespace
+{
+
+awaitable_t < void > sleep_once(ring_t & ring, bool & stopped)
+{
+    scheduler_t scheduler{ring};
+    co_await scheduler.create_timer(std::chrono::milliseconds(1));
+    stopped = true;
+}
+
+awaitable_t < void > sleep_stopped(ring_t & ring, std::stop_token, bool & stopped)
+{
+    scheduler_t scheduler{ring};
+    co_await scheduler.create_timer(std::chrono::hours(1));
+    stopped = true;
+}
+
+std::size_t count(std::string const & content, std::string_view const what)
+{
+    std::size_t n{0};
+    for (auto i = content.find(what); i != std::string::npos; i = content.find(what, i + what.size()))
+        ++n;
+    return n;
+}
+
+}
+
+TEST_CASE("iouring trace tests", "iouring trace tests")
+{
+    SECTION("trace/dump")
+    {
+        trace::clear();
+        ring_t ring;
+        bool stopped{false};
+        sleep_once(ring, stopped);
+        ring.run(stopped);
+
+        auto const path = (std::filesystem::temp_directory_path() / "iouring_test_trace.json").string();
+        REQUIRE(trace::dump(path));
+        std::stringstream content;
+        content << std::ifstream{path}.rdbuf();
+        std::filesystem::remove(path);
+
+        REQUIRE(content.str().starts_with("{\"traceEvents\":["));
+        if constexpr (trace::enabled)
+        {
+            REQUIRE(content.str().find("\"name\":\"coroutine\"") != std::string::npos);
+            REQUIRE(content.str().find("timer_event_t") != std::string::npos);
+            REQUIRE(content.str().find("\"name\":\"on_timeout\"") != std::string::npos);
+        }
+        else
+        {
+            REQUIRE(content.str().find("\"name\"") == std::string::npos);
+        }
+    }
+    SECTION("trace/stopped before submitting")
+    {
+        trace::clear();
+        ring_t ring;
+        std::stop_source stop;
+        stop.request_stop();
+        bool stopped{false};
+        //  never submitted, so no async span either
+        sleep_stopped(ring, stop.get_token(), stopped);
+        REQUIRE(stopped);
+
+        auto const path = (std::filesystem::temp_directory_path() / "iouring_test_trace.json").string();
+        REQUIRE(trace::dump(path));
+        std::stringstream content;
+        content << std::ifstream{path}.rdbuf();
+        std::filesystem::remove(path);
+
+        REQUIRE(count(content.str(), "\"ph\":\"b\"") == count(content.str(), "\"ph\":\"e\""));
+        REQUIRE(content.str().find("timer_event_t") == std::string::npos);
+    }
+}
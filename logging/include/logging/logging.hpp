@@ -1,5 +1,7 @@
 #pragma once
 
+#include <clock/clock.hpp>
+
 #include <coroutine>
 #include <chrono>
 #include <filesystem>
@@ -52,7 +54,7 @@ inline auto log(fmt_t const & fmt, Args &&... args)
 
     auto const & [str, loc] = fmt;
     std::format_to(
-        std::format_to(std::back_inserter(buffer), "[{}][{}:{}][{}] - ", std::chrono::high_resolution_clock::now(), std::filesystem::path(loc.file_name()).filename().c_str(), loc.line(), loc.function_name()),
+        std::format_to(std::back_inserter(buffer), "[{}][{}:{}][{}] - ", ::zsl::clock::tsc_clock_t::to_sys(::zsl::clock::tsc_clock_t::now()), std::filesystem::path(loc.file_name()).filename().c_str(), loc.line(), loc.function_name()),
         std::runtime_format(str), prettify(std::forward < Args >(args))...
     );
 
@@ -65,7 +67,7 @@ inline auto logc(Context && ctx, fmt_t const & fmt, Args &&... args)
     auto const & [str, loc] = fmt;
     auto & buffer = log_buffer();
     std::format_to(
-        std::format_to(std::back_inserter(buffer), "[{}][{}:{}][{}] - [{}]: ", std::chrono::high_resolution_clock::now(), std::filesystem::path(loc.file_name()).filename().c_str(), loc.line(), loc.function_name(), prettify(ctx)),
+        std::format_to(std::back_inserter(buffer), "[{}][{}:{}][{}] - [{}]: ", ::zsl::clock::tsc_clock_t::to_sys(::zsl::clock::tsc_clock_t::now()), std::filesystem::path(loc.file_name()).filename().c_str(), loc.line(), loc.function_name(), prettify(ctx)),
         std::runtime_format(str), prettify(std::forward < Args >(args))...
     );
 
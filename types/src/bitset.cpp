@@ -2,39 +2,517 @@ module;
 
 #include <array>
 #include <bit>
-#include <ranges>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
 
 export module zsl.types.bitset;
 
 export namespace zsl::types
 {
 
+enum class bitset_simd_t : uint8_t { NONE, AVX2, AVX512 };
+
+}
+
+namespace zsl::types::detail
+{
+
+#if defined(__x86_64__)
+inline bitset_simd_t best_simd()
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return bitset_simd_t::AVX512;
+    if (__builtin_cpu_supports("avx2"))
+        return bitset_simd_t::AVX2;
+    return bitset_simd_t::NONE;
+}
+
+inline bool const has_bmi2{[]
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("bmi2") != 0;
+}()};
+#else
+inline bitset_simd_t best_simd()
+{
+    return bitset_simd_t::NONE;
+}
+#endif
+
+}
+
+export namespace zsl::types
+{
+
+//  the widest scans the CPU runs, found at start up.  lowering it, e.g. to test the narrower ones, takes effect
+//  from the next scan
+inline bitset_simd_t bitset_simd{detail::best_simd()};
+
+//  N bits, packed into 64 bit words
+//
+//  the scans behind ffs/fls/ffc/flc and next/prev look at 8 words at a time with AVX-512F, 4 with AVX2, and one at
+//  a time otherwise or in a constant expression, as bitset_simd says.  select() uses pdep with BMI2.  the SIMD
+//  paths are built for their targets function by function, so no -m flags are needed.  N below 64 shares its one
+//  word with padding that stays clear whatever is done to the rest
 template < size_t N >
 requires (std::popcount(N) == 1)
 struct bitset
 {
 public:
+    inline constexpr static size_t const npos{N};
+
+    constexpr static size_t size()
+    {
+        return N;
+    }
+
+    constexpr bitset & set(size_t const i)
+    {
+        bits_[i / word_bits] |= bit(i);
+        return *this;
+    }
+
+    constexpr bitset & set(size_t const i, bool const value)
+    {
+        return value ? set(i) : reset(i);
+    }
+
+    constexpr bitset & set()
+    {
+        for (auto & w : bits_)
+            w = last_word_mask;
+        return *this;
+    }
+
+    constexpr bitset & reset(size_t const i)
+    {
+        bits_[i / word_bits] &= ~bit(i);
+        return *this;
+    }
+
+    constexpr bitset & reset()
+    {
+        for (auto & w : bits_)
+            w = 0;
+        return *this;
+    }
+
+    constexpr bitset & flip(size_t const i)
+    {
+        bits_[i / word_bits] ^= bit(i);
+        return *this;
+    }
+
+    constexpr bitset & flip()
+    {
+        for (auto & w : bits_)
+            w ^= last_word_mask;
+        return *this;
+    }
+
+    constexpr bool test(size_t const i) const
+    {
+        return (bits_[i / word_bits] & bit(i)) != 0;
+    }
+
+    constexpr bool operator [] (size_t const i) const
+    {
+        return test(i);
+    }
+
+    //  set bits
+    constexpr size_t count() const
+    {
+        size_t n{0};
+        for (auto const w : bits_)
+            n += static_cast < size_t >(std::popcount(w));
+        return n;
+    }
+
+    constexpr bool any() const
+    {
+        return scan < SET >(0) != word_count;
+    }
+
+    constexpr bool none() const
+    {
+        return !any();
+    }
+
+    constexpr bool all() const
+    {
+        return scan < CLEAR >(0) == word_count;
+    }
+
+    //  index of the lowest set bit, npos when none is
     constexpr size_t ffs() const
     {
-        if (auto const i = find([] (uint64_t const v) { return v != 0ULL; } ); i != bits_.end())
-            return __builtin_ffsll(*i) + std::distance(bits_.begin(), i);
+        return next < SET >(0);
+    }
+
+    //  index of the highest set bit, npos when none is
+    constexpr size_t fls() const
+    {
+        return prev < SET >(N - 1);
+    }
+
+    //  index of the lowest clear bit, npos when none is
+    constexpr size_t ffc() const
+    {
+        return next < CLEAR >(0);
+    }
+
+    //  index of the highest clear bit, npos when none is
+    constexpr size_t flc() const
+    {
+        return prev < CLEAR >(N - 1);
+    }
+
+    //  lowest set bit at i or above, npos when none is
+    constexpr size_t next_set(size_t const i) const
+    {
+        return next < SET >(i);
+    }
+
+    //  highest set bit at i or below, npos when none is
+    constexpr size_t prev_set(size_t const i) const
+    {
+        return prev < SET >(i);
+    }
+
+    constexpr size_t next_clear(size_t const i) const
+    {
+        return next < CLEAR >(i);
+    }
+
+    constexpr size_t prev_clear(size_t const i) const
+    {
+        return prev < CLEAR >(i);
+    }
+
+    //  set bits below i
+    constexpr size_t rank(size_t const i) const
+    {
+        size_t n{0};
+        auto const w = i / word_bits;
+        for (size_t j = 0; j < w && j < word_count; ++j)
+            n += static_cast < size_t >(std::popcount(bits_[j]));
+        if (w < word_count && i % word_bits != 0)
+            n += static_cast < size_t >(std::popcount(bits_[w] & (bit(i) - 1)));
+        return n;
+    }
+
+    //  index of the set bit with k set bits below it, npos when there are no more than k
+    constexpr size_t select(size_t k) const
+    {
+        for (size_t w = 0; w < word_count; ++w)
+        {
+            auto const n = static_cast < size_t >(std::popcount(bits_[w]));
+            if (k < n)
+                return w * word_bits + select_in_word(bits_[w], static_cast < uint32_t >(k));
+            k -= n;
+        }
+        return npos;
+    }
+
+    //  the indices of the set bits, lowest first
+    //
+    //      for (auto const i : b.ones())
+    //          ...
+    struct iterator_t
+    {
+        using value_type = size_t;
+        using difference_type = std::ptrdiff_t;
+
+        constexpr size_t operator * () const
+        {
+            return word_ * word_bits + static_cast < size_t >(std::countr_zero(current_));
+        }
+
+        constexpr iterator_t & operator ++ ()
+        {
+            current_ &= current_ - 1;
+            if (current_ == 0)
+                seek(word_ + 1);
+            return *this;
+        }
+
+        constexpr void operator ++ (int)
+        {
+            ++*this;
+        }
+
+        constexpr friend bool operator == (iterator_t const & it, std::default_sentinel_t)
+        {
+            return it.word_ == word_count;
+        }
+
+        bitset const * bitset_{};
+        size_t word_{};
+        uint64_t current_{};
+
+        constexpr void seek(size_t const from)
+        {
+            word_ = bitset_->template scan < SET >(from);
+            current_ = word_ == word_count ? 0 : bitset_->bits_[word_];
+        }
+    };
+    static_assert(std::input_iterator < iterator_t >);
+
+    struct ones_t
+    {
+        bitset const & bitset_;
+
+        constexpr iterator_t begin() const
+        {
+            iterator_t it{&bitset_};
+            it.seek(0);
+            return it;
+        }
+
+        constexpr std::default_sentinel_t end() const
+        {
+            return {};
+        }
+    };
+
+    constexpr ones_t ones() const
+    {
+        return {*this};
+    }
+
+    constexpr bitset & operator &= (bitset const & rhs)
+    {
+        for (size_t w = 0; w < word_count; ++w)
+            bits_[w] &= rhs.bits_[w];
+        return *this;
+    }
+
+    constexpr bitset & operator |= (bitset const & rhs)
+    {
+        for (size_t w = 0; w < word_count; ++w)
+            bits_[w] |= rhs.bits_[w];
+        return *this;
+    }
+
+    constexpr bitset & operator ^= (bitset const & rhs)
+    {
+        for (size_t w = 0; w < word_count; ++w)
+            bits_[w] ^= rhs.bits_[w];
+        return *this;
+    }
+
+    constexpr friend bitset operator & (bitset lhs, bitset const & rhs)
+    {
+        return lhs &= rhs;
+    }
+
+    constexpr friend bitset operator | (bitset lhs, bitset const & rhs)
+    {
+        return lhs |= rhs;
     }
 
+    constexpr friend bitset operator ^ (bitset lhs, bitset const & rhs)
+    {
+        return lhs ^= rhs;
+    }
+
+    constexpr friend bitset operator ~ (bitset b)
+    {
+        return b.flip();
+    }
+
+    constexpr friend bool operator == (bitset const &, bitset const &) = default;
+
 private:
-    using bits = std::array < uint64_t, N >;
+    inline constexpr static size_t const word_bits{64};
+    inline constexpr static size_t const word_count{(N + word_bits - 1) / word_bits};
+    //  N below 64 leaves the top of the only word as padding, N from 64 up fills every word
+    inline constexpr static uint64_t const last_word_mask{N < word_bits ? (uint64_t{1} << (N % word_bits)) - 1 : ~uint64_t{0}};
+
+    //  what a scan looks for, a word with a bit set or a word with a bit clear
+    enum kind_t : bool { SET, CLEAR };
+
+    using bits = std::array < uint64_t, word_count >;
     bits bits_{};
 
-    template < typename F >
-    constexpr auto find(F && f)
+    static constexpr uint64_t bit(size_t const i)
+    {
+        return uint64_t{1} << (i % word_bits);
+    }
+
+    //  the word as seen by a scan for K, the bits it's after set
+    template < kind_t K >
+    constexpr uint64_t view(size_t const w) const
+    {
+        if constexpr (K == SET)
+            return bits_[w];
+        else
+            return ~bits_[w] & last_word_mask;
+    }
+
+    template < kind_t K >
+    constexpr size_t next(size_t const i) const
+    {
+        if (i >= N)
+            return npos;
+        auto w = i / word_bits;
+        if (auto const v = view < K >(w) & ~(bit(i) - 1); v != 0)
+            return w * word_bits + static_cast < size_t >(std::countr_zero(v));
+        w = scan < K >(w + 1);
+        return w == word_count ? npos : w * word_bits + static_cast < size_t >(std::countr_zero(view < K >(w)));
+    }
+
+    template < kind_t K >
+    constexpr size_t prev(size_t const i) const
+    {
+        if (i >= N)
+            return npos;
+        auto w = i / word_bits;
+        auto const below = i % word_bits == word_bits - 1 ? ~uint64_t{0} : (bit(i) << 1) - 1;
+        if (auto const v = view < K >(w) & below; v != 0)
+            return w * word_bits + word_bits - 1 - static_cast < size_t >(std::countl_zero(v));
+        w = rscan < K >(w);
+        return w == word_count ? npos : w * word_bits + word_bits - 1 - static_cast < size_t >(std::countl_zero(view < K >(w)));
+    }
+
+    //  first word from w on with a bit K, word_count when there's none
+    template < kind_t K >
+    constexpr size_t scan(size_t const w) const
+    {
+#if defined(__x86_64__)
+        if !consteval
+        {
+            if constexpr (word_count >= 8)
+                if (bitset_simd == bitset_simd_t::AVX512)
+                    return scan8 < K >(w);
+            if constexpr (word_count >= 4)
+                if (bitset_simd != bitset_simd_t::NONE)
+                    return scan4 < K >(w);
+        }
+#endif
+        return scan1 < K >(w);
+    }
+
+    //  last word below w with a bit K, word_count when there's none
+    template < kind_t K >
+    constexpr size_t rscan(size_t const w) const
+    {
+#if defined(__x86_64__)
+        if !consteval
+        {
+            if constexpr (word_count >= 8)
+                if (bitset_simd == bitset_simd_t::AVX512)
+                    return rscan8 < K >(w);
+            if constexpr (word_count >= 4)
+                if (bitset_simd != bitset_simd_t::NONE)
+                    return rscan4 < K >(w);
+        }
+#endif
+        return rscan1 < K >(w);
+    }
+
+    template < kind_t K >
+    constexpr size_t scan1(size_t w) const
+    {
+        for (; w < word_count; ++w)
+            if (view < K >(w) != 0)
+                return w;
+        return word_count;
+    }
+
+    template < kind_t K >
+    constexpr size_t rscan1(size_t w) const
+    {
+        while (w-- > 0)
+            if (view < K >(w) != 0)
+                return w;
+        return word_count;
+    }
+
+    //  only reached with N from 256 up, a whole number of vectors and no padding to mind
+#if defined(__x86_64__)
+    template < kind_t K >
+    [[gnu::target("avx512f")]] size_t scan8(size_t w) const
+    {
+        for (; w + 8 <= word_count; w += 8)
+            if (auto const m = match8 < K >(w); m != 0)
+                return w + static_cast < size_t >(std::countr_zero(m));
+        return scan1 < K >(w);
+    }
+
+    template < kind_t K >
+    [[gnu::target("avx512f")]] size_t rscan8(size_t w) const
+    {
+        for (; w >= 8; w -= 8)
+            if (auto const m = match8 < K >(w - 8); m != 0)
+                return w - 8 + 31 - static_cast < size_t >(std::countl_zero(m));
+        return rscan1 < K >(w);
+    }
+
+    template < kind_t K >
+    [[gnu::target("avx2")]] size_t scan4(size_t w) const
+    {
+        for (; w + 4 <= word_count; w += 4)
+            if (auto const m = match4 < K >(w); m != 0)
+                return w + static_cast < size_t >(std::countr_zero(m));
+        return scan1 < K >(w);
+    }
+
+    template < kind_t K >
+    [[gnu::target("avx2")]] size_t rscan4(size_t w) const
+    {
+        for (; w >= 4; w -= 4)
+            if (auto const m = match4 < K >(w - 4); m != 0)
+                return w - 4 + 31 - static_cast < size_t >(std::countl_zero(m));
+        return rscan1 < K >(w);
+    }
+
+    //  bit j set when word w + j has a bit K
+    template < kind_t K >
+    [[gnu::target("avx512f")]] uint32_t match8(size_t const w) const
+    {
+        auto const v = _mm512_loadu_si512(bits_.data() + w);
+        if constexpr (K == SET)
+            return _mm512_test_epi64_mask(v, v);
+        else
+            return _mm512_cmpneq_epu64_mask(v, _mm512_set1_epi64(-1));
+    }
+
+    template < kind_t K >
+    [[gnu::target("avx2")]] uint32_t match4(size_t const w) const
+    {
+        auto const v = _mm256_loadu_si256(reinterpret_cast < __m256i const * >(bits_.data() + w));
+        auto const full = K == SET ? _mm256_setzero_si256() : _mm256_set1_epi64x(-1);
+        auto const same = static_cast < uint32_t >(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v, full))));
+        return ~same & 0xf;
+    }
+
+    [[gnu::target("bmi2")]] static size_t select_pdep(uint64_t const v, uint32_t const k)
     {
-        return std::ranges::find_if(bits_, std::forward < F >(f));
+        return static_cast < size_t >(std::countr_zero(_pdep_u64(uint64_t{1} << k, v)));
     }
+#endif
 
-    template < typename F >
-    constexpr auto rfind(F && f)
+    static constexpr size_t select_in_word(uint64_t v, uint32_t k)
     {
-        return std::ranges::find_if(bits_ | std::views::reverse, std::forward < F >(f));
+#if defined(__x86_64__)
+        if !consteval
+        {
+            if (detail::has_bmi2)
+                return select_pdep(v, k);
+        }
+#endif
+        for (; k > 0; --k)
+            v &= v - 1;
+        return static_cast < size_t >(std::countr_zero(v));
     }
 };
 
-}
\ No newline at end of file
+}
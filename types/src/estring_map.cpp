@@ -0,0 +1,603 @@
+module;
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+export module zsl.types.estring_map;
+
+import zsl.types.estring;
+
+namespace zsl::types::detail
+{
+
+//  one control byte per slot: the low 7 bits of the key's hash when the slot is full, or one of these
+inline constexpr int8_t const ctrl_empty{-128};
+inline constexpr int8_t const ctrl_deleted{-2};
+
+inline constexpr size_t const group_width{16};
+
+struct alignas(group_width) ctrl_group_t
+{
+    std::array < int8_t, group_width > ctrl_;
+};
+
+//  what an empty map points at, so a lookup needs no check for having nothing allocated
+inline constinit ctrl_group_t empty_group{[]
+{
+    ctrl_group_t g;
+    g.ctrl_.fill(ctrl_empty);
+    return g;
+}()};
+
+//  the 16 control bytes of a group, matched all at once with SSE2 and a byte at a time otherwise
+struct group_t
+{
+#if defined(__SSE2__)
+    explicit group_t(int8_t const * const ctrl) : ctrl_{_mm_load_si128(reinterpret_cast < __m128i const * >(ctrl))}
+    {
+    }
+
+    //  bit j set when slot j holds the tag
+    uint32_t match(int8_t const tag) const
+    {
+        return static_cast < uint32_t >(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl_, _mm_set1_epi8(tag))));
+    }
+
+    uint32_t match_empty() const
+    {
+        return match(ctrl_empty);
+    }
+
+    //  empty or deleted, the only control bytes with the top bit set
+    uint32_t match_free() const
+    {
+        return static_cast < uint32_t >(_mm_movemask_epi8(ctrl_));
+    }
+
+    __m128i ctrl_;
+#else
+    explicit group_t(int8_t const * const ctrl) : ctrl_{ctrl}
+    {
+    }
+
+    uint32_t match(int8_t const tag) const
+    {
+        uint32_t m{0};
+        for (size_t j = 0; j < group_width; ++j)
+            m |= static_cast < uint32_t >(ctrl_[j] == tag) << j;
+        return m;
+    }
+
+    uint32_t match_empty() const
+    {
+        return match(ctrl_empty);
+    }
+
+    uint32_t match_free() const
+    {
+        uint32_t m{0};
+        for (size_t j = 0; j < group_width; ++j)
+            m |= static_cast < uint32_t >(ctrl_[j] < 0) << j;
+        return m;
+    }
+
+    int8_t const * ctrl_;
+#endif
+};
+
+//  folds the 128 bit product, every input bit reaches the high and the low bits of the result
+constexpr uint64_t mix(uint64_t const v)
+{
+    auto const m = static_cast < unsigned __int128 >(v) * 0x9e3779b97f4a7c15ull;
+    return static_cast < uint64_t >(m) ^ static_cast < uint64_t >(m >> 64);
+}
+
+//  keys up to 15 chars hash their repr(), longer ones their storage a word at a time.  the storage past the string
+//  is zero but for the remaining capacity byte, so equal strings have equal storage
+template < typename K >
+uint64_t hash(K const & key)
+{
+    if constexpr (K::storage_size() > 16)
+    {
+        uint64_t h{K::storage_size()};
+        for (size_t i = 0; i < K::storage_size(); i += sizeof(uint64_t))
+        {
+            uint64_t w;
+            std::memcpy(&w, key.c_str() + i, sizeof(w));
+            h = mix(h ^ w);
+        }
+        return h;
+    }
+    else
+    {
+        auto const r = key.repr();
+        if constexpr (sizeof(r) == 16)
+            return mix(static_cast < uint64_t >(r) ^ mix(static_cast < uint64_t >(r >> 64)));
+        else
+            return mix(static_cast < uint64_t >(r));
+    }
+}
+
+//  from byte i on, 16 bytes at a time with SSE2 where the storage is long enough, then a word at a time
+template < size_t S >
+bool storage_equal_from(char const * const lhs, char const * const rhs, size_t i)
+{
+#if defined(__SSE2__)
+    for (; i + 16 <= S; i += 16)
+    {
+        auto const l = _mm_loadu_si128(reinterpret_cast < __m128i const * >(lhs + i));
+        auto const r = _mm_loadu_si128(reinterpret_cast < __m128i const * >(rhs + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(l, r)) != 0xffff)
+            return false;
+    }
+#endif
+    for (; i < S; i += sizeof(uint64_t))
+    {
+        uint64_t l, r;
+        std::memcpy(&l, lhs + i, sizeof(l));
+        std::memcpy(&r, rhs + i, sizeof(r));
+        if (l != r)
+            return false;
+    }
+    return true;
+}
+
+#if defined(__x86_64__)
+inline bool has_avx2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+}
+
+template < size_t S >
+[[gnu::target("avx2")]] bool storage_equal_avx2(char const * const lhs, char const * const rhs)
+{
+    size_t i{0};
+    for (; i + 32 <= S; i += 32)
+    {
+        auto const l = _mm256_loadu_si256(reinterpret_cast < __m256i const * >(lhs + i));
+        auto const r = _mm256_loadu_si256(reinterpret_cast < __m256i const * >(rhs + i));
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(l, r)) != -1)
+            return false;
+    }
+    return storage_equal_from < S >(lhs, rhs, i);
+}
+#else
+inline bool has_avx2()
+{
+    return false;
+}
+#endif
+
+}
+
+export namespace zsl::types
+{
+
+//  whether keys past 15 chars are compared 32 bytes at a time, found at start up.  clearing it, e.g. to test the
+//  narrower compare, takes effect from the next lookup
+inline bool estring_map_avx2{detail::has_avx2()};
+
+}
+
+namespace zsl::types::detail
+{
+
+template < size_t S >
+bool storage_equal(char const * const lhs, char const * const rhs)
+{
+#if defined(__x86_64__)
+    if constexpr (S >= 32)
+        if (estring_map_avx2)
+            return storage_equal_avx2 < S >(lhs, rhs);
+#endif
+    return storage_equal_from < S >(lhs, rhs, 0);
+}
+
+template < typename K >
+bool equal(K const & lhs, K const & rhs)
+{
+    if constexpr (K::storage_size() > 16)
+        return storage_equal < K::storage_size() >(lhs.c_str(), rhs.c_str());
+    else
+        return lhs.repr() == rhs.repr();
+}
+
+}
+
+export namespace zsl::types
+{
+
+//  any of the estring types
+template < typename K >
+concept estring_key = requires (K const & key)
+{
+    [] < uint8_t MIN_LEN, uint8_t MAX_LEN > (estring_t < MIN_LEN, MAX_LEN > const &) {}(key);
+};
+
+//  open addressing map from estring keys, laid out as a swiss table
+//
+//  a control byte per slot holds 7 bits of the key's hash, and a lookup matches the 16 control bytes of a group at
+//  once before comparing any key.  keys up to 15 chars are hashed and compared as the one integer repr() gives,
+//  longer ones through their storage, 32 bytes at a time with AVX2 as estring_map_avx2 says and 16 otherwise.
+//  probing steps a group further each time it moves on and stops at the first group with an empty slot, so the
+//  table grows before it's 7/8 full.  erasing leaves a deleted marker only where a probe may need to pass it.
+//  pointers into the map are invalidated by growing
+//
+//      estring_map < CcyPairCode, double > rates;
+//      rates[CcyPairCode{"EURUSD"}] = 1.0842;
+//      if (auto const * rate = rates.find(pair))
+//          ...
+template < estring_key K, typename V >
+struct estring_map
+{
+private:
+    union slot_t;
+
+public:
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = std::pair < K const, V >;
+
+    estring_map() = default;
+
+    //  room for capacity entries before growing
+    explicit estring_map(size_t const capacity)
+    {
+        reserve(capacity);
+    }
+
+    estring_map(estring_map const &) = delete;
+    estring_map & operator = (estring_map const &) = delete;
+
+    estring_map(estring_map && rhs) noexcept
+    {
+        swap(rhs);
+    }
+
+    estring_map & operator = (estring_map && rhs) noexcept
+    {
+        estring_map{std::move(rhs)}.swap(*this);
+        return *this;
+    }
+
+    ~estring_map()
+    {
+        destroy();
+    }
+
+    size_t size() const
+    {
+        return size_;
+    }
+
+    bool empty() const
+    {
+        return size_ == 0;
+    }
+
+    size_t capacity() const
+    {
+        return capacity_;
+    }
+
+    //  the value for key, nullptr when there's none
+    V * find(K const & key)
+    {
+        auto const i = find_index(key, detail::hash(key));
+        return i == npos ? nullptr : &slots_[i].value_.second;
+    }
+
+    V const * find(K const & key) const
+    {
+        auto const i = find_index(key, detail::hash(key));
+        return i == npos ? nullptr : &slots_[i].value_.second;
+    }
+
+    bool contains(K const & key) const
+    {
+        return find(key) != nullptr;
+    }
+
+    //  the value for key, constructed from args when there's none, and whether it was
+    template < typename ... Args >
+    std::pair < V *, bool > try_emplace(K const & key, Args && ... args)
+    {
+        auto const h = detail::hash(key);
+        if (auto const i = find_index(key, h); i != npos)
+            return {&slots_[i].value_.second, false};
+
+        auto i = free_index(h);
+        if (growth_left_ == 0 && ctrl_[i] == detail::ctrl_empty)
+        {
+            grow();
+            i = free_index(h);
+        }
+        std::construct_at(&slots_[i].value_, std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward < Args >(args) ...));
+        growth_left_ -= ctrl_[i] == detail::ctrl_empty ? 1 : 0;
+        ctrl_[i] = tag(h);
+        ++size_;
+        return {&slots_[i].value_.second, true};
+    }
+
+    V & operator [] (K const & key)
+    requires std::is_default_constructible_v < V >
+    {
+        return *try_emplace(key).first;
+    }
+
+    bool erase(K const & key)
+    {
+        auto const i = find_index(key, detail::hash(key));
+        if (i == npos)
+            return false;
+        std::destroy_at(&slots_[i].value_);
+        //  a group with an empty slot already ends every probe that reaches it, the slot can go back to empty
+        if (group(i / group_width * group_width).match_empty() != 0)
+        {
+            ctrl_[i] = detail::ctrl_empty;
+            ++growth_left_;
+        }
+        else
+            ctrl_[i] = detail::ctrl_deleted;
+        --size_;
+        return true;
+    }
+
+    void clear()
+    {
+        destroy();
+        std::fill_n(ctrl_, capacity_, detail::ctrl_empty);
+        size_ = 0;
+        growth_left_ = max_load(capacity_);
+    }
+
+    void reserve(size_t const n)
+    {
+        if (n > max_load(capacity_))
+            rehash(capacity_for(n));
+    }
+
+    //  the entries in no particular order
+    //
+    //      for (auto const & [key, value] : map)
+    //          ...
+    template < bool CONST >
+    struct basic_iterator_t
+    {
+        using value_type = estring_map::value_type;
+        using difference_type = std::ptrdiff_t;
+        using reference_t = std::conditional_t < CONST, value_type const &, value_type & >;
+        using slot_pointer_t = std::conditional_t < CONST, slot_t const *, slot_t * >;
+
+        reference_t operator * () const
+        {
+            return slot_->value_;
+        }
+
+        auto operator -> () const
+        {
+            return &slot_->value_;
+        }
+
+        basic_iterator_t & operator ++ ()
+        {
+            ++ctrl_;
+            ++slot_;
+            skip();
+            return *this;
+        }
+
+        void operator ++ (int)
+        {
+            ++*this;
+        }
+
+        friend bool operator == (basic_iterator_t const & it, std::default_sentinel_t)
+        {
+            return it.ctrl_ == it.end_;
+        }
+
+        int8_t const * ctrl_{};
+        int8_t const * end_{};
+        slot_pointer_t slot_{};
+
+        //  on to the next full slot, or the end
+        void skip()
+        {
+            while (ctrl_ != end_ && *ctrl_ < 0)
+            {
+                ++ctrl_;
+                ++slot_;
+            }
+        }
+    };
+    using iterator_t = basic_iterator_t < false >;
+    using const_iterator_t = basic_iterator_t < true >;
+    static_assert(std::input_iterator < iterator_t >);
+    static_assert(std::input_iterator < const_iterator_t >);
+
+    iterator_t begin()
+    {
+        iterator_t it{ctrl_, ctrl_ + capacity_, slots_.get()};
+        it.skip();
+        return it;
+    }
+
+    const_iterator_t begin() const
+    {
+        const_iterator_t it{ctrl_, ctrl_ + capacity_, slots_.get()};
+        it.skip();
+        return it;
+    }
+
+    std::default_sentinel_t end() const
+    {
+        return {};
+    }
+
+    void swap(estring_map & rhs) noexcept
+    {
+        std::swap(groups_, rhs.groups_);
+        std::swap(slots_, rhs.slots_);
+        std::swap(ctrl_, rhs.ctrl_);
+        std::swap(capacity_, rhs.capacity_);
+        std::swap(group_mask_, rhs.group_mask_);
+        std::swap(size_, rhs.size_);
+        std::swap(growth_left_, rhs.growth_left_);
+    }
+
+private:
+    inline constexpr static size_t const npos{~size_t{0}};
+    inline constexpr static size_t const group_width{detail::group_width};
+
+    //  raw room for an entry, constructed and destroyed as its control byte fills and frees
+    union slot_t
+    {
+        slot_t()
+        {
+        }
+
+        ~slot_t()
+        {
+        }
+
+        value_type value_;
+    };
+
+    std::unique_ptr < detail::ctrl_group_t[] > groups_;
+    std::unique_ptr < slot_t[] > slots_;
+    int8_t * ctrl_{detail::empty_group.ctrl_.data()};
+    size_t capacity_{0};
+    size_t group_mask_{0};
+    size_t size_{0};
+    size_t growth_left_{0};
+
+    static int8_t tag(uint64_t const h)
+    {
+        return static_cast < int8_t >(h & 0x7f);
+    }
+
+    static size_t max_load(size_t const capacity)
+    {
+        return capacity - capacity / 8;
+    }
+
+    //  the smallest power of 2 with room for n, a group at least
+    static size_t capacity_for(size_t const n)
+    {
+        auto capacity = std::bit_ceil(std::max(group_width, n));
+        if (max_load(capacity) < n)
+            capacity *= 2;
+        return capacity;
+    }
+
+    detail::group_t group(size_t const offset) const
+    {
+        return detail::group_t{ctrl_ + offset};
+    }
+
+    //  the groups h probes in turn, 1, 2, 3... groups further each time, which visits each group once
+    struct probe_t
+    {
+        size_t group_;
+        size_t mask_;
+        size_t step_{0};
+
+        size_t offset() const
+        {
+            return group_ * group_width;
+        }
+
+        void next()
+        {
+            group_ = (group_ + ++step_) & mask_;
+        }
+    };
+
+    probe_t probe(uint64_t const h) const
+    {
+        return {static_cast < size_t >(h >> 7) & group_mask_, group_mask_};
+    }
+
+    size_t find_index(K const & key, uint64_t const h) const
+    {
+        auto const t = tag(h);
+        for (auto p = probe(h); ; p.next())
+        {
+            auto const g = group(p.offset());
+            for (auto m = g.match(t); m != 0; m &= m - 1)
+            {
+                auto const i = p.offset() + static_cast < size_t >(std::countr_zero(m));
+                if (detail::equal(slots_[i].value_.first, key)) [[likely]]
+                    return i;
+            }
+            if (g.match_empty() != 0) [[likely]]
+                return npos;
+        }
+    }
+
+    //  the first empty or deleted slot on h's probe
+    size_t free_index(uint64_t const h) const
+    {
+        for (auto p = probe(h); ; p.next())
+            if (auto const m = group(p.offset()).match_free(); m != 0)
+                return p.offset() + static_cast < size_t >(std::countr_zero(m));
+    }
+
+    //  twice the size when the entries fill more than 25/32 of it, the same size to clear deleted markers otherwise
+    void grow()
+    {
+        rehash(capacity_ == 0 ? group_width : (size_ > capacity_ / 32 * 25 ? capacity_ * 2 : capacity_));
+    }
+
+    void rehash(size_t const capacity)
+    {
+        estring_map next;
+        next.groups_ = std::make_unique < detail::ctrl_group_t[] >(capacity / group_width);
+        next.slots_ = std::make_unique < slot_t[] >(capacity);
+        next.ctrl_ = next.groups_[0].ctrl_.data();
+        next.capacity_ = capacity;
+        next.group_mask_ = capacity / group_width - 1;
+        next.growth_left_ = max_load(capacity) - size_;
+        std::fill_n(next.ctrl_, capacity, detail::ctrl_empty);
+
+        for (size_t i = 0; i < capacity_; ++i)
+            if (ctrl_[i] >= 0)
+            {
+                auto & from = slots_[i].value_;
+                auto const h = detail::hash(from.first);
+                auto const j = next.free_index(h);
+                std::construct_at(&next.slots_[j].value_, std::move(from));
+                next.ctrl_[j] = tag(h);
+                std::destroy_at(&from);
+                ctrl_[i] = detail::ctrl_empty;
+            }
+        next.size_ = size_;
+        size_ = 0;
+        swap(next);
+    }
+
+    void destroy()
+    {
+        if constexpr (!std::is_trivially_destructible_v < value_type >)
+            for (size_t i = 0; i < capacity_; ++i)
+                if (ctrl_[i] >= 0)
+                    std::destroy_at(&slots_[i].value_);
+    }
+};
+
+}
@@ -0,0 +1,265 @@
+module;
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+export module zsl.types.hierarchical_bitset;
+
+namespace zsl::types::detail
+{
+
+inline constexpr size_t const word_bits{64};
+
+//  words at each level, the leaves first, up to the level that fits in one word
+template < size_t N >
+consteval size_t level_count()
+{
+    size_t levels{1};
+    for (auto words = (N + word_bits - 1) / word_bits; words > 1; words = (words + word_bits - 1) / word_bits)
+        ++levels;
+    return levels;
+}
+
+template < size_t N >
+consteval auto level_offsets()
+{
+    std::array < size_t, level_count < N >() + 1 > offsets{};
+    auto words = (N + word_bits - 1) / word_bits;
+    for (size_t l = 0; l < level_count < N >(); ++l)
+    {
+        offsets[l + 1] = offsets[l] + words;
+        words = (words + word_bits - 1) / word_bits;
+    }
+    return offsets;
+}
+
+}
+
+export namespace zsl::types
+{
+
+//  N bits under levels of summary bits, a summary bit is set when any bit in the word below it is
+//
+//  finding a set bit walks down from the top, one word per level, so it costs the same at 64 bits as at 16M
+//  (4 levels) where a flat bitset scans up to 256K words.  setting or resetting a bit touches the levels above
+//  only when its word goes from or to empty.  as a slot allocator the set bits are the free slots: acquire()
+//  takes the lowest, release() gives it back
+template < size_t N >
+requires (std::popcount(N) == 1)
+struct hierarchical_bitset
+{
+public:
+    inline constexpr static size_t const npos{N};
+    inline constexpr static size_t const levels{detail::level_count < N >()};
+
+    constexpr static size_t size()
+    {
+        return N;
+    }
+
+    constexpr hierarchical_bitset & set(size_t const i)
+    {
+        auto pos = i;
+        for (size_t l = 0; l < levels; ++l, pos /= word_bits)
+        {
+            auto & w = word(l, pos / word_bits);
+            auto const was = w;
+            w |= bit(pos);
+            if (l == 0)
+                count_ += w != was ? 1 : 0;
+            //  the levels above already know about this word
+            if (was != 0)
+                break;
+        }
+        return *this;
+    }
+
+    constexpr hierarchical_bitset & reset(size_t const i)
+    {
+        auto pos = i;
+        for (size_t l = 0; l < levels; ++l, pos /= word_bits)
+        {
+            auto & w = word(l, pos / word_bits);
+            auto const was = w;
+            w &= ~bit(pos);
+            if (l == 0)
+                count_ -= w != was ? 1 : 0;
+            //  the word still has bits set, or had none to begin with
+            if (w != 0 || was == 0)
+                break;
+        }
+        return *this;
+    }
+
+    //  every bit
+    constexpr hierarchical_bitset & set()
+    {
+        for (size_t l = 0; l < levels; ++l)
+        {
+            auto const bits = l == 0 ? N : words_at(l - 1);
+            for (size_t w = 0; w < words_at(l); ++w)
+                word(l, w) = bits - w * word_bits >= word_bits ? ~uint64_t{0} : (uint64_t{1} << (bits - w * word_bits)) - 1;
+        }
+        count_ = N;
+        return *this;
+    }
+
+    constexpr hierarchical_bitset & reset()
+    {
+        words_.fill(0);
+        count_ = 0;
+        return *this;
+    }
+
+    constexpr bool test(size_t const i) const
+    {
+        return (word(0, i / word_bits) & bit(i)) != 0;
+    }
+
+    constexpr bool operator [] (size_t const i) const
+    {
+        return test(i);
+    }
+
+    constexpr size_t count() const
+    {
+        return count_;
+    }
+
+    constexpr bool any() const
+    {
+        return count_ != 0;
+    }
+
+    constexpr bool none() const
+    {
+        return count_ == 0;
+    }
+
+    constexpr bool all() const
+    {
+        return count_ == N;
+    }
+
+    //  index of the lowest set bit, npos when none is
+    constexpr size_t ffs() const
+    {
+        if (top() == 0)
+            return npos;
+        return descend(levels - 1, static_cast < size_t >(std::countr_zero(top())));
+    }
+
+    //  lowest set bit at i or above, npos when none is
+    constexpr size_t next_set(size_t const i) const
+    {
+        if (i >= N)
+            return npos;
+        //  up until a word has a set bit at or after the position, then down its lowest branch
+        auto pos = i;
+        for (size_t l = 0; l < levels; ++l)
+        {
+            auto const w = pos / word_bits;
+            if (auto const m = word(l, w) & ~(bit(pos) - 1); m != 0)
+                return descend(l, w * word_bits + static_cast < size_t >(std::countr_zero(m)));
+            pos = w + 1;
+            if (pos >= words_at(l))
+                return npos;
+        }
+        return npos;
+    }
+
+    //  takes the lowest set bit, npos when none is
+    constexpr size_t acquire()
+    {
+        auto const i = ffs();
+        if (i != npos)
+            reset(i);
+        return i;
+    }
+
+    //  takes up to out.size() set bits, lowest first, a leaf word at a time, and returns how many it took
+    constexpr size_t acquire(std::span < size_t > const out)
+    {
+        size_t taken{0};
+        while (taken < out.size() && top() != 0)
+        {
+            auto const w = descend(levels - 1, static_cast < size_t >(std::countr_zero(top()))) / word_bits;
+            auto & leaf = word(0, w);
+            while (leaf != 0 && taken < out.size())
+            {
+                out[taken++] = w * word_bits + static_cast < size_t >(std::countr_zero(leaf));
+                leaf &= leaf - 1;
+                --count_;
+            }
+            if (leaf == 0)
+                clear_above(w);
+        }
+        return taken;
+    }
+
+    constexpr void release(size_t const i)
+    {
+        set(i);
+    }
+
+    constexpr friend bool operator == (hierarchical_bitset const &, hierarchical_bitset const &) = default;
+
+private:
+    inline constexpr static size_t const word_bits{detail::word_bits};
+    inline constexpr static auto const offsets{detail::level_offsets < N >()};
+
+    std::array < uint64_t, offsets[levels] > words_{};
+    size_t count_{0};
+
+    static constexpr uint64_t bit(size_t const i)
+    {
+        return uint64_t{1} << (i % word_bits);
+    }
+
+    static constexpr size_t words_at(size_t const l)
+    {
+        return offsets[l + 1] - offsets[l];
+    }
+
+    constexpr uint64_t & word(size_t const l, size_t const w)
+    {
+        return words_[offsets[l] + w];
+    }
+
+    constexpr uint64_t word(size_t const l, size_t const w) const
+    {
+        return words_[offsets[l] + w];
+    }
+
+    constexpr uint64_t top() const
+    {
+        return word(levels - 1, 0);
+    }
+
+    //  from bit pos at level l down the lowest set branch to a leaf bit
+    constexpr size_t descend(size_t l, size_t pos) const
+    {
+        while (l-- > 0)
+            pos = pos * word_bits + static_cast < size_t >(std::countr_zero(word(l, pos)));
+        return pos;
+    }
+
+    //  leaf word w just went empty
+    constexpr void clear_above(size_t const w)
+    {
+        auto pos = w;
+        for (size_t l = 1; l < levels; ++l, pos /= word_bits)
+        {
+            auto & s = word(l, pos / word_bits);
+            s &= ~bit(pos);
+            if (s != 0)
+                break;
+        }
+    }
+};
+
+}
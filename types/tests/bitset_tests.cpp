@@ -0,0 +1,158 @@
+#include <catch2/catch_all.hpp>
+
+#include <bitset>
+#include <random>
+#include <vector>
+
+import zsl.types.bitset;
+
+namespace zsl::types::tests
+{
+
+//  the scans fall back to one word at a time in a constant expression
+constexpr auto sample()
+{
+    bitset < 512 > b;
+    b.set(7).set(300).set(511);
+    return b;
+}
+static_assert(sample().count() == 3);
+static_assert(sample().ffs() == 7);
+static_assert(sample().fls() == 511);
+static_assert(sample().ffc() == 0);
+static_assert(sample().next_set(8) == 300);
+static_assert(sample().prev_set(299) == 7);
+static_assert(sample().rank(300) == 1);
+static_assert(sample().select(2) == 511);
+static_assert(sample().select(3) == bitset < 512 >::npos);
+static_assert(bitset < 512 >{}.ffs() == bitset < 512 >::npos);
+static_assert(bitset < 512 >{}.set().ffc() == bitset < 512 >::npos);
+
+//  the padding above N stays clear
+static_assert(bitset < 8 >{}.set().count() == 8);
+static_assert((~bitset < 8 >{}).all());
+static_assert(bitset < 8 >{}.set().ffc() == bitset < 8 >::npos);
+static_assert(bitset < 8 >{}.set(3).flc() == 7);
+
+//  checked against std::bitset
+template < size_t N >
+void compare(std::mt19937_64 & random, double const density)
+{
+    bitset < N > b;
+    std::bitset < N > expected;
+    std::bernoulli_distribution coin{density};
+    for (size_t i = 0; i < N; ++i)
+        if (coin(random))
+        {
+            b.set(i);
+            expected.set(i);
+        }
+
+    auto const first = [&] (bool const value, size_t const from)
+    {
+        for (size_t i = from; i < N; ++i)
+            if (expected[i] == value)
+                return i;
+        return N;
+    };
+    auto const last = [&] (bool const value, size_t const from)
+    {
+        for (size_t i = from + 1; i-- > 0;)
+            if (expected[i] == value)
+                return i;
+        return N;
+    };
+
+    REQUIRE(b.count() == expected.count());
+    REQUIRE(b.any() == expected.any());
+    REQUIRE(b.all() == expected.all());
+    REQUIRE(b.ffs() == first(true, 0));
+    REQUIRE(b.ffc() == first(false, 0));
+    REQUIRE(b.fls() == last(true, N - 1));
+    REQUIRE(b.flc() == last(false, N - 1));
+    for (uint32_t k = 0; k < 32; ++k)
+    {
+        auto const i = random() % N;
+        REQUIRE(b.next_set(i) == first(true, i));
+        REQUIRE(b.next_clear(i) == first(false, i));
+        REQUIRE(b.prev_set(i) == last(true, i));
+        REQUIRE(b.prev_clear(i) == last(false, i));
+        REQUIRE(b.rank(i) == (expected << (N - i)).count());
+    }
+
+    std::vector < size_t > ones;
+    for (auto const i : b.ones())
+        ones.push_back(i);
+    REQUIRE(ones.size() == expected.count());
+    for (size_t k = 0; k < ones.size(); ++k)
+    {
+        REQUIRE(expected[ones[k]]);
+        REQUIRE(b.select(k) == ones[k]);
+    }
+    REQUIRE(b.select(ones.size()) == bitset < N >::npos);
+
+    auto const inverse = ~b;
+    REQUIRE(inverse.count() == N - expected.count());
+    REQUIRE((inverse & b).none());
+    REQUIRE((inverse | b).all());
+    REQUIRE((inverse ^ b).all());
+}
+
+TEST_CASE("bitset tests", "[types_tests/bitset]")
+{
+    std::mt19937_64 random{42};
+    SECTION("set, reset and test")
+    {
+        bitset < 128 > b;
+        b.set(64).set(1).set(127);
+        REQUIRE(b.test(64));
+        REQUIRE(b[127]);
+        b.reset(64).flip(2);
+        REQUIRE(!b.test(64));
+        REQUIRE(b.test(2));
+        REQUIRE(b.count() == 3);
+        b.reset();
+        REQUIRE(b.none());
+    }
+    SECTION("against std::bitset")
+    {
+        //  every scan the CPU runs, from the widest down
+        auto const best = bitset_simd;
+        for (auto const simd : {bitset_simd_t::AVX512, bitset_simd_t::AVX2, bitset_simd_t::NONE})
+        {
+            if (simd > best)
+                continue;
+            bitset_simd = simd;
+            for (auto const density : {0.0, 0.001, 0.01, 0.5, 0.99, 0.999, 1.0})
+                for (uint32_t round = 0; round < 8; ++round)
+                {
+                    compare < 1 >(random, density);
+                    compare < 8 >(random, density);
+                    compare < 64 >(random, density);
+                    compare < 128 >(random, density);
+                    compare < 512 >(random, density);
+                    compare < 1024 >(random, density);
+                    compare < 4096 >(random, density);
+                }
+        }
+        bitset_simd = best;
+    }
+}
+
+TEST_CASE("bitset benchmarks", "[!benchmark]")
+{
+    //  one free slot at the far end, the worst case for a free list
+    bitset < 65536 > b;
+    b.set();
+    b.reset(65535);
+    BENCHMARK("ffc/65536/last")
+    {
+        return b.ffc();
+    };
+    BENCHMARK("select/65536/last")
+    {
+        return b.select(65534);
+    };
+}
+
+}
@@ -0,0 +1,208 @@
+#include <catch2/catch_all.hpp>
+
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+import zsl.types.estring;
+import zsl.types.estring_map;
+
+namespace zsl::types::tests
+{
+
+namespace
+{
+
+struct type_tag_CcyPairCode;
+using CcyPairCode = typed_fixed_estring_t < type_tag_CcyPairCode, 6 >;
+
+struct type_tag_TenorCode;
+using TenorCode = typed_bounded_estring_t < type_tag_TenorCode, 12 >;
+
+struct type_tag_UserID;
+using UserID = typed_bounded_estring_t < type_tag_UserID, 20 >;
+
+struct type_tag_UserName;
+using UserName = typed_bounded_estring_t < type_tag_UserName, 40 >;
+
+static_assert(estring_key < CcyPairCode >);
+static_assert(estring_key < UserName >);
+static_assert(!estring_key < std::string >);
+
+std::string random_string(std::mt19937_64 & random, size_t const min_length, size_t const max_length)
+{
+    std::string s(min_length + random() % (max_length - min_length + 1), ' ');
+    for (auto & c : s)
+        c = static_cast < char >('A' + random() % 26);
+    return s;
+}
+
+//  random inserts and erases, checked against std::unordered_map
+template < typename K, size_t MIN_LEN, size_t MAX_LEN >
+void compare(std::mt19937_64 & random, size_t const distinct)
+{
+    std::vector < std::string > names;
+    for (size_t i = 0; i < distinct; ++i)
+        names.push_back(random_string(random, MIN_LEN, MAX_LEN));
+
+    estring_map < K, uint64_t > map;
+    std::unordered_map < std::string, uint64_t > expected;
+    for (uint32_t k = 0; k < 50000; ++k)
+    {
+        auto const & name = names[random() % names.size()];
+        K const key{name};
+        switch (random() % 3)
+        {
+        case 0:
+            map[key] = k;
+            expected[name] = k;
+            break;
+        case 1:
+            REQUIRE(map.try_emplace(key, k).second == expected.try_emplace(name, k).second);
+            break;
+        default:
+            REQUIRE(map.erase(key) == (expected.erase(name) == 1));
+        }
+        REQUIRE(map.size() == expected.size());
+        if (k % 97 == 0)
+        {
+            auto const & probe = names[random() % names.size()];
+            auto const * const value = map.find(K{probe});
+            auto const it = expected.find(probe);
+            REQUIRE((value != nullptr) == (it != expected.end()));
+            if (value)
+                REQUIRE(*value == it->second);
+        }
+    }
+
+    size_t seen{0};
+    for (auto const & [key, value] : map)
+    {
+        REQUIRE(expected.at(std::string{std::string_view{key}}) == value);
+        ++seen;
+    }
+    REQUIRE(seen == expected.size());
+}
+
+}
+
+TEST_CASE("estring map tests", "[types_tests/estring_map]")
+{
+    std::mt19937_64 random{42};
+    SECTION("basics")
+    {
+        estring_map < CcyPairCode, double > rates;
+        REQUIRE(rates.empty());
+        REQUIRE(rates.capacity() == 0);
+        REQUIRE(rates.find(CcyPairCode{"EURUSD"}) == nullptr);
+        REQUIRE(!rates.erase(CcyPairCode{"EURUSD"}));
+
+        rates[CcyPairCode{"EURUSD"}] = 1.0842;
+        rates[CcyPairCode{"GBPUSD"}] = 1.2711;
+        REQUIRE(rates.size() == 2);
+        REQUIRE(*rates.find(CcyPairCode{"EURUSD"}) == 1.0842);
+        REQUIRE(!rates.try_emplace(CcyPairCode{"GBPUSD"}, 0.0).second);
+        REQUIRE(rates.contains(CcyPairCode{"GBPUSD"}));
+        REQUIRE(!rates.contains(CcyPairCode{"USDJPY"}));
+
+        auto moved = std::move(rates);
+        REQUIRE(moved.size() == 2);
+        REQUIRE(rates.empty());
+        REQUIRE(!rates.contains(CcyPairCode{"EURUSD"}));
+
+        moved.clear();
+        REQUIRE(moved.empty());
+        REQUIRE(!moved.contains(CcyPairCode{"EURUSD"}));
+    }
+    SECTION("growth")
+    {
+        estring_map < TenorCode, uint32_t > tenors{100};
+        auto const capacity = tenors.capacity();
+        REQUIRE(capacity >= 100);
+        for (uint32_t i = 0; i < 100; ++i)
+            tenors[TenorCode{std::to_string(i) + "M"}] = i;
+        REQUIRE(tenors.capacity() == capacity);
+        for (uint32_t i = 100; i < 10000; ++i)
+            tenors[TenorCode{std::to_string(i) + "M"}] = i;
+        for (uint32_t i = 0; i < 10000; ++i)
+            REQUIRE(*tenors.find(TenorCode{std::to_string(i) + "M"}) == i);
+
+        //  churn at a steady size reuses the table rather than growing it
+        auto const grown = tenors.capacity();
+        for (uint32_t i = 0; i < 100000; ++i)
+        {
+            tenors.erase(TenorCode{std::to_string(i) + "M"});
+            tenors[TenorCode{std::to_string(i + 10000) + "M"}] = i;
+        }
+        REQUIRE(tenors.size() == 10000);
+        REQUIRE(tenors.capacity() == grown);
+    }
+    SECTION("against std::unordered_map")
+    {
+        //  with the AVX2 compare if the CPU has it, and without
+        auto const avx2 = estring_map_avx2;
+        for (auto const on : {true, false})
+        {
+            if (on && !avx2)
+                continue;
+            estring_map_avx2 = on;
+            compare < bounded_estring_t < 3 >, 1, 3 >(random, 500);
+            compare < CcyPairCode, 6, 6 >(random, 200);
+            compare < TenorCode, 1, 12 >(random, 2000);
+            compare < UserID, 1, 20 >(random, 5000);
+            compare < UserName, 10, 40 >(random, 5000);
+        }
+        estring_map_avx2 = avx2;
+    }
+}
+
+namespace
+{
+
+//  hits on a table of n keys, looked up in a random order
+template < typename K, size_t MIN_LEN, size_t MAX_LEN >
+void lookup(std::mt19937_64 & random, std::string const & name, size_t const n)
+{
+    estring_map < K, uint64_t > map;
+    std::unordered_map < std::string, uint64_t > strings;
+    std::vector < std::string > names;
+    std::vector < K > keys;
+    for (size_t i = 0; i < n; ++i)
+    {
+        names.push_back(random_string(random, MIN_LEN, MAX_LEN));
+        keys.emplace_back(names.back());
+        map[keys.back()] = i;
+        strings[names.back()] = i;
+    }
+    std::vector < size_t > order(4096);
+    for (auto & i : order)
+        i = random() % n;
+
+    BENCHMARK("lookup/estring_map/" + name)
+    {
+        uint64_t sum{0};
+        for (auto const i : order)
+            sum += *map.find(keys[i]);
+        return sum;
+    };
+    BENCHMARK("lookup/unordered_map/" + name)
+    {
+        uint64_t sum{0};
+        for (auto const i : order)
+            sum += strings.find(names[i])->second;
+        return sum;
+    };
+}
+
+}
+
+TEST_CASE("estring map benchmarks", "[!benchmark]")
+{
+    std::mt19937_64 random{42};
+    lookup < CcyPairCode, 6, 6 >(random, "CcyPairCode/1K", 1000);
+    lookup < TenorCode, 2, 12 >(random, "TenorCode/1K", 1000);
+    lookup < UserID, 8, 20 >(random, "UserID/100K", 100000);
+}
+
+}
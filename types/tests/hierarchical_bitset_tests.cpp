@@ -0,0 +1,151 @@
+#include <catch2/catch_all.hpp>
+
+#include <memory>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+import zsl.types.bitset;
+import zsl.types.hierarchical_bitset;
+
+namespace zsl::types::tests
+{
+
+static_assert(hierarchical_bitset < 64 >::levels == 1);
+static_assert(hierarchical_bitset < 4096 >::levels == 2);
+static_assert(hierarchical_bitset < 8192 >::levels == 3);
+static_assert(hierarchical_bitset < (1 << 24) >::levels == 4);
+
+constexpr auto sample()
+{
+    hierarchical_bitset < 4096 > b;
+    b.set(4000).set(70);
+    return b;
+}
+static_assert(sample().ffs() == 70);
+static_assert(sample().next_set(71) == 4000);
+static_assert(sample().next_set(4001) == hierarchical_bitset < 4096 >::npos);
+static_assert(sample().count() == 2);
+
+//  random sets and resets, checked against the flat bitset
+template < size_t N >
+void compare(std::mt19937_64 & random)
+{
+    auto h = std::make_unique < hierarchical_bitset < N > >();
+    auto f = std::make_unique < bitset < N > >();
+    for (uint32_t k = 0; k < 20000; ++k)
+    {
+        auto const i = random() % N;
+        if (random() % 2)
+        {
+            h->set(i);
+            f->set(i);
+        }
+        else
+        {
+            h->reset(i);
+            f->reset(i);
+        }
+        if (k % 101 == 0)
+        {
+            REQUIRE(h->ffs() == f->ffs());
+            auto const from = random() % N;
+            REQUIRE(h->next_set(from) == f->next_set(from));
+            REQUIRE(h->count() == f->count());
+        }
+    }
+}
+
+template < size_t N >
+void drain()
+{
+    auto h = std::make_unique < hierarchical_bitset < N > >();
+    h->set();
+    REQUIRE(h->all());
+
+    std::vector < size_t > out(N / 3 + 1);
+    auto const n = h->acquire(std::span < size_t >{out});
+    REQUIRE(n == out.size());
+    for (size_t i = 0; i < n; ++i)
+        REQUIRE(out[i] == i);
+    REQUIRE(h->acquire() == n);
+    h->release(0);
+    REQUIRE(h->acquire() == 0);
+
+    std::vector < size_t > rest(N);
+    REQUIRE(h->acquire(std::span < size_t >{rest}) == N - n - 1);
+    REQUIRE(h->none());
+    REQUIRE(h->acquire() == hierarchical_bitset < N >::npos);
+}
+
+TEST_CASE("hierarchical bitset tests", "[types_tests/hierarchical_bitset]")
+{
+    std::mt19937_64 random{42};
+    SECTION("against bitset")
+    {
+        compare < 8 >(random);
+        compare < 64 >(random);
+        compare < 128 >(random);
+        compare < 4096 >(random);
+        compare < 8192 >(random);
+        compare < 262144 >(random);
+    }
+    SECTION("acquire and release")
+    {
+        drain < 64 >();
+        drain < 4096 >();
+        drain < 262144 >();
+    }
+}
+
+namespace
+{
+
+//  one free slot, at the far end, the worst case for finding it
+template < typename B >
+auto last_free()
+{
+    auto b = std::make_unique < B >();
+    b->set(B::size() - 1);
+    return b;
+}
+
+template < size_t N >
+void find_free()
+{
+    auto const flat = last_free < bitset < N > >();
+    auto const hierarchical = last_free < hierarchical_bitset < N > >();
+    BENCHMARK("ffs/flat/" + std::to_string(N))
+    {
+        return flat->ffs();
+    };
+    BENCHMARK("ffs/hierarchical/" + std::to_string(N))
+    {
+        return hierarchical->ffs();
+    };
+}
+
+}
+
+TEST_CASE("hierarchical bitset benchmarks", "[!benchmark]")
+{
+    find_free < 64 >();
+    find_free < 4096 >();
+    find_free < 262144 >();
+    find_free < (1 << 24) >();
+
+    //  a full allocator handing out and taking back one slot
+    auto h = std::make_unique < hierarchical_bitset < (1 << 20) > >();
+    h->set();
+    std::vector < size_t > taken((1 << 20) - 1);
+    h->acquire(std::span < size_t >{taken});
+    BENCHMARK("acquire and release/hierarchical/1M")
+    {
+        auto const i = h->acquire();
+        h->release(i);
+        return i;
+    };
+}
+
+}